@@ -1,6 +1,10 @@
 #include "FileReader.h"
 
 #include <fstream>
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
 
 #ifdef _WIN32
 	#include <windows.h>
@@ -8,50 +12,198 @@
 	#include <io.h> 
 
 	#define access _access_s
+#else
+	#include <unistd.h>
 #endif // _WIN32
 
 
 
 
 
+bool isAssetRoot(const std::string& directory)
+{
+	return access((directory + "shaders").c_str(), 0) == 0 && access((directory + "resources").c_str(), 0) == 0;
+}
+
 std::string readRootPath()
 {
+	// Explicit override for installs where the assets don't sit above the executable
+	const char* overridePath = std::getenv("VULKANTEST_ROOT");
+	if (overridePath != nullptr && *overridePath != '\0')
+	{
+		std::string rootPath(overridePath);
+		if (rootPath.back() != '/' && rootPath.back() != '\\')
+		{
+			rootPath += '/';
+		}
+		return rootPath;
+	}
+
 	std::string execPath;
 
 #ifdef _WIN32
 	execPath.resize(MAX_PATH);
-	GetModuleFileNameA(NULL, (LPSTR) execPath.data(), MAX_PATH);
+	execPath.resize(GetModuleFileNameA(NULL, (LPSTR) execPath.data(), MAX_PATH));
+#else
+	char linkTarget[4096];
+	ssize_t length = readlink("/proc/self/exe", linkTarget, sizeof(linkTarget) - 1);
+	if (length > 0)
+	{
+		execPath.assign(linkTarget, (size_t)length);
+	}
 #endif // _WIN32
 
-	std::string rootName("VulkanTest");
-	size_t index = execPath.find(rootName);
-	
-	return execPath.substr(0, index + rootName.size() + 1);
+	// Build directories nest below the project, walk up to the first directory holding the assets
+	size_t separator = execPath.find_last_of("/\\");
+	while (separator != std::string::npos)
+	{
+		std::string directory = execPath.substr(0, separator + 1);
+		if (isAssetRoot(directory))
+		{
+			return directory;
+		}
+
+		if (separator == 0)
+		{
+			break;
+		}
+		separator = execPath.find_last_of("/\\", separator - 1);
+	}
+
+	// Relative to the working directory
+	return std::string();
 }
 
 const std::string FileReader::ROOT_PATH = readRootPath();
 
 std::vector<char> FileReader::readData(const char* relativePath)
+{
+	FileView view = openData(relativePath, MappedFile::AccessHint::SEQUENTIAL);
+	return std::vector<char>(view.data(), view.data() + view.size());
+}
+
+bool FileReader::tryReadData(const char* relativePath, std::vector<char>& data)
+{
+	FileView view;
+	if (!tryOpenData(relativePath, view, MappedFile::AccessHint::SEQUENTIAL))
+	{
+		return false;
+	}
+
+	data.assign(view.data(), view.data() + view.size());
+	return true;
+}
+
+void FileReader::writeDataAtomic(const char* relativePath, const void* data, size_t size)
 {
 	std::string fullPath = ROOT_PATH + relativePath;
-	std::ifstream file(fullPath, std::ios::ate | std::ios::binary);
+	std::string tempPath = fullPath + ".tmp";
+
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			throw std::runtime_error("Failed to open file " + tempPath);
+		}
+
+		file.write(static_cast<const char*>(data), size);
+		file.flush();
 
-	if (!file.is_open()) {
-		throw std::runtime_error("Failed to open file " + fullPath);
+		if (file.fail()) {
+			std::remove(tempPath.c_str());
+			throw std::runtime_error("Failed to write file " + tempPath);
+		}
 	}
 
-	std::vector<char> fileContent(file.tellg());
-	file.seekg(std::ios::beg);
+#ifdef _WIN32
+	bool isRenamed = MoveFileExA(tempPath.c_str(), fullPath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	bool isRenamed = std::rename(tempPath.c_str(), fullPath.c_str()) == 0;
+#endif // _WIN32
 
-	file.read(fileContent.data(), fileContent.size());
+	if (!isRenamed) {
+		std::remove(tempPath.c_str());
+		throw std::runtime_error("Failed to replace file " + fullPath);
+	}
+}
 
-	file.close();
-	
-	return fileContent;
+FileView FileReader::openData(const char* relativePath, MappedFile::AccessHint hint)
+{
+	FileView view;
+	if (!tryOpenData(relativePath, view, hint)) {
+		throw std::runtime_error("Failed to open file " + std::string(relativePath));
+	}
+
+	return view;
+}
+
+bool FileReader::tryOpenData(const char* relativePath, FileView& view, MappedFile::AccessHint hint)
+{
+	return getFileSystem().tryOpen(relativePath, hint, view);
+}
+
+VirtualFileSystem& FileReader::getFileSystem()
+{
+	static VirtualFileSystem fileSystem;
+
+	static std::once_flag rootMounted;
+	std::call_once(rootMounted, []()
+		{
+			fileSystem.mount("", std::make_shared<DirectoryMount>(ROOT_PATH));
+
+			// Packed data shadows the loose files it was built from
+			std::string archivePath = ROOT_PATH + "data/bin.pak";
+			if (access(archivePath.c_str(), 0) == 0)
+			{
+				try
+				{
+					fileSystem.mount("data/bin", std::make_shared<ArchiveMount>(std::make_shared<PackedArchive>(archivePath)));
+				}
+				catch (const std::exception& e)
+				{
+					std::cerr << "Archive not mounted: " << e.what() << std::endl;
+				}
+			}
+		});
+
+	return fileSystem;
+}
+
+const std::string& FileReader::getRootPath()
+{
+	return ROOT_PATH;
 }
 
 Image FileReader::readImage(const char* imagePath)
 {
-	std::string fullPath = ROOT_PATH + imagePath;
-	return Image(fullPath.c_str());
+	return readImage(imagePath, STBI_rgb_alpha);
+}
+
+Image FileReader::readImage(const char* imagePath, int desiredChannels)
+{
+	// Decoded straight from the page cache, a missing file leaves the pixels null like stbi_load does
+	FileView view;
+	if (!tryOpenData(imagePath, view, MappedFile::AccessHint::SEQUENTIAL))
+	{
+		return Image();
+	}
+
+	return Image(view.data(), view.size(), desiredChannels);
+}
+
+bool FileReader::tryReadKtxImage(const char* relativePath, KtxImage& image)
+{
+	// Levels are copied out once, front to back
+	FileView view;
+	if (!tryOpenData(relativePath, view, MappedFile::AccessHint::SEQUENTIAL))
+	{
+		return false;
+	}
+
+	image.parse(std::move(view));
+	return true;
+}
+
+void FileReader::readMesh(const char* relativePath, MeshFile& mesh)
+{
+	mesh.parse(openData(relativePath, MappedFile::AccessHint::SEQUENTIAL));
 }
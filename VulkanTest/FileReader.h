@@ -3,12 +3,36 @@
 #include <string>
 
 #include "Image.h"
+#include "KtxImage.h"
+#include "mesh/MeshFile.h"
+#include "vfs/VirtualFileSystem.h"
 
+// Reads go through the virtual file system, the asset root is mounted at "" on first use
 class FileReader
 {
 public:
 	static std::vector<char> readData(const char* relativePath);
+	static bool tryReadData(const char* relativePath, std::vector<char>& data);
+
+	// Zero copy alternative to readData, throws when no mount has the file
+	static FileView openData(const char* relativePath, MappedFile::AccessHint hint);
+	static bool tryOpenData(const char* relativePath, FileView& view, MappedFile::AccessHint hint);
+
+	// Written to a temporary file first and renamed over the target
+	static void writeDataAtomic(const char* relativePath, const void* data, size_t size);
 	static Image readImage(const char* imagePath);
+	static Image readImage(const char* imagePath, int desiredChannels);
+
+	// False when the file doesn't exist, throws when it isn't a usable KTX2 texture
+	static bool tryReadKtxImage(const char* relativePath, KtxImage& image);
+
+	// Throws when the file is missing or isn't a usable mesh
+	static void readMesh(const char* relativePath, MeshFile& mesh);
+
+	static VirtualFileSystem& getFileSystem();
+
+	// Directory holding shaders/ and resources/, with a trailing separator
+	static const std::string& getRootPath();
 
 private:
 	FileReader();
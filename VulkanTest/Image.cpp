@@ -3,12 +3,100 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
-Image::Image(const char* filepath)
+#include <algorithm>
+#include <cstring>
+
+Image::Image() :
+	width(0),
+	height(0),
+	channels(0),
+	pixelChannels(0),
+	pixels(nullptr)
+{
+}
+
+Image::Image(const char* filepath) :
+	Image(filepath, STBI_rgb_alpha)
+{
+}
+
+Image::Image(const char* filepath, int desiredChannels)
 {
-	pixels = stbi_load(filepath, &width, &height, &channels, STBI_rgb_alpha);
+	pixels = stbi_load(filepath, &width, &height, &channels, desiredChannels);
+	pixelChannels = desiredChannels != 0 ? desiredChannels : channels;
+}
+
+Image::Image(const void* fileData, size_t fileSize, int desiredChannels)
+{
+	pixels = stbi_load_from_memory(static_cast<const stbi_uc*>(fileData), (int)fileSize, &width, &height, &channels, desiredChannels);
+	pixelChannels = desiredChannels != 0 ? desiredChannels : channels;
 }
 
 void Image::free()
 {
 	stbi_image_free(pixels);
 }
+
+uint32_t Image::getMipLevelCount(uint32_t width, uint32_t height)
+{
+	uint32_t levelCount = 1;
+	while ((width | height) >> levelCount)
+	{
+		++levelCount;
+	}
+
+	return levelCount;
+}
+
+std::vector<stbi_uc> Image::generateMipChain(std::vector<VkDeviceSize>& levelOffsets) const
+{
+	return generateMipChain(pixels, width, height, levelOffsets);
+}
+
+std::vector<stbi_uc> Image::generateMipChain(const stbi_uc* rgba, int width, int height, std::vector<VkDeviceSize>& levelOffsets)
+{
+	uint32_t levelCount = getMipLevelCount(width, height);
+	levelOffsets.resize(levelCount);
+
+	VkDeviceSize chainSize = 0;
+	for (uint32_t level = 0; level < levelCount; ++level)
+	{
+		levelOffsets[level] = chainSize;
+		chainSize += (VkDeviceSize)std::max(width >> level, 1) * std::max(height >> level, 1) * 4;
+	}
+
+	std::vector<stbi_uc> chain((size_t)chainSize);
+	memcpy(chain.data(), rgba, (size_t)width * height * 4);
+
+	for (uint32_t level = 1; level < levelCount; ++level)
+	{
+		int srcWidth = std::max(width >> (level - 1), 1);
+		int srcHeight = std::max(height >> (level - 1), 1);
+		int dstWidth = std::max(width >> level, 1);
+		int dstHeight = std::max(height >> level, 1);
+
+		const stbi_uc* src = chain.data() + levelOffsets[level - 1];
+		stbi_uc* dst = chain.data() + levelOffsets[level];
+
+		for (int y = 0; y < dstHeight; ++y)
+		{
+			// Odd sizes clamp to the last row and column
+			const stbi_uc* row0 = src + (size_t)std::min(y * 2, srcHeight - 1) * srcWidth * 4;
+			const stbi_uc* row1 = src + (size_t)std::min(y * 2 + 1, srcHeight - 1) * srcWidth * 4;
+
+			for (int x = 0; x < dstWidth; ++x)
+			{
+				int x0 = std::min(x * 2, srcWidth - 1) * 4;
+				int x1 = std::min(x * 2 + 1, srcWidth - 1) * 4;
+
+				for (int c = 0; c < 4; ++c)
+				{
+					uint32_t sum = row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c];
+					dst[((size_t)y * dstWidth + x) * 4 + c] = (stbi_uc)((sum + 2) / 4);
+				}
+			}
+		}
+	}
+
+	return chain;
+}
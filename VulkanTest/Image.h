@@ -3,15 +3,30 @@
 #include <stb_image.h>
 #include "vulkan/vulkan.h"
 
+#include <vector>
+
 class Image
 {
 public:
+	Image();
 	Image(const char* filepath);
+
+	// 0 keeps the channel count stored in the file
+	Image(const char* filepath, int desiredChannels);
+	Image(const void* fileData, size_t fileSize, int desiredChannels);
 	void free();
 
+	static uint32_t getMipLevelCount(uint32_t width, uint32_t height);
+
+	// Box filters the RGBA pixels down to 1x1, levels are tightly packed starting with level 0
+	std::vector<stbi_uc> generateMipChain(std::vector<VkDeviceSize>& levelOffsets) const;
+	static std::vector<stbi_uc> generateMipChain(const stbi_uc* rgba, int width, int height, std::vector<VkDeviceSize>& levelOffsets);
+
 	int width;
 	int height;
+
+	// In the file, pixelChannels is what pixels actually holds
 	int channels;
+	int pixelChannels;
 	stbi_uc* pixels;
 };
-
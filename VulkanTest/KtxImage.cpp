@@ -0,0 +1,118 @@
+#include "KtxImage.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+const uint8_t KTX_IDENTIFIER[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+KtxImage::KtxImage() :
+	format(VK_FORMAT_UNDEFINED),
+	width(0),
+	height(0),
+	mipLevels(0),
+
+	m_levelDataOffset(0),
+	m_levelDataSize(0)
+{
+}
+
+void KtxImage::parse(FileView file)
+{
+	m_file = std::move(file);
+
+	KtxHeader header;
+	if (m_file.size() < sizeof(header))
+	{
+		throw std::runtime_error("KTX2 file is truncated.");
+	}
+	memcpy(&header, m_file.data(), sizeof(header));
+
+	if (memcmp(header.identifier, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER)) != 0)
+	{
+		throw std::runtime_error("Not a KTX2 file.");
+	}
+
+	if (header.supercompressionScheme != 0 || header.pixelDepth != 0 || header.layerCount > 1 || header.faceCount != 1 ||
+		header.levelCount == 0 || header.pixelWidth == 0 || header.pixelHeight == 0)
+	{
+		throw std::runtime_error("Unsupported KTX2 texture layout.");
+	}
+
+	format = (VkFormat)header.vkFormat;
+	if (getBlockByteSize(format) == 0)
+	{
+		throw std::runtime_error("Unsupported KTX2 texture format.");
+	}
+
+	width = header.pixelWidth;
+	height = header.pixelHeight;
+	mipLevels = header.levelCount;
+
+	size_t levelIndexEnd = sizeof(header) + sizeof(KtxLevelIndex) * mipLevels;
+	if (m_file.size() < levelIndexEnd)
+	{
+		throw std::runtime_error("KTX2 file is truncated.");
+	}
+
+	std::vector<KtxLevelIndex> levelIndexes(mipLevels);
+	memcpy(levelIndexes.data(), m_file.data() + sizeof(header), sizeof(KtxLevelIndex) * mipLevels);
+
+	// Levels are stored smallest first, one contiguous range covers all of them
+	uint64_t begin = UINT64_MAX;
+	uint64_t end = 0;
+	for (KtxLevelIndex& levelIndex : levelIndexes)
+	{
+		if (levelIndex.byteOffset + levelIndex.byteLength > m_file.size())
+		{
+			throw std::runtime_error("KTX2 level is out of the file.");
+		}
+
+		begin = std::min(begin, levelIndex.byteOffset);
+		end = std::max(end, levelIndex.byteOffset + levelIndex.byteLength);
+	}
+
+	m_levelDataOffset = begin;
+	m_levelDataSize = end - begin;
+
+	levelOffsets.resize(mipLevels);
+	for (uint32_t level = 0; level < mipLevels; ++level)
+	{
+		levelOffsets[level] = levelIndexes[level].byteOffset - begin;
+	}
+}
+
+const char* KtxImage::getLevelData() const
+{
+	return m_file.data() + m_levelDataOffset;
+}
+
+VkDeviceSize KtxImage::getLevelDataSize() const
+{
+	return m_levelDataSize;
+}
+
+uint32_t KtxImage::getBlockByteSize(VkFormat format)
+{
+	switch (format)
+	{
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+	case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+	case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+		return 8;
+
+	case VK_FORMAT_BC3_UNORM_BLOCK:
+	case VK_FORMAT_BC3_SRGB_BLOCK:
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+	case VK_FORMAT_BC7_SRGB_BLOCK:
+	case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+	case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+		return 16;
+
+	default:
+		return 0;
+	}
+}
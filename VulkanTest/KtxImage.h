@@ -0,0 +1,65 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+#include "vfs/FileView.h"
+
+#include <vector>
+
+struct KtxHeader
+{
+	uint8_t identifier[12];
+	uint32_t vkFormat;
+	uint32_t typeSize;
+	uint32_t pixelWidth;
+	uint32_t pixelHeight;
+	uint32_t pixelDepth;
+	uint32_t layerCount;
+	uint32_t faceCount;
+	uint32_t levelCount;
+	uint32_t supercompressionScheme;
+
+	uint32_t dfdByteOffset;
+	uint32_t dfdByteLength;
+	uint32_t kvdByteOffset;
+	uint32_t kvdByteLength;
+	uint64_t sgdByteOffset;
+	uint64_t sgdByteLength;
+};
+
+struct KtxLevelIndex
+{
+	uint64_t byteOffset;
+	uint64_t byteLength;
+	uint64_t uncompressedByteLength;
+};
+
+extern const uint8_t KTX_IDENTIFIER[12];
+
+// A 2D, non supercompressed KTX2 texture kept as the file view, levels are uploaded straight from it
+class KtxImage
+{
+public:
+	KtxImage();
+
+	// Throws when the file isn't a texture the renderer can upload as is
+	void parse(FileView file);
+
+	const char* getLevelData() const;
+	VkDeviceSize getLevelDataSize() const;
+
+	// Bytes per 4x4 block, 0 for formats that aren't block compressed
+	static uint32_t getBlockByteSize(VkFormat format);
+
+	VkFormat format;
+	uint32_t width;
+	uint32_t height;
+	uint32_t mipLevels;
+
+	// Relative to getLevelData(), level 0 first
+	std::vector<VkDeviceSize> levelOffsets;
+
+private:
+	FileView m_file;
+	VkDeviceSize m_levelDataOffset;
+	VkDeviceSize m_levelDataSize;
+};
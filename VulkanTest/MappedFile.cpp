@@ -0,0 +1,253 @@
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <utility>
+
+#ifdef _WIN32
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif // _WIN32
+
+MappedFile::MappedFile() :
+	m_view(nullptr),
+	m_size(0),
+	m_isOpen(false)
+
+#ifdef _WIN32
+	,
+	m_fileHandle(INVALID_HANDLE_VALUE),
+	m_mappingHandle(nullptr)
+#endif // _WIN32
+{
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept :
+	MappedFile()
+{
+	*this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if (this != &other)
+	{
+		close();
+
+		std::swap(m_view, other.m_view);
+		std::swap(m_size, other.m_size);
+		std::swap(m_isOpen, other.m_isOpen);
+
+#ifdef _WIN32
+		std::swap(m_fileHandle, other.m_fileHandle);
+		std::swap(m_mappingHandle, other.m_mappingHandle);
+#endif // _WIN32
+	}
+
+	return *this;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& fullPath, AccessHint hint)
+{
+	close();
+
+	DWORD flags = FILE_ATTRIBUTE_NORMAL;
+	if (hint == AccessHint::SEQUENTIAL)
+	{
+		flags |= FILE_FLAG_SEQUENTIAL_SCAN;
+	}
+	else if (hint == AccessHint::RANDOM)
+	{
+		flags |= FILE_FLAG_RANDOM_ACCESS;
+	}
+
+	m_fileHandle = CreateFileA(fullPath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr);
+	if (m_fileHandle == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(m_fileHandle, &fileSize))
+	{
+		close();
+		return false;
+	}
+
+	m_size = (size_t)fileSize.QuadPart;
+	m_isOpen = true;
+
+	if (m_size == 0)
+	{
+		return true;
+	}
+
+	m_mappingHandle = CreateFileMappingA(m_fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_mappingHandle == nullptr)
+	{
+		close();
+		return false;
+	}
+
+	m_view = MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	if (m_view == nullptr)
+	{
+		close();
+		return false;
+	}
+
+	if (hint == AccessHint::WILL_NEED)
+	{
+		advise(hint, 0, m_size);
+	}
+
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (m_view != nullptr)
+	{
+		UnmapViewOfFile(m_view);
+	}
+	if (m_mappingHandle != nullptr)
+	{
+		CloseHandle(m_mappingHandle);
+	}
+	if (m_fileHandle != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_fileHandle);
+	}
+
+	m_view = nullptr;
+	m_mappingHandle = nullptr;
+	m_fileHandle = INVALID_HANDLE_VALUE;
+	m_size = 0;
+	m_isOpen = false;
+}
+
+void MappedFile::advise(AccessHint hint, size_t offset, size_t size) const
+{
+	// Sequential and random access are file flags on Windows, only prefetching applies to a view
+	if (hint != AccessHint::WILL_NEED || m_view == nullptr || offset >= m_size)
+	{
+		return;
+	}
+
+	WIN32_MEMORY_RANGE_ENTRY range;
+	range.VirtualAddress = static_cast<char*>(m_view) + offset;
+	range.NumberOfBytes = std::min(size, m_size - offset);
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
+
+#else
+
+bool MappedFile::open(const std::string& fullPath, AccessHint hint)
+{
+	close();
+
+	int fileDescriptor = ::open(fullPath.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fileDescriptor < 0)
+	{
+		return false;
+	}
+
+	struct stat fileStat;
+	if (fstat(fileDescriptor, &fileStat) != 0)
+	{
+		::close(fileDescriptor);
+		return false;
+	}
+
+	m_size = (size_t)fileStat.st_size;
+	m_isOpen = true;
+
+	// The mapping keeps the file referenced on its own
+	if (m_size > 0)
+	{
+		void* view = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+		if (view == MAP_FAILED)
+		{
+			::close(fileDescriptor);
+			close();
+			return false;
+		}
+
+		m_view = view;
+	}
+
+	::close(fileDescriptor);
+
+	advise(hint, 0, m_size);
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (m_view != nullptr)
+	{
+		munmap(m_view, m_size);
+	}
+
+	m_view = nullptr;
+	m_size = 0;
+	m_isOpen = false;
+}
+
+void MappedFile::advise(AccessHint hint, size_t offset, size_t size) const
+{
+	if (m_view == nullptr || offset >= m_size)
+	{
+		return;
+	}
+
+	int advice = MADV_NORMAL;
+	switch (hint)
+	{
+	case AccessHint::SEQUENTIAL:
+		advice = MADV_SEQUENTIAL;
+		break;
+	case AccessHint::RANDOM:
+		advice = MADV_RANDOM;
+		break;
+	case AccessHint::WILL_NEED:
+		advice = MADV_WILLNEED;
+		break;
+	default:
+		break;
+	}
+
+	size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+	size_t begin = offset / pageSize * pageSize;
+	size_t end = std::min(offset + std::min(size, m_size - offset), m_size);
+
+	madvise(static_cast<char*>(m_view) + begin, end - begin, advice);
+}
+
+#endif // _WIN32
+
+bool MappedFile::isOpen() const
+{
+	return m_isOpen;
+}
+
+const char* MappedFile::data() const
+{
+	return static_cast<const char*>(m_view);
+}
+
+size_t MappedFile::size() const
+{
+	return m_size;
+}
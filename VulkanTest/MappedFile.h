@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+// Read only mapping of a whole file, unmapped when the owner is destroyed. Move only.
+class MappedFile
+{
+public:
+	enum class AccessHint
+	{
+		NORMAL,
+		SEQUENTIAL,
+		RANDOM,
+		WILL_NEED
+	};
+
+	MappedFile();
+	~MappedFile();
+
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// False when the file can't be opened or mapped, an empty file maps to a null view
+	bool open(const std::string& fullPath, AccessHint hint);
+	void close();
+
+	// Paging hint for a part of the view, rounded out to whole pages
+	void advise(AccessHint hint, size_t offset, size_t size) const;
+
+	bool isOpen() const;
+	const char* data() const;
+	size_t size() const;
+
+private:
+	void* m_view;
+	size_t m_size;
+	bool m_isOpen;
+
+#ifdef _WIN32
+	void* m_fileHandle;
+	void* m_mappingHandle;
+#endif // _WIN32
+};
@@ -1,15 +1,15 @@
 #include "Window.h"
 #include "VulkanException.h"
 #include "FileReader.h"
+#include "image/ImageLoader.h"
+#include "profiling/Profiler.h"
 
 #include <iostream>
 #include <vector>
 #include <set>
 #include <string>
 #include <algorithm>
-
-
-#include <ctime>
+#include <cstring>
 
 #define CALL_VK(result)														\
     if (VK_SUCCESS != (result)) {											\
@@ -18,73 +18,22 @@
         }
 
 
-class Profiler
-{
-public:
-	Profiler(uint16_t nIterations = 1000) :
-		nIterations_(nIterations),
-		currentIteration_(0),
-		timePassed_(0)
-	{
-		std::streambuf* orig_buff = std::cout.rdbuf();
-		std::cout.rdbuf(NULL);
-
-		uint32_t iterToTest = 1000;
-		std::clock_t startTime = std::clock();
-		for (uint32_t i = 0; i < iterToTest; ++i)
-		{
-			for (uint32_t j = 0; j < nIterations_; ++j)
-			{
-				start();
-				end();
-			}
-		}
-		std::clock_t timePassed = std::clock() - startTime;
-		timeToIgnore_ = (double)(timePassed / iterToTest);
-
-		std::cout.rdbuf(orig_buff);
-
-		startClock_ = clock();
-		timePassed_ = 0;
-		currentIteration_ = 0;
-	}
-
-	void start()
-	{
-		startClock_ = std::clock();
-	}
-
-	void end()
-	{
-		timePassed_ += (double)(std::clock() - startClock_);
-		++currentIteration_;
-
-		if (currentIteration_ == nIterations_)
-		{
-			std::cout << "\nFPS: " << 1000.0 / (((timePassed_ - timeToIgnore_) / nIterations_));
-			currentIteration_ = 0;
-			timePassed_ = 0;
-		}
-	}
-
-private:
-
-	const uint16_t nIterations_;
-	uint16_t currentIteration_;
-
-	double timeToIgnore_;
-
-	std::clock_t startClock_;
-	double timePassed_;
-};
+const uint32_t MAX_FRAMES_IN_FLIGHT = 5;
 
+const uint32_t MAX_INSTANCES_PER_FRAME = 65536;
 
-const uint32_t MAX_FRAMES_IN_FLIGHT = 5;
+// Below this a secondary buffer costs more than it saves
+const uint32_t MIN_DRAWS_PER_BATCH = 256;
 
 const std::vector<const char*> DEVICE_EXTENSIONS({
 	VK_KHR_SWAPCHAIN_EXTENSION_NAME
 	});
 
+// Enabled when present
+const std::vector<const char*> OPTIONAL_DEVICE_EXTENSIONS({
+	VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME
+	});
+
 
 #ifndef NDEBUG
 /*
@@ -191,42 +140,74 @@ void framebufferResizeCallback(GLFWwindow* window, int width, int height)
 	windowObject->setResized();
 }
 
+void cursorPositionCallback(GLFWwindow* window, double x, double y)
+{
+	Window* windowObject = reinterpret_cast<Window*>(glfwGetWindowUserPointer(window));
+	windowObject->setCursorPosition(x, y);
+}
+
+void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
+{
+	Window* windowObject = reinterpret_cast<Window*>(glfwGetWindowUserPointer(window));
+	windowObject->setMouseButton(button, action == GLFW_PRESS);
+}
+
 
 
 const VkFormat IMAGE_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
 
+// Color attachment support is mandatory for this one
+const VkFormat OFFSCREEN_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
 
-Window::Window(int width, int heigth) :
-	m_xpos(0),
-	m_ypos(0),
-	m_isPressed(false),
 
+Window::Window(int width, int heigth, bool isHeadless) :
 	m_width(width),
 	m_height(heigth),
-	m_camera(width, heigth),
+	m_simulation((float)width, (float)heigth),
+	m_snapshot(nullptr),
+
+	m_isHeadless(isHeadless),
 
 	m_window(nullptr),
 	m_surface(VK_NULL_HANDLE),
 	m_instance(VK_NULL_HANDLE),
 
-	m_commandPool(VK_NULL_HANDLE),
+	m_physicalDevice(VK_NULL_HANDLE),
+	m_logicalDevice(VK_NULL_HANDLE),
+
 	m_swapchain(VK_NULL_HANDLE),
 
+	m_commandPools(MAX_FRAMES_IN_FLIGHT, VK_NULL_HANDLE),
+	m_commandBuffers(MAX_FRAMES_IN_FLIGHT, VK_NULL_HANDLE),
+
+	m_isGpuCulling(false),
+	m_hasDrawIndirectCount(false),
+	m_hasMultiDrawIndirect(false),
+	m_hasDrawIndirectFirstInstance(false),
+
 	m_semaphoresImageAvailable(MAX_FRAMES_IN_FLIGHT),
 	m_semaphoresRenderFinished(MAX_FRAMES_IN_FLIGHT),
 	m_inFlightFences(MAX_FRAMES_IN_FLIGHT),
 
 	m_currentFrameIndex(0),
+	m_framesInFlight(MAX_FRAMES_IN_FLIGHT),
+
+	m_meshLibrary(MeshVertex::getMeshLayout(), MeshVertex::STRIDE, Vertex::getEncoding<MeshVertex>()),
+
+	m_textureFormat(IMAGE_FORMAT),
+	m_textureMipLevels(1)
+{
+	m_framePacer.init(MAX_FRAMES_IN_FLIGHT);
+	m_framesInFlight = m_framePacer.getFramesInFlight();
 
-	m_vertices({
+	std::vector<MeshVertex> quadVertices = {
 		{{-0.5f, -0.5f, 0.0f }, {1.0f, 0.0f, 0.0f}, {1.0f, 0.0f}},
 		{{0.5f, -0.5f, 0.0f }, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f}},
 		{{0.5f, 0.5f, 0.0f }, {0.0f, 0.0f, 1.0f}, {0.0f, 1.0f}},
 		{{-0.5f, 0.5f, 0.0f }, {1.0f, 1.0f, 1.0f}, {1.0f, 1.0f}},
-		}),
+	};
 
-	m_indexes({ 0, 1, 2, 0, 2, 3 })
-{
+	m_meshLibrary.add(quadVertices.data(), (uint32_t)quadVertices.size(), { 0, 1, 2, 0, 2, 3 });
 }
 
 void Window::init()
@@ -260,14 +241,24 @@ void Window::init()
 	}
 #endif // !NDEBUG
 
-	glfwInit();
+	if (!m_isHeadless)
+	{
+		glfwInit();
+	}
 
 
 	createInstance();
 	createWindow();
 	createDevice();
+	m_allocator.init(m_physicalDevice, m_logicalDevice);
+	m_pipelineCache.init(m_physicalDevice, m_logicalDevice, "pipeline_cache.bin");
+	m_gpuTimer.init(m_physicalDevice, m_logicalDevice, m_queueFamilyIndexes.graphical, MAX_FRAMES_IN_FLIGHT);
+	m_uploadEngine.init(m_logicalDevice, m_allocator,
+		m_queueFamilyIndexes.transfer, m_transferQueue,
+		m_queueFamilyIndexes.graphical, m_graphicsQueue);
 	createSwapChain();
 	m_imageViews = createImageViews(m_logicalDevice, m_images, m_swapchainSupportDetails);
+	createReadbackBuffers();
 	createRenderPass();
 	createDescriptorSetLayout();
 	createGraphicsPipeline("shaders/bin/triangle.vert.spv", "shaders/bin/triangle.frag.spv");
@@ -275,39 +266,69 @@ void Window::init()
 	createDepthResources();
 
 	createFramebuffers();
-	createCommandPool();
+	m_jobSystem.init();
+	createCommandPools();
 
 	createTextureImage();
 	createTextureImageView();
 	createTextureSampler();
 
-	createVertexBuffer();
-	createIndexBuffer();
+	createMeshBuffers();
+	m_uploadEngine.flush().wait();
+
 	createUniformBuffers();
+	createGpuCuller("shaders/bin/cull.comp.spv");
 	createDescriptorPool();
 	createDescriptorSets();
 
 	createCommandBuffers();
 	createSyncObjects();
+
+	m_simulation.start();
 }
 
 void Window::destroy()
 {
+	m_simulation.stop();
+
 	cleanupSwapChain();
+	if (m_isHeadless)
+	{
+		for (size_t i = 0; i < m_images.size(); ++i)
+		{
+			vkDestroyImage(m_logicalDevice, m_images[i], nullptr);
+			m_allocator.free(m_offscreenImageMemories[i]);
+
+			vkDestroyBuffer(m_logicalDevice, m_readbackBuffers[i], nullptr);
+			m_allocator.free(m_readbackMemories[i]);
+		}
+	}
+	else
+	{
+		vkDestroySwapchainKHR(m_logicalDevice, m_swapchain, nullptr);
+	}
+
+	vkDestroyPipeline(m_logicalDevice, m_graphicsPipeline, nullptr);
+	vkDestroyPipelineLayout(m_logicalDevice, m_pipelineLayout, nullptr);
+	vkDestroyRenderPass(m_logicalDevice, m_renderPass, nullptr);
+
+	m_uniformRing.destroy(m_allocator);
+	m_instanceRing.destroy(m_allocator);
+	if (m_isGpuCulling)
+	{
+		m_gpuCuller.destroy(m_allocator);
+	}
+	vkDestroyDescriptorPool(m_logicalDevice, m_descriptorPool, nullptr);
 
 	vkDestroySampler(m_logicalDevice, m_textureSampler, nullptr);
 	vkDestroyImageView(m_logicalDevice, m_textureImageView, nullptr);
 
 	vkDestroyImage(m_logicalDevice, m_textureImage, nullptr);
-	vkFreeMemory(m_logicalDevice, m_textureImageMemory, nullptr);
+	m_allocator.free(m_textureImageMemory);
 
 	vkDestroyDescriptorSetLayout(m_logicalDevice, m_uboDescriptorSetLayout, nullptr);
 
-	vkDestroyBuffer(m_logicalDevice, m_vertexBuffer, nullptr);
-	vkFreeMemory(m_logicalDevice, m_vertexBufferMemory, nullptr);
-
-	vkDestroyBuffer(m_logicalDevice, m_indexBuffer, nullptr);
-	vkFreeMemory(m_logicalDevice, m_indexBufferMemory, nullptr);
+	m_meshLibrary.destroy(m_allocator);
 
 	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
 	{
@@ -316,7 +337,22 @@ void Window::destroy()
 		vkDestroyFence(m_logicalDevice, m_inFlightFences[i], nullptr);
 	}
 
-	vkDestroyCommandPool(m_logicalDevice, m_commandPool, nullptr);
+	for (VkCommandPool commandPool : m_commandPools)
+	{
+		vkDestroyCommandPool(m_logicalDevice, commandPool, nullptr);
+	}
+
+	for (VkCommandPool commandPool : m_secondaryCommandPools)
+	{
+		vkDestroyCommandPool(m_logicalDevice, commandPool, nullptr);
+	}
+
+	m_jobSystem.destroy();
+
+	m_uploadEngine.destroy();
+	m_gpuTimer.destroy();
+	m_pipelineCache.destroy();
+	m_allocator.destroy();
 	vkDestroyDevice(m_logicalDevice, nullptr);
 
 #ifndef NDEBUG
@@ -326,118 +362,116 @@ void Window::destroy()
 	vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
 	vkDestroyInstance(m_instance, nullptr);
 
-	glfwDestroyWindow(m_window);
+	if (!m_isHeadless)
+	{
+		glfwDestroyWindow(m_window);
 
-	glfwTerminate();
+		glfwTerminate();
+	}
 }
 
 bool Window::isOpen()
 {
-	return glfwWindowShouldClose(m_window) == 0;
+	// Headless frames are counted by the application
+	return m_isHeadless || glfwWindowShouldClose(m_window) == 0;
 }
 
-static glm::mat4 mooodel = glm::mat4(1);
-
 
 
-Profiler profiler(500);
-
-#include <thread>
-
 void Window::draw()
 {
-	profiler.start();
-	double xpos, ypos;
-	glfwGetCursorPos(m_window, &xpos, &ypos);
+	Profiler::beginZone("limiter");
+	m_framePacer.waitForNextFrame();
+	Profiler::endZone();
 
-	if (glfwGetMouseButton(m_window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS)
-	{
-		printf("sleep\n");
-		std::this_thread::sleep_for(std::chrono::milliseconds(10));
-	}
+	Profiler::markFrame();
+	PROFILE_ZONE("draw");
 
-	bool isPressed = glfwGetMouseButton(m_window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS;
-	if (isPressed && !m_isPressed)
-	{
-		m_xpos = xpos;
-		m_ypos = ypos;
-	}
+	Profiler::beginZone("fence wait");
+	vkWaitForFences(m_logicalDevice, 1, &m_inFlightFences[m_currentFrameIndex], VK_TRUE, UINT64_MAX);
+	Profiler::endZone();
 
-	m_isPressed = isPressed;
+	m_framePacer.collectLatency(m_logicalDevice, m_inFlightFences);
 
-	if (isPressed)
+	// Callbacks only store the input, the simulation thread applies it
+	if (!m_isHeadless)
 	{
-		float force = 0.005;
-		m_camera.rotate(force * (xpos - m_xpos), force * (ypos - m_ypos));
+		glfwPollEvents();
 	}
 
-	m_xpos = xpos;
-	m_ypos = ypos;
-
-	glfwPollEvents();
-	vkWaitForFences(m_logicalDevice, 1, &m_inFlightFences[m_currentFrameIndex], VK_TRUE, UINT64_MAX);
-
-	uint32_t imageIndex;
-	VkResult imageResult = vkAcquireNextImageKHR(m_logicalDevice, m_swapchain, UINT64_MAX,
-		m_semaphoresImageAvailable[m_currentFrameIndex], VK_NULL_HANDLE, &imageIndex);
+	// Taken after the wait, the frame is built from the freshest tick
+	m_snapshot = &m_simulation.acquireSnapshot();
 
-	if (imageResult == VK_ERROR_OUT_OF_DATE_KHR)
+	// Offscreen images are owned by the frame in flight, nothing to acquire
+	uint32_t imageIndex = m_currentFrameIndex;
+	if (m_isHeadless)
 	{
-		recreateSwapChain();
-		return;
+		deliverReadback(m_currentFrameIndex);
 	}
-	else if (imageResult != VK_SUCCESS && imageResult != VK_SUBOPTIMAL_KHR)
+	else
 	{
-		throw VulkanException("Failed to acquire next image.");
+		PROFILE_ZONE("acquire");
+		VkResult imageResult = vkAcquireNextImageKHR(m_logicalDevice, m_swapchain, UINT64_MAX,
+			m_semaphoresImageAvailable[m_currentFrameIndex], VK_NULL_HANDLE, &imageIndex);
+
+		if (imageResult == VK_ERROR_OUT_OF_DATE_KHR)
+		{
+			recreateSwapChain();
+			return;
+		}
+		else if (imageResult != VK_SUCCESS && imageResult != VK_SUBOPTIMAL_KHR)
+		{
+			throw VulkanException("Failed to acquire next image.");
+		}
 	}
 
 
-	if (m_imagesInFlight[imageIndex] != VK_NULL_HANDLE)
+	// The frame's fence has signaled, everything recorded from these pools is done
+	vkResetCommandPool(m_logicalDevice, m_commandPools[m_currentFrameIndex], 0);
+
+	uint32_t threadCount = m_jobSystem.getThreadCount();
+	for (uint32_t i = 0; i < threadCount; ++i)
 	{
-		vkWaitForFences(m_logicalDevice, 1, &m_imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
+		vkResetCommandPool(m_logicalDevice, m_secondaryCommandPools[m_currentFrameIndex * threadCount + i], 0);
 	}
+	m_uniformRing.beginFrame(m_currentFrameIndex);
+	m_instanceRing.beginFrame(m_currentFrameIndex);
 
-	m_imagesInFlight[imageIndex] = m_inFlightFences[m_currentFrameIndex];
-
-	/////////////////////////////////
-	UniformBufferObject ubo = {};
-	mooodel = glm::rotate_slow(mooodel, glm::pi<float>() / 1800, glm::vec3(0, 0, 1));
-	ubo.model = mooodel;
-	ubo.view = m_camera.getView();
-	ubo.projection = m_camera.getProjection();
-	ubo.projection[1][1] *= -1;
+	Profiler::beginZone("record");
+	recordCommandBuffer(m_commandBuffers[m_currentFrameIndex], imageIndex);
+	Profiler::endZone();
 
-	void* data;
-	vkMapMemory(m_logicalDevice, m_uniformBuffersMemory[(imageIndex * 2)], 0, sizeof(ubo), 0, &data);
-	memcpy(data, &ubo, sizeof(ubo));
-	vkUnmapMemory(m_logicalDevice, m_uniformBuffersMemory[(imageIndex * 2)]);
-	/////////////////////////////////
-	/////////////////////////////////
-	ubo.model = glm::mat4(1);
-	ubo.model = glm::translate(ubo.model, { 1,2,-1 });
-
-	vkMapMemory(m_logicalDevice, m_uniformBuffersMemory[(imageIndex * 2) + 1], 0, sizeof(ubo), 0, &data);
-	memcpy(data, &ubo, sizeof(ubo));
-	vkUnmapMemory(m_logicalDevice, m_uniformBuffersMemory[(imageIndex * 2) + 1]);
-	/////////////////////////////////
-	
 	VkSubmitInfo submitInfo = {};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 	VkPipelineStageFlags waitFlag = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	submitInfo.waitSemaphoreCount = 1;
+	submitInfo.waitSemaphoreCount = m_isHeadless ? 0 : 1;
 	submitInfo.pWaitSemaphores = &m_semaphoresImageAvailable[m_currentFrameIndex];
 	submitInfo.pWaitDstStageMask = &waitFlag;
 
 	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &m_commandBuffers[imageIndex];
+	submitInfo.pCommandBuffers = &m_commandBuffers[m_currentFrameIndex];
 
-	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.signalSemaphoreCount = m_isHeadless ? 0 : 1;
 	submitInfo.pSignalSemaphores = &m_semaphoresRenderFinished[m_currentFrameIndex];
 
+	Profiler::beginZone("submit");
+	// Marked once the frame is sure to be submitted, an out of date acquire drops it
+	m_framePacer.markInput(m_currentFrameIndex, m_snapshot->inputTime);
+	m_gpuTimer.markSubmit();
 	vkResetFences(m_logicalDevice, 1, &m_inFlightFences[m_currentFrameIndex]);
-	if (vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, m_inFlightFences[m_currentFrameIndex]) != VK_SUCCESS)
 	{
-		throw VulkanException("Failed to submit draw command buffer.");
+		std::lock_guard<std::mutex> queueLock(m_uploadEngine.getQueueMutex());
+		if (vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, m_inFlightFences[m_currentFrameIndex]) != VK_SUCCESS)
+		{
+			throw VulkanException("Failed to submit draw command buffer.");
+		}
+	}
+	Profiler::endZone();
+
+	if (m_isHeadless)
+	{
+		m_currentFrameIndex = (m_currentFrameIndex + 1) % m_framesInFlight;
+		return;
 	}
 
 	VkPresentInfoKHR presentInfo = {};
@@ -449,7 +483,14 @@ void Window::draw()
 	presentInfo.pSwapchains = &m_swapchain;
 	presentInfo.pImageIndices = &imageIndex;
 
-	imageResult = vkQueuePresentKHR(m_presentQueue, &presentInfo);
+	Profiler::beginZone("present");
+	VkResult imageResult;
+	{
+		// The present queue is usually the graphics queue
+		std::lock_guard<std::mutex> queueLock(m_uploadEngine.getQueueMutex());
+		imageResult = vkQueuePresentKHR(m_presentQueue, &presentInfo);
+	}
+	Profiler::endZone();
 
 	if (imageResult == VK_ERROR_OUT_OF_DATE_KHR || imageResult == VK_SUBOPTIMAL_KHR || m_framebufferResized)
 	{
@@ -461,8 +502,68 @@ void Window::draw()
 		throw VulkanException("Failder to present image.");
 	}
 
-	m_currentFrameIndex = (m_currentFrameIndex + 1) % MAX_FRAMES_IN_FLIGHT;
-	profiler.end();
+	m_currentFrameIndex = (m_currentFrameIndex + 1) % m_framesInFlight;
+}
+
+bool Window::isHeadless() const
+{
+	return m_isHeadless;
+}
+
+void Window::setFrameReadback(const FrameReadback& frameReadback)
+{
+	m_frameReadback = frameReadback;
+}
+
+void Window::flushReadbacks()
+{
+	vkWaitForFences(m_logicalDevice, MAX_FRAMES_IN_FLIGHT, m_inFlightFences.data(), VK_TRUE, UINT64_MAX);
+
+	// Oldest frame first
+	for (uint32_t i = 0; i < m_framesInFlight; ++i)
+	{
+		deliverReadback((m_currentFrameIndex + i) % m_framesInFlight);
+	}
+}
+
+void Window::setPacingMode(PacingMode mode)
+{
+	m_framePacer.setMode(mode);
+	if (m_logicalDevice == VK_NULL_HANDLE)
+	{
+		m_framesInFlight = m_framePacer.getFramesInFlight();
+		return;
+	}
+
+	// Every slot is idle once flushed, the frame index can start over
+	flushReadbacks();
+	m_framesInFlight = m_framePacer.getFramesInFlight();
+	m_currentFrameIndex = 0;
+
+	if (!m_isHeadless)
+	{
+		recreateSwapChain();
+	}
+}
+
+void Window::setFrameLimit(double framesPerSecond)
+{
+	m_framePacer.setFrameLimit(framesPerSecond);
+}
+
+void Window::deliverReadback(uint32_t frameIndex)
+{
+	if (!m_isHeadless || !m_isReadbackPending[frameIndex])
+	{
+		return;
+	}
+
+	m_isReadbackPending[frameIndex] = false;
+	if (m_frameReadback)
+	{
+		m_frameReadback(static_cast<const uint8_t*>(m_readbackMemories[frameIndex].mapped),
+			m_swapchainSupportDetails.extent.width, m_swapchainSupportDetails.extent.height);
+	}
 }
 
 VkDevice Window::getDevice()
@@ -470,11 +571,41 @@ VkDevice Window::getDevice()
 	return m_logicalDevice;
 }
 
+void Window::setSceneUpdate(const SceneUpdate& sceneUpdate)
+{
+	m_simulation.setSceneUpdate(sceneUpdate);
+}
+
+uint32_t Window::loadMesh(const char* relativePath)
+{
+	return m_meshLibrary.load(relativePath);
+}
+
+uint32_t Window::addMesh(const std::vector<MeshVertex>& vertices, const std::vector<uint32_t>& indices, bool isOptimized)
+{
+	return m_meshLibrary.add(vertices.data(), (uint32_t)vertices.size(), indices, isOptimized);
+}
+
 void Window::setResized()
 {
 	m_framebufferResized = true;
 }
 
+void Window::setCursorPosition(double x, double y)
+{
+	InputState& input = m_simulation.getInput();
+	input.cursorX.store(x, std::memory_order_relaxed);
+	input.cursorY.store(y, std::memory_order_relaxed);
+}
+
+void Window::setMouseButton(int button, bool isPressed)
+{
+	if (button == GLFW_MOUSE_BUTTON_RIGHT)
+	{
+		m_simulation.getInput().isRotating.store(isPressed, std::memory_order_relaxed);
+	}
+}
+
 void Window::createInstance()
 {
 #ifndef NDEBUG
@@ -507,8 +638,9 @@ void Window::createInstance()
 	instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
 	instanceCreateInfo.pApplicationInfo = &appInfo;
 
+	// GLFW is not initialized without a window
 	uint32_t glfwExtentionCount = 0;
-	const char** glfwExtentions = glfwGetRequiredInstanceExtensions(&glfwExtentionCount);
+	const char** glfwExtentions = m_isHeadless ? nullptr : glfwGetRequiredInstanceExtensions(&glfwExtentionCount);
 
 	std::vector<const char*> requiredExtensions(glfwExtentions, glfwExtentions + glfwExtentionCount);
 
@@ -550,12 +682,19 @@ void Window::createInstance()
 
 void Window::createWindow()
 {
+	if (m_isHeadless)
+	{
+		return;
+	}
+
 	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
 	glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
 
 	m_window = glfwCreateWindow(m_width, m_height, "Vulkan", nullptr, nullptr);
 	glfwSetWindowUserPointer(m_window, this);
 	glfwSetFramebufferSizeCallback(m_window, framebufferResizeCallback);
+	glfwSetCursorPosCallback(m_window, cursorPositionCallback);
+	glfwSetMouseButtonCallback(m_window, mouseButtonCallback);
 
 	if (m_window == nullptr)
 	{
@@ -622,15 +761,22 @@ void Window::createDevice()
 	// Queues
 	vkGetDeviceQueue(m_logicalDevice, m_queueFamilyIndexes.graphical, 0, &m_graphicsQueue);
 	vkGetDeviceQueue(m_logicalDevice, m_queueFamilyIndexes.present, 0, &m_presentQueue);
+	vkGetDeviceQueue(m_logicalDevice, m_queueFamilyIndexes.transfer, 0, &m_transferQueue);
 }
 
-void Window::createSwapChain()
+void Window::createSwapChain(VkSwapchainKHR oldSwapchain)
 {
+	if (m_isHeadless)
+	{
+		createOffscreenImages();
+		return;
+	}
+
 	// Swapchain
 	glfwGetFramebufferSize(m_window, &m_width, &m_height);
 	m_swapchainSupportDetails = getSwapChainSupportDetails(m_physicalDevice, m_surface, m_width, m_height);
 
-	m_swapchain = createSwapchain(VK_NULL_HANDLE, m_swapchainSupportDetails, m_logicalDevice, m_surface, m_queueFamilyIndexes);
+	m_swapchain = createSwapchain(oldSwapchain, m_swapchainSupportDetails, m_logicalDevice, m_surface, m_queueFamilyIndexes);
 
 	// Images TODO
 	uint32_t nImages = 0;
@@ -639,13 +785,56 @@ void Window::createSwapChain()
 	vkGetSwapchainImagesKHR(m_logicalDevice, m_swapchain, &nImages, m_images.data());
 }
 
+void Window::createOffscreenImages()
+{
+	m_swapchainSupportDetails = {};
+	m_swapchainSupportDetails.surfaceFormat = { OFFSCREEN_FORMAT, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR };
+	m_swapchainSupportDetails.presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+	m_swapchainSupportDetails.extent = { (uint32_t)m_width, (uint32_t)m_height };
+
+	m_images.resize(MAX_FRAMES_IN_FLIGHT);
+	m_offscreenImageMemories.resize(MAX_FRAMES_IN_FLIGHT);
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+	{
+		createImage(
+			m_swapchainSupportDetails.extent.width, m_swapchainSupportDetails.extent.height, 1,
+			OFFSCREEN_FORMAT,
+			VK_IMAGE_TILING_OPTIMAL,
+			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			&m_images[i],
+			&m_offscreenImageMemories[i]
+		);
+	}
+}
+
+void Window::createReadbackBuffers()
+{
+	if (!m_isHeadless)
+	{
+		return;
+	}
+
+	VkDeviceSize frameSize = (VkDeviceSize)m_swapchainSupportDetails.extent.width * m_swapchainSupportDetails.extent.height * 4;
+
+	m_readbackBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+	m_readbackMemories.resize(MAX_FRAMES_IN_FLIGHT);
+	m_isReadbackPending.assign(MAX_FRAMES_IN_FLIGHT, false);
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+	{
+		createBuffer(frameSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			&m_readbackBuffers[i], &m_readbackMemories[i]);
+	}
+}
+
 std::vector<VkImageView> Window::createImageViews(VkDevice logicalDevice, std::vector<VkImage>& images, SwapChainSupportDetails& swapchainSupportDetails)
 {
 	std::vector<VkImageView> imageViews(images.size());
 
 	for (int i = imageViews.size() - 1; i >= 0; --i)
 	{
-		imageViews[i] = createImageView(images[i], swapchainSupportDetails.surfaceFormat.format, VK_IMAGE_ASPECT_COLOR_BIT);
+		imageViews[i] = createImageView(images[i], swapchainSupportDetails.surfaceFormat.format, VK_IMAGE_ASPECT_COLOR_BIT, 1);
 	}
 
 	return imageViews;
@@ -663,7 +852,7 @@ void Window::createRenderPass()
 	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	colorAttachment.finalLayout = m_isHeadless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
 	VkAttachmentDescription& depthAttachment = attachments[1];
 	depthAttachment.format = findDepthFormat();
@@ -702,7 +891,9 @@ void Window::createRenderPass()
 	renderPassCreateInfo.subpassCount = 1;
 	renderPassCreateInfo.pSubpasses = &subpass;
 
-	VkSubpassDependency dependency = {};
+	std::vector<VkSubpassDependency> dependencies(1, VkSubpassDependency());
+
+	VkSubpassDependency& dependency = dependencies[0];
 	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
 	dependency.dstSubpass = 0;
 	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
@@ -710,8 +901,22 @@ void Window::createRenderPass()
 	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
 	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
 
-	renderPassCreateInfo.dependencyCount = 1;
-	renderPassCreateInfo.pDependencies = &dependency;
+	// Offscreen images are copied out right after the pass
+	if (m_isHeadless)
+	{
+		VkSubpassDependency readbackDependency = {};
+		readbackDependency.srcSubpass = 0;
+		readbackDependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+		readbackDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		readbackDependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		readbackDependency.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		readbackDependency.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+		dependencies.push_back(readbackDependency);
+	}
+
+	renderPassCreateInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+	renderPassCreateInfo.pDependencies = dependencies.data();
 
 	if (vkCreateRenderPass(m_logicalDevice, &renderPassCreateInfo, nullptr, &m_renderPass) != VK_SUCCESS)
 	{
@@ -725,7 +930,7 @@ void Window::createDescriptorSetLayout()
 
 	VkDescriptorSetLayoutBinding& uboLayoutBinding = bindings[0];
 	uboLayoutBinding.binding = 0;
-	uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 	uboLayoutBinding.descriptorCount = 1;
 	uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 	uboLayoutBinding.pImmutableSamplers = nullptr;
@@ -764,13 +969,33 @@ void Window::createGraphicsPipeline(const char* vertexPath, const char* fragment
 	////// VERTEX ATTRIBUTES //////
 	///////////////////////////////
 
-	VkVertexInputBindingDescription bindingDescription = Vertex::getBindingDescription();
-	std::vector<VkVertexInputAttributeDescription> attributeDescriptions = Vertex::getAttributeDescriptions();
+	// One InstanceData per instance in binding 1
+	VkVertexInputBindingDescription instanceBindingDescription = {};
+	instanceBindingDescription.binding = 1;
+	instanceBindingDescription.stride = sizeof(InstanceData);
+	instanceBindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+	std::vector<VkVertexInputBindingDescription> bindingDescriptions = { Vertex::getBindingDescription(0), instanceBindingDescription };
+
+	auto vertexAttributeDescriptions = Vertex::getAttributeDescriptions(0);
+	std::vector<VkVertexInputAttributeDescription> attributeDescriptions(vertexAttributeDescriptions.begin(), vertexAttributeDescriptions.end());
+
+	// MODEL, one location per column
+	for (uint32_t column = 0; column < 4; ++column)
+	{
+		VkVertexInputAttributeDescription modelDescription = {};
+		modelDescription.binding = 1;
+		modelDescription.location = Vertex::ATTRIBUTE_COUNT + column;
+		modelDescription.format = VK_FORMAT_R32G32B32A32_SFLOAT;
+		modelDescription.offset = offsetof(InstanceData, model) + column * sizeof(glm::vec4);
+
+		attributeDescriptions.push_back(modelDescription);
+	}
 
 	VkPipelineVertexInputStateCreateInfo vertexInputCreateInfo = {};
 	vertexInputCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	vertexInputCreateInfo.vertexBindingDescriptionCount = 1;
-	vertexInputCreateInfo.pVertexBindingDescriptions = &bindingDescription;
+	vertexInputCreateInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
+	vertexInputCreateInfo.pVertexBindingDescriptions = bindingDescriptions.data();
 	vertexInputCreateInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
 	vertexInputCreateInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
@@ -780,24 +1005,13 @@ void Window::createGraphicsPipeline(const char* vertexPath, const char* fragment
 	inputAssemblyCreateInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
 	inputAssemblyCreateInfo.primitiveRestartEnable = VK_FALSE;
 
-	VkViewport viewport = {};
-	viewport.x = 0.0f;
-	viewport.y = 0.0f;
-	viewport.width = (float)m_swapchainSupportDetails.extent.width;
-	viewport.height = (float)m_swapchainSupportDetails.extent.height;
-	viewport.minDepth = 0.0f;
-	viewport.maxDepth = 1.0f;
-
-	VkRect2D scissor = {};
-	scissor.offset = { 0, 0 };
-	scissor.extent = m_swapchainSupportDetails.extent;
-
+	// Viewport and scissor are set when recording, the pipeline survives resizes
 	VkPipelineViewportStateCreateInfo viewportStateCreateInfo = {};
 	viewportStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
 	viewportStateCreateInfo.viewportCount = 1;
-	viewportStateCreateInfo.pViewports = &viewport;
+	viewportStateCreateInfo.pViewports = nullptr;
 	viewportStateCreateInfo.scissorCount = 1;
-	viewportStateCreateInfo.pScissors = &scissor;
+	viewportStateCreateInfo.pScissors = nullptr;
 
 	VkPipelineRasterizationStateCreateInfo rasterizerCreateInfo = {};
 	rasterizerCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
@@ -847,11 +1061,11 @@ void Window::createGraphicsPipeline(const char* vertexPath, const char* fragment
 	colorBlendingCreateInfo.blendConstants[2] = 0.0f;
 	colorBlendingCreateInfo.blendConstants[3] = 0.0f;
 
-	VkDynamicState dynamicState = VK_DYNAMIC_STATE_VIEWPORT;
+	std::array<VkDynamicState, 2> dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
 	VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo = {};
 	dynamicStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-	dynamicStateCreateInfo.dynamicStateCount = 1;
-	dynamicStateCreateInfo.pDynamicStates = &dynamicState;
+	dynamicStateCreateInfo.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+	dynamicStateCreateInfo.pDynamicStates = dynamicStates.data();
 
 	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
 	pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -895,14 +1109,14 @@ void Window::createGraphicsPipeline(const char* vertexPath, const char* fragment
 	graphicsPipelineCreateInfo.pMultisampleState = &multisamplingCreateInfo;
 	graphicsPipelineCreateInfo.pDepthStencilState = &depthStencilCreateInfo;
 	graphicsPipelineCreateInfo.pColorBlendState = &colorBlendingCreateInfo;
-	graphicsPipelineCreateInfo.pDynamicState = nullptr;
+	graphicsPipelineCreateInfo.pDynamicState = &dynamicStateCreateInfo;
 	graphicsPipelineCreateInfo.layout = m_pipelineLayout;
 	graphicsPipelineCreateInfo.renderPass = m_renderPass;
 	graphicsPipelineCreateInfo.subpass = 0;
 	graphicsPipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
 	graphicsPipelineCreateInfo.basePipelineIndex = -1;
 
-	if (vkCreateGraphicsPipelines(m_logicalDevice, VK_NULL_HANDLE, 1, &graphicsPipelineCreateInfo, nullptr, &m_graphicsPipeline) != VK_SUCCESS)
+	if (vkCreateGraphicsPipelines(m_logicalDevice, m_pipelineCache.getHandle(), 1, &graphicsPipelineCreateInfo, nullptr, &m_graphicsPipeline) != VK_SUCCESS)
 	{
 		throw VulkanException("Failed to create graphics pipeline.");
 	}
@@ -935,16 +1149,29 @@ void Window::createFramebuffers()
 	}
 }
 
-void Window::createCommandPool()
+void Window::createCommandPools()
 {
 	VkCommandPoolCreateInfo commandPoolCreateInfo = {};
 	commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
 	commandPoolCreateInfo.queueFamilyIndex = m_queueFamilyIndexes.graphical;
-	commandPoolCreateInfo.flags = 0;
+	commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+	for (VkCommandPool& commandPool : m_commandPools)
+	{
+		if (vkCreateCommandPool(m_logicalDevice, &commandPoolCreateInfo, nullptr, &commandPool) != VK_SUCCESS)
+		{
+			throw VulkanException("Failed to create command pool.");
+		}
+	}
 
-	if (vkCreateCommandPool(m_logicalDevice, &commandPoolCreateInfo, nullptr, &m_commandPool) != VK_SUCCESS)
+	// Pools are externally synchronized, each recording thread gets its own
+	m_secondaryCommandPools.resize(MAX_FRAMES_IN_FLIGHT * m_jobSystem.getThreadCount());
+	for (VkCommandPool& commandPool : m_secondaryCommandPools)
 	{
-		throw VulkanException("Failed to create command pool.");
+		if (vkCreateCommandPool(m_logicalDevice, &commandPoolCreateInfo, nullptr, &commandPool) != VK_SUCCESS)
+		{
+			throw VulkanException("Failed to create command pool.");
+		}
 	}
 }
 
@@ -954,7 +1181,7 @@ void Window::createDepthResources()
 	VkFormat depthFormat = findDepthFormat();
 
 	createImage(
-		m_swapchainSupportDetails.extent.width, m_swapchainSupportDetails.extent.height,
+		m_swapchainSupportDetails.extent.width, m_swapchainSupportDetails.extent.height, 1,
 		depthFormat,
 		VK_IMAGE_TILING_OPTIMAL,
 		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
@@ -963,48 +1190,79 @@ void Window::createDepthResources()
 		&m_depthImageMemory
 	);
 
-	m_depthImageView = createImageView(m_depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
+	m_depthImageView = createImageView(m_depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
 }
 
 void Window::createTextureImage()
 {
-	Image texture = FileReader::readImage("resources/maggie.png");
+	// Compressed and mipmapped offline, the PNG is the fallback when the device can't sample the format
+	KtxImage compressedTexture;
+	if (FileReader::tryReadKtxImage("resources/maggie.ktx2", compressedTexture) && isFormatSampleable(compressedTexture.format))
+	{
+		m_textureFormat = compressedTexture.format;
+		m_textureMipLevels = compressedTexture.mipLevels;
 
-	VkDeviceSize textureSize = texture.width * texture.height * 4;
-	
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-	createBuffer(textureSize,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		&stagingBuffer, &stagingBufferMemory);
+		createImage(
+			compressedTexture.width, compressedTexture.height, m_textureMipLevels,
+			m_textureFormat,
+			VK_IMAGE_TILING_OPTIMAL,
+			VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			&m_textureImage, &m_textureImageMemory);
 
-	void* data;
-	vkMapMemory(m_logicalDevice, stagingBufferMemory, 0, textureSize, 0, &data);
-	memcpy(data, texture.pixels, textureSize);
-	vkUnmapMemory(m_logicalDevice, stagingBufferMemory);
+		m_uploadEngine.uploadImage(m_textureImage, compressedTexture.width, compressedTexture.height, compressedTexture.levelOffsets,
+			compressedTexture.getLevelData(), compressedTexture.getLevelDataSize());
 
-	texture.free();
+		return;
+	}
+
+	// Decoded at the file's channel count, expanded to RGBA while being written into staging
+	ImageLoader imageLoader(m_jobSystem);
+	Image texture = imageLoader.decode({ "resources/maggie.png" })[0];
+
+	m_textureFormat = IMAGE_FORMAT;
+	m_textureMipLevels = Image::getMipLevelCount(texture.width, texture.height);
 
 	createImage(
-		texture.width, texture.height,
+		texture.width, texture.height, m_textureMipLevels,
 		IMAGE_FORMAT,
 		VK_IMAGE_TILING_OPTIMAL,
-		VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
 		&m_textureImage, &m_textureImageMemory);
 
-	transitionImageLayout(m_textureImage, IMAGE_FORMAT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-	copyBufferToImage(stagingBuffer, m_textureImage, texture.width, texture.height);
-	transitionImageLayout(m_textureImage, IMAGE_FORMAT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(m_physicalDevice, IMAGE_FORMAT, &formatProperties);
 
-	vkDestroyBuffer(m_logicalDevice, stagingBuffer, nullptr);
-	vkFreeMemory(m_logicalDevice, stagingBufferMemory, nullptr);
+	VkFormatFeatureFlags blitFeatures =
+		VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+
+	if ((formatProperties.optimalTilingFeatures & blitFeatures) == blitFeatures)
+	{
+		VkDeviceSize textureSize = (VkDeviceSize)texture.width * texture.height * 4;
+		m_uploadEngine.uploadImageGenerateMips(m_textureImage, texture.width, texture.height, m_textureMipLevels, textureSize,
+			[&](void* staging)
+			{
+				imageLoader.writeRGBA(texture, 0, staging);
+			});
+	}
+	else
+	{
+		std::vector<stbi_uc> rgba((size_t)texture.width * texture.height * 4);
+		imageLoader.writeRGBA(texture, 0, rgba.data());
+
+		std::vector<VkDeviceSize> levelOffsets;
+		std::vector<stbi_uc> mipChain = Image::generateMipChain(rgba.data(), texture.width, texture.height, levelOffsets);
+
+		m_uploadEngine.uploadImage(m_textureImage, texture.width, texture.height, levelOffsets, mipChain.data(), mipChain.size());
+	}
+
+	texture.free();
 }
 
 void Window::createTextureImageView()
 {
-	m_textureImageView = createImageView(m_textureImage, IMAGE_FORMAT, VK_IMAGE_ASPECT_COLOR_BIT);
+	m_textureImageView = createImageView(m_textureImage, m_textureFormat, VK_IMAGE_ASPECT_COLOR_BIT, m_textureMipLevels);
 }
 
 void Window::createTextureSampler()
@@ -1032,78 +1290,55 @@ void Window::createTextureSampler()
 	samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
 	samplerCreateInfo.mipLodBias = 0.0f;
 	samplerCreateInfo.minLod = 0.0f;
-	samplerCreateInfo.maxLod = 0.0f;
+	samplerCreateInfo.maxLod = (float)m_textureMipLevels;
 
 	CALL_VK(vkCreateSampler(m_logicalDevice, &samplerCreateInfo, nullptr, &m_textureSampler));
 }
 
-void Window::createVertexBuffer()
+void Window::createMeshBuffers()
 {
-	VkDeviceSize bufferSize = sizeof(m_vertices[0]) * m_vertices.size();
-
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-
-	createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		&stagingBuffer, &stagingBufferMemory);
-
-	void* data;
-	vkMapMemory(m_logicalDevice, stagingBufferMemory, 0, bufferSize, 0, &data);
-	memcpy(data, m_vertices.data(), (size_t)bufferSize);
-	vkUnmapMemory(m_logicalDevice, stagingBufferMemory);
-
-
-	createBuffer(bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		&m_vertexBuffer, &m_vertexBufferMemory);
-
-	copyBuffer(stagingBuffer, m_vertexBuffer, bufferSize);
-
-	vkDestroyBuffer(m_logicalDevice, stagingBuffer, nullptr);
-	vkFreeMemory(m_logicalDevice, stagingBufferMemory, nullptr);
-
+	m_meshLibrary.build(m_logicalDevice, m_allocator, m_uploadEngine);
 }
 
-void Window::createIndexBuffer()
+void Window::createUniformBuffers()
 {
-	VkDeviceSize bufferSize = sizeof(m_indexes[0]) * m_indexes.size();
-
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-
-	createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		&stagingBuffer, &stagingBufferMemory);
-
-	void* data;
-	vkMapMemory(m_logicalDevice, stagingBufferMemory, 0, bufferSize, 0, &data);
-	memcpy(data, m_indexes.data(), (size_t)bufferSize);
-	vkUnmapMemory(m_logicalDevice, stagingBufferMemory);
-
-	createBuffer(bufferSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_indexBuffer, &m_indexBufferMemory);
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(m_physicalDevice, &deviceProperties);
 
-	copyBuffer(stagingBuffer, m_indexBuffer, bufferSize);
+	VkDeviceSize alignment = deviceProperties.limits.minUniformBufferOffsetAlignment;
+	m_uniformRing.init(m_logicalDevice, m_allocator, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+		sizeof(UniformBufferObject), MAX_FRAMES_IN_FLIGHT, alignment);
 
-	vkDestroyBuffer(m_logicalDevice, stagingBuffer, nullptr);
-	vkFreeMemory(m_logicalDevice, stagingBufferMemory, nullptr);
+	m_instanceRing.init(m_logicalDevice, m_allocator, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+		sizeof(InstanceData) * MAX_INSTANCES_PER_FRAME, MAX_FRAMES_IN_FLIGHT, sizeof(glm::vec4));
 }
 
-void Window::createUniformBuffers()
+void Window::createGpuCuller(const char* cullPath)
 {
-	VkDeviceSize bufferSize = sizeof(UniformBufferObject);
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(m_physicalDevice, &queueFamilyCount, nullptr);
 
-	m_uniformBuffers.resize(m_images.size() * 2);
-	m_uniformBuffersMemory.resize(m_uniformBuffers.size());
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(m_physicalDevice, &queueFamilyCount, queueFamilies.data());
 
-	for (int i = 0; i < m_uniformBuffers.size(); ++i)
+	// Culling is recorded in the frame's command buffer, the graphics queue has to run it.
+	// Every batch after the first draws from a nonzero firstInstance.
+	m_isGpuCulling = (queueFamilies[m_queueFamilyIndexes.graphical].queueFlags & VK_QUEUE_COMPUTE_BIT) != 0
+		&& m_hasDrawIndirectFirstInstance;
+	if (!m_isGpuCulling)
 	{
-		createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			&m_uniformBuffers[i], &m_uniformBuffersMemory[i]);
+		return;
 	}
 
+	VkShaderModule cullModule = createShaderModule(cullPath);
+
+	// Compacted draws can't be split where the index type changes
+	bool isCompacted = m_hasDrawIndirectCount && !m_meshLibrary.hasMixedIndexTypes();
+
+	m_gpuCuller.init(m_physicalDevice, m_logicalDevice, m_allocator, m_pipelineCache.getHandle(), cullModule,
+		MAX_FRAMES_IN_FLIGHT, isCompacted, m_hasMultiDrawIndirect);
+
+	vkDestroyShaderModule(m_logicalDevice, cullModule, nullptr);
 }
 
 void Window::createDescriptorPool()
@@ -1111,18 +1346,18 @@ void Window::createDescriptorPool()
 	std::vector<VkDescriptorPoolSize> poolSizes(2, VkDescriptorPoolSize());
 
 	VkDescriptorPoolSize& uboPoolSize = poolSizes[0];
-	uboPoolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	uboPoolSize.descriptorCount = (uint32_t)m_uniformBuffers.size();
+	uboPoolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	uboPoolSize.descriptorCount = 1;
 
 	VkDescriptorPoolSize& samplerPoolSize = poolSizes[1];
 	samplerPoolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	samplerPoolSize.descriptorCount = (uint32_t)m_uniformBuffers.size();
+	samplerPoolSize.descriptorCount = 1;
 
 	VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {};
 	descriptorPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
 	descriptorPoolCreateInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
 	descriptorPoolCreateInfo.pPoolSizes = poolSizes.data();
-	descriptorPoolCreateInfo.maxSets = static_cast<uint32_t>(m_uniformBuffers.size());
+	descriptorPoolCreateInfo.maxSets = 1;
 	descriptorPoolCreateInfo.flags = 0;
 
 	if (vkCreateDescriptorPool(m_logicalDevice, &descriptorPoolCreateInfo, nullptr, &m_descriptorPool) != VK_SUCCESS)
@@ -1133,123 +1368,324 @@ void Window::createDescriptorPool()
 
 void Window::createDescriptorSets()
 {
-	std::vector<VkDescriptorSetLayout> layouts(m_uniformBuffers.size(), m_uboDescriptorSetLayout);
-
 	VkDescriptorSetAllocateInfo descriptorSetAllocateInfo = {};
 	descriptorSetAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
 	descriptorSetAllocateInfo.descriptorPool = m_descriptorPool;
-	descriptorSetAllocateInfo.descriptorSetCount = (uint32_t)layouts.size();
-	descriptorSetAllocateInfo.pSetLayouts = layouts.data();
+	descriptorSetAllocateInfo.descriptorSetCount = 1;
+	descriptorSetAllocateInfo.pSetLayouts = &m_uboDescriptorSetLayout;
 
-	m_descriptorSets.resize(layouts.size());
-	if (vkAllocateDescriptorSets(m_logicalDevice, &descriptorSetAllocateInfo, m_descriptorSets.data()) != VK_SUCCESS)
+	if (vkAllocateDescriptorSets(m_logicalDevice, &descriptorSetAllocateInfo, &m_descriptorSet) != VK_SUCCESS)
 	{
 		throw VulkanException("Failed to allocate descriptor sets.");
 	}
 
-	for (int i = m_descriptorSets.size() - 1; i >= 0; --i)
-	{
-		std::vector<VkWriteDescriptorSet> descriptorWrites(2, VkWriteDescriptorSet());
-
-
-		VkDescriptorBufferInfo descriptorBufferInfo = {};
-		descriptorBufferInfo.buffer = m_uniformBuffers[i];
-		descriptorBufferInfo.offset = 0;
-		descriptorBufferInfo.range = sizeof(UniformBufferObject);
-
-		VkWriteDescriptorSet& uboDescriptorWrite = descriptorWrites[0];
-		uboDescriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		uboDescriptorWrite.dstSet = m_descriptorSets[i];
-		uboDescriptorWrite.dstBinding = 0;
-		uboDescriptorWrite.dstArrayElement = 0;
-		uboDescriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		uboDescriptorWrite.descriptorCount = 1;
-		uboDescriptorWrite.pBufferInfo = &descriptorBufferInfo;
-		uboDescriptorWrite.pImageInfo = nullptr;
-		uboDescriptorWrite.pTexelBufferView = nullptr;
+	updateUniformDescriptor();
 
+	VkDescriptorImageInfo imageInfo = {};
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	imageInfo.imageView = m_textureImageView;
+	imageInfo.sampler = m_textureSampler;
 
-		VkDescriptorImageInfo imageInfo = {};
-		imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		imageInfo.imageView = m_textureImageView;
-		imageInfo.sampler = m_textureSampler;
+	VkWriteDescriptorSet imageDescriptorWrite = {};
+	imageDescriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	imageDescriptorWrite.dstSet = m_descriptorSet;
+	imageDescriptorWrite.dstBinding = 1;
+	imageDescriptorWrite.dstArrayElement = 0;
+	imageDescriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	imageDescriptorWrite.descriptorCount = 1;
+	imageDescriptorWrite.pBufferInfo = nullptr;
+	imageDescriptorWrite.pImageInfo = &imageInfo;
+	imageDescriptorWrite.pTexelBufferView = nullptr;
 
-		VkWriteDescriptorSet& imageDescriptorWrite = descriptorWrites[1];
-		imageDescriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		imageDescriptorWrite.dstSet = m_descriptorSets[i];
-		imageDescriptorWrite.dstBinding = 1;
-		imageDescriptorWrite.dstArrayElement = 0;
-		imageDescriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		imageDescriptorWrite.descriptorCount = 1;
-		imageDescriptorWrite.pBufferInfo = nullptr;
-		imageDescriptorWrite.pImageInfo = &imageInfo;
-		imageDescriptorWrite.pTexelBufferView = nullptr;
+	vkUpdateDescriptorSets(m_logicalDevice, 1, &imageDescriptorWrite, 0, nullptr);
+}
 
-		vkUpdateDescriptorSets(m_logicalDevice, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
-	}
+void Window::updateUniformDescriptor()
+{
+	// The frame's camera is read through a dynamic offset into the ring
+	VkDescriptorBufferInfo descriptorBufferInfo = {};
+	descriptorBufferInfo.buffer = m_uniformRing.getBuffer();
+	descriptorBufferInfo.offset = 0;
+	descriptorBufferInfo.range = sizeof(UniformBufferObject);
+
+	VkWriteDescriptorSet uboDescriptorWrite = {};
+	uboDescriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	uboDescriptorWrite.dstSet = m_descriptorSet;
+	uboDescriptorWrite.dstBinding = 0;
+	uboDescriptorWrite.dstArrayElement = 0;
+	uboDescriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	uboDescriptorWrite.descriptorCount = 1;
+	uboDescriptorWrite.pBufferInfo = &descriptorBufferInfo;
+	uboDescriptorWrite.pImageInfo = nullptr;
+	uboDescriptorWrite.pTexelBufferView = nullptr;
+
+	vkUpdateDescriptorSets(m_logicalDevice, 1, &uboDescriptorWrite, 0, nullptr);
 }
 
 void Window::createCommandBuffers()
 {
-	m_commandBuffers.resize(m_framebuffers.size());
 	VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
 	commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	commandBufferAllocateInfo.commandPool = m_commandPool;
 	commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	commandBufferAllocateInfo.commandBufferCount = m_commandBuffers.size();
+	commandBufferAllocateInfo.commandBufferCount = 1;
 
-	if (vkAllocateCommandBuffers(m_logicalDevice, &commandBufferAllocateInfo, m_commandBuffers.data()) != VK_SUCCESS)
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
 	{
-		throw VulkanException("Failed to allocate command buffers.");
+		commandBufferAllocateInfo.commandPool = m_commandPools[i];
+
+		if (vkAllocateCommandBuffers(m_logicalDevice, &commandBufferAllocateInfo, &m_commandBuffers[i]) != VK_SUCCESS)
+		{
+			throw VulkanException("Failed to allocate command buffers.");
+		}
 	}
 
+	commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+
+	m_secondaryCommandBuffers.resize(m_secondaryCommandPools.size());
+	for (size_t i = 0; i < m_secondaryCommandPools.size(); ++i)
+	{
+		commandBufferAllocateInfo.commandPool = m_secondaryCommandPools[i];
+
+		if (vkAllocateCommandBuffers(m_logicalDevice, &commandBufferAllocateInfo, &m_secondaryCommandBuffers[i]) != VK_SUCCESS)
+		{
+			throw VulkanException("Failed to allocate secondary command buffers.");
+		}
+	}
+}
 
+void Window::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex)
+{
 	VkCommandBufferBeginInfo commandBufferBeginInfo = {};
 	commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	commandBufferBeginInfo.flags = 0;
+	commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 	commandBufferBeginInfo.pInheritanceInfo = nullptr;
 
+	if (vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo) != VK_SUCCESS)
+	{
+		throw VulkanException("Failed to begin command buffer.");
+	}
+
+	// Collects the timestamps of the frame that last used this slot
+	m_gpuTimer.beginFrame(commandBuffer, m_currentFrameIndex);
+	uint32_t frameZone = m_gpuTimer.beginZone(commandBuffer, "frame");
+
 	VkRenderPassBeginInfo renderPassBeginInfo = {};
 	renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
 	renderPassBeginInfo.renderPass = m_renderPass;
+	renderPassBeginInfo.framebuffer = m_framebuffers[imageIndex];
 	renderPassBeginInfo.renderArea.offset = { 0, 0 };
 	renderPassBeginInfo.renderArea.extent = m_swapchainSupportDetails.extent;
 
 	// ATTACHMENT ORDER
-	std::vector<VkClearValue> clearValues({ { 0.0f, 0.1f, 0.1f, 1.0f }, { 1.0f , 0 } });
+	std::array<VkClearValue, 2> clearValues = {};
+	clearValues[0].color = { 0.0f, 0.1f, 0.1f, 1.0f };
+	clearValues[1].depthStencil = { 1.0f, 0 };
 	renderPassBeginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
 	renderPassBeginInfo.pClearValues = clearValues.data();
 
+	UniformBufferObject ubo = {};
+	ubo.view = m_snapshot->view;
+	ubo.projection = m_snapshot->projection;
+	ubo.projection[1][1] *= -1;
+
+	Profiler::beginZone("ubo update");
+	uint32_t uboOffset = m_uniformRing.push(&ubo, sizeof(ubo));
+	Profiler::endZone();
+
+	// Every mesh becomes one instanced draw, its instances are contiguous in the ring
+	m_snapshot->drawList.buildBatches();
+
+	uint32_t instanceCount = static_cast<uint32_t>(m_snapshot->drawList.getInstances().size());
+	uint32_t drawCount = static_cast<uint32_t>(m_snapshot->drawList.getBatches().size());
+
+	uint32_t instanceOffset = 0;
+	char* instanceData = nullptr;
+	if (m_isGpuCulling)
+	{
+		// Writes the visible instances and the draw commands, consumed by the render pass below
+		PROFILE_ZONE("cull setup");
+		uint32_t cullZone = m_gpuTimer.beginZone(commandBuffer, "culling");
+		m_gpuCuller.recordCulling(commandBuffer, m_currentFrameIndex, m_snapshot->drawList, m_meshLibrary.getMeshes(), ubo.projection * ubo.view);
+		m_gpuTimer.endZone(commandBuffer, cullZone);
+	}
+	else if (instanceCount > 0)
+	{
+		instanceData = static_cast<char*>(m_instanceRing.allocate(sizeof(InstanceData) * instanceCount, &instanceOffset));
+	}
 
-	for (int i = m_commandBuffers.size() - 1; i >= 0; --i)
+	uint32_t threadCount = m_jobSystem.getThreadCount();
+	uint32_t jobCount = std::min(threadCount, (drawCount + MIN_DRAWS_PER_BATCH - 1) / MIN_DRAWS_PER_BATCH);
+	if (m_isGpuCulling && !m_gpuCuller.canSplitDraws())
 	{
-		if (vkBeginCommandBuffer(m_commandBuffers[i], &commandBufferBeginInfo) != VK_SUCCESS)
+		jobCount = std::min(jobCount, 1u);
+	}
+	VkCommandBuffer* secondaryCommandBuffers = &m_secondaryCommandBuffers[m_currentFrameIndex * threadCount];
+
+	m_jobSystem.parallelFor(jobCount, [&](uint32_t job)
 		{
-			throw VulkanException("Failed to begin command buffer.");
+			uint32_t firstBatch = (uint32_t)((uint64_t)drawCount * job / jobCount);
+			uint32_t endBatch = (uint32_t)((uint64_t)drawCount * (job + 1) / jobCount);
+
+			recordDrawBatch(secondaryCommandBuffers[job], imageIndex, firstBatch, endBatch, uboOffset, instanceData, instanceOffset);
+		});
+
+	uint32_t renderPassZone = m_gpuTimer.beginZone(commandBuffer, "render pass");
+	vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+	if (jobCount > 0)
+	{
+		vkCmdExecuteCommands(commandBuffer, jobCount, secondaryCommandBuffers);
+	}
+	vkCmdEndRenderPass(commandBuffer);
+	m_gpuTimer.endZone(commandBuffer, renderPassZone);
+
+	if (m_isHeadless && m_frameReadback)
+	{
+		VkBufferImageCopy region = {};
+		region.bufferOffset = 0;
+		region.bufferRowLength = 0;
+		region.bufferImageHeight = 0;
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.mipLevel = 0;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = 1;
+		region.imageOffset = { 0, 0, 0 };
+		region.imageExtent = { m_swapchainSupportDetails.extent.width, m_swapchainSupportDetails.extent.height, 1 };
+
+		vkCmdCopyImageToBuffer(commandBuffer, m_images[imageIndex], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_readbackBuffers[m_currentFrameIndex], 1, &region);
+
+		VkMemoryBarrier memoryBarrier = {};
+		memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+			0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+		m_isReadbackPending[m_currentFrameIndex] = true;
+	}
+
+	m_gpuTimer.endZone(commandBuffer, frameZone);
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+	{
+		throw VulkanException("Failed to end command buffer.");
+	}
+}
+
+void Window::recordDrawBatch(VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t firstBatch, uint32_t endBatch, uint32_t uboOffset, char* instanceData, VkDeviceSize instanceOffset)
+{
+	PROFILE_ZONE("record batch");
+
+	VkCommandBufferInheritanceInfo inheritanceInfo = {};
+	inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritanceInfo.renderPass = m_renderPass;
+	inheritanceInfo.subpass = 0;
+	inheritanceInfo.framebuffer = m_framebuffers[imageIndex];
+
+	VkCommandBufferBeginInfo commandBufferBeginInfo = {};
+	commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+	commandBufferBeginInfo.pInheritanceInfo = &inheritanceInfo;
+
+	if (vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo) != VK_SUCCESS)
+	{
+		throw VulkanException("Failed to begin secondary command buffer.");
+	}
+
+	VkViewport viewport = {};
+	viewport.x = 0.0f;
+	viewport.y = 0.0f;
+	viewport.width = (float)m_swapchainSupportDetails.extent.width;
+	viewport.height = (float)m_swapchainSupportDetails.extent.height;
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+
+	VkRect2D scissor = {};
+	scissor.offset = { 0, 0 };
+	scissor.extent = m_swapchainSupportDetails.extent;
+
+	// Secondary buffers inherit no state
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+	VkBuffer vertexBuffers[] = { m_meshLibrary.getVertexBuffer(), m_instanceRing.getBuffer() };
+	VkDeviceSize offsets[] = { 0, instanceOffset };
+	if (m_isGpuCulling)
+	{
+		vertexBuffers[1] = m_gpuCuller.getInstanceBuffer();
+		offsets[1] = m_gpuCuller.getInstanceOffset(m_currentFrameIndex);
+	}
+	vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, offsets);
+
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &m_descriptorSet, 1, &uboOffset);
+
+	uint32_t drawZone = m_gpuTimer.beginZone(commandBuffer, "draws");
+	recordDraws(commandBuffer, firstBatch, endBatch, instanceData);
+	m_gpuTimer.endZone(commandBuffer, drawZone);
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+	{
+		throw VulkanException("Failed to end secondary command buffer.");
+	}
+}
+
+void Window::recordDraws(VkCommandBuffer commandBuffer, uint32_t firstBatch, uint32_t endBatch, char* instanceData)
+{
+	const std::vector<InstanceBatch>& batches = m_snapshot->drawList.getBatches();
+	const std::vector<MeshRange>& meshes = m_meshLibrary.getMeshes();
+
+	// The index buffer is rebound wherever consecutive batches change index type
+	uint32_t runBegin = firstBatch;
+	while (runBegin < endBatch)
+	{
+		VkIndexType indexType = meshes[batches[runBegin].mesh].indexType;
+
+		uint32_t runEnd = runBegin + 1;
+		while (runEnd < endBatch && meshes[batches[runEnd].mesh].indexType == indexType)
+		{
+			++runEnd;
 		}
 
-		renderPassBeginInfo.framebuffer = m_framebuffers[i];
+		vkCmdBindIndexBuffer(commandBuffer, m_meshLibrary.getIndexBuffer(), m_meshLibrary.getIndexOffset(indexType), indexType);
 
-		vkCmdBeginRenderPass(m_commandBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-		vkCmdBindPipeline(m_commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
+		if (m_isGpuCulling)
+		{
+			m_gpuCuller.recordDraws(commandBuffer, m_currentFrameIndex, runBegin, runEnd);
+		}
+		else
+		{
+			recordCpuDraws(commandBuffer, runBegin, runEnd, instanceData);
+		}
 
-		VkBuffer vertexBuffers[] = { m_vertexBuffer };
-		VkDeviceSize offsets[] = { 0 };
-		vkCmdBindVertexBuffers(m_commandBuffers[i], 0, 1, vertexBuffers, offsets);
-		vkCmdBindIndexBuffer(m_commandBuffers[i], m_indexBuffer, 0, VK_INDEX_TYPE_UINT16);
+		runBegin = runEnd;
+	}
+}
 
-		vkCmdBindDescriptorSets(m_commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &m_descriptorSets[(i * 2)], 0, nullptr);
-		vkCmdDrawIndexed(m_commandBuffers[i], (uint32_t)m_indexes.size(), 1, 0, 0, 0);
-		
-		vkCmdBindDescriptorSets(m_commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &m_descriptorSets[(i * 2) + 1], 0, nullptr);
-		vkCmdDrawIndexed(m_commandBuffers[i], (uint32_t)m_indexes.size(), 1, 0, 0, 0);
+void Window::recordCpuDraws(VkCommandBuffer commandBuffer, uint32_t firstBatch, uint32_t endBatch, char* instanceData)
+{
+	const std::vector<glm::mat4>& instances = m_snapshot->drawList.getInstances();
+	const std::vector<InstanceBatch>& batches = m_snapshot->drawList.getBatches();
 
-		vkCmdEndRenderPass(m_commandBuffers[i]);
+	for (uint32_t i = firstBatch; i < endBatch; ++i)
+	{
+		const InstanceBatch& batch = batches[i];
+		const MeshRange& mesh = m_meshLibrary.getMeshes()[batch.mesh];
 
-		if (vkEndCommandBuffer(m_commandBuffers[i]) != VK_SUCCESS)
+		// Each job copies the instances of its own batches, quantized meshes get their dequantization folded in
+		InstanceData* batchInstances = reinterpret_cast<InstanceData*>(instanceData) + batch.firstInstance;
+		if (mesh.isQuantized)
 		{
-			throw VulkanException("Failed to end command buffer.");
+			for (uint32_t j = 0; j < batch.instanceCount; ++j)
+			{
+				batchInstances[j].model = instances[batch.firstInstance + j] * mesh.dequantization;
+			}
 		}
+		else
+		{
+			memcpy(batchInstances, &instances[batch.firstInstance], batch.instanceCount * sizeof(InstanceData));
+		}
+
+		vkCmdDrawIndexed(commandBuffer, mesh.indexCount, batch.instanceCount, mesh.firstIndex, mesh.vertexOffset, batch.firstInstance);
 	}
 }
 
@@ -1294,10 +1730,6 @@ void Window::createSyncObjects()
 		}
 	}
 
-
-	//// IMAGE FENCES ////
-	m_imagesInFlight.resize(m_images.size(), VK_NULL_HANDLE);
-
 }
 
 
@@ -1318,7 +1750,12 @@ bool Window::isDeviceSuitable(VkPhysicalDevice physicalDevice, VkSurfaceKHR surf
 	std::vector<VkExtensionProperties> extentionProperties(extentionCount);
 	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extentionCount, extentionProperties.data());
 
-	std::set<std::string> m_extentionsLeft(DEVICE_EXTENSIONS.begin(), DEVICE_EXTENSIONS.end());
+	// Headless needs no swapchain
+	std::set<std::string> m_extentionsLeft;
+	if (!m_isHeadless)
+	{
+		m_extentionsLeft.insert(DEVICE_EXTENSIONS.begin(), DEVICE_EXTENSIONS.end());
+	}
 	for (VkExtensionProperties& ep : extentionProperties)
 	{
 		m_extentionsLeft.erase(ep.extensionName);
@@ -1329,10 +1766,10 @@ bool Window::isDeviceSuitable(VkPhysicalDevice physicalDevice, VkSurfaceKHR surf
 	{
 		isPhysicalDeviceSuitable = isPhysicalDeviceSuitable &&
 			getQueueGraphicsFamilyIndex(physicalDevice, nullptr) &&
-			getQueuePresentFamilyIndex(physicalDevice, m_surface, nullptr, 0);
+			(m_isHeadless || getQueuePresentFamilyIndex(physicalDevice, m_surface, nullptr, 0));
 	}
 
-	if (isPhysicalDeviceSuitable)
+	if (isPhysicalDeviceSuitable && !m_isHeadless)
 	{
 		SwapChainSupportDetails swapChainDetails = getSwapChainSupportDetails(physicalDevice, m_surface, m_width, m_height);
 
@@ -1358,17 +1795,23 @@ bool Window::isDeviceSuitable(VkPhysicalDevice physicalDevice, VkSurfaceKHR surf
 
 QueueFamilyIndexes Window::getQueueFamilyIndexes(VkPhysicalDevice physicalDevice)
 {
-	QueueFamilyIndexes familyIndexes = { 0, 0 };
+	QueueFamilyIndexes familyIndexes = { 0, 0, 0 };
 	if (!getQueueGraphicsFamilyIndex(physicalDevice, &familyIndexes.graphical))
 	{
 		throw VulkanException("Device not suitable.");
 	}
 
-	if (!getQueuePresentFamilyIndex(physicalDevice, m_surface, &familyIndexes.present, familyIndexes.graphical))
+	if (m_isHeadless)
+	{
+		familyIndexes.present = familyIndexes.graphical;
+	}
+	else if (!getQueuePresentFamilyIndex(physicalDevice, m_surface, &familyIndexes.present, familyIndexes.graphical))
 	{
 		throw VulkanException("Device not suitable.");
 	}
 
+	familyIndexes.transfer = getQueueTransferFamilyIndex(physicalDevice, familyIndexes.graphical);
+
 	return familyIndexes;
 }
 
@@ -1418,16 +1861,7 @@ VkSurfaceFormatKHR Window::chooseSwapSurfaceFormat(const std::vector<VkSurfaceFo
 
 VkPresentModeKHR Window::chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& presentModes)
 {
-	for (const VkPresentModeKHR& presentMode : presentModes)
-	{
-		if (presentMode == VK_PRESENT_MODE_MAILBOX_KHR)
-		{
-			return presentMode;
-		}
-	}
-
-	// always avalible
-	return VK_PRESENT_MODE_FIFO_KHR;
+	return m_framePacer.choosePresentMode(presentModes);
 }
 
 VkExtent2D Window::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& swapChainCapabilities, uint32_t width, uint32_t height)
@@ -1441,31 +1875,15 @@ VkExtent2D Window::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& swapChainCap
 	VkExtent2D extentToUse = {};
 
 	// Average extent
-	extentToUse.width = std::max(swapChainCapabilities.maxImageExtent.width,
+	extentToUse.width = std::max(swapChainCapabilities.minImageExtent.width,
 		std::min(swapChainCapabilities.maxImageExtent.width, wantedExtent.width));
-	extentToUse.height = std::max(swapChainCapabilities.maxImageExtent.height,
+	extentToUse.height = std::max(swapChainCapabilities.minImageExtent.height,
 		std::min(swapChainCapabilities.maxImageExtent.height, wantedExtent.height));
 
-	return { 5, 20 };
+	return extentToUse;
 }
 
-uint32_t Window::findMemoryType(VkPhysicalDevice physicalDevice, uint32_t memoryTypeFilter, VkMemoryPropertyFlags memoryPropertyFlags)
-{
-	VkPhysicalDeviceMemoryProperties memoryProperties;
-	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
-
-	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; ++i)
-	{
-		if (memoryTypeFilter & (1 << i) && (memoryProperties.memoryTypes[i].propertyFlags & memoryPropertyFlags) == memoryPropertyFlags)
-		{
-			return i;
-		}
-	}
-
-	throw VulkanException("Failed to find suitable memory type.");
-}
-
-void Window::createBuffer(VkDeviceSize size, VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags propertyFlags, VkBuffer* buffer, VkDeviceMemory* bufferMemory)
+void Window::createBuffer(VkDeviceSize size, VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags propertyFlags, VkBuffer* buffer, DeviceAllocation* bufferMemory)
 {
 	VkBufferCreateInfo bufferCreateInfo = {};
 	bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -1481,26 +1899,12 @@ void Window::createBuffer(VkDeviceSize size, VkBufferUsageFlags usageFlags, VkMe
 	VkMemoryRequirements memoryRequirements;
 	vkGetBufferMemoryRequirements(m_logicalDevice, *buffer, &memoryRequirements);
 
+	*bufferMemory = m_allocator.allocate(memoryRequirements, propertyFlags, ResourceType::BUFFER);
 
-	VkMemoryAllocateInfo memoryAllocateInfo = {};
-	memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	memoryAllocateInfo.allocationSize = memoryRequirements.size;
-	memoryAllocateInfo.memoryTypeIndex = findMemoryType(
-		m_physicalDevice,
-		memoryRequirements.memoryTypeBits,
-		propertyFlags
-	);
-
-	if (vkAllocateMemory(m_logicalDevice, &memoryAllocateInfo, nullptr, bufferMemory) != VK_SUCCESS)
-	{
-		throw VulkanException("Failed to allocate buffer memory.");
-	}
-
-	vkBindBufferMemory(m_logicalDevice, *buffer, *bufferMemory, 0);
-
+	vkBindBufferMemory(m_logicalDevice, *buffer, bufferMemory->memory, bufferMemory->offset);
 }
 
-void Window::createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags propertyFlags, VkImage* image, VkDeviceMemory* deviceMemory)
+void Window::createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags propertyFlags, VkImage* image, DeviceAllocation* deviceMemory)
 {
 	VkImageCreateInfo imageCreateInfo = {};
 	imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -1508,7 +1912,7 @@ void Window::createImage(uint32_t width, uint32_t height, VkFormat format, VkIma
 	imageCreateInfo.extent.width = width;
 	imageCreateInfo.extent.height = height;
 	imageCreateInfo.extent.depth = 1;
-	imageCreateInfo.mipLevels = 1;
+	imageCreateInfo.mipLevels = mipLevels;
 	imageCreateInfo.arrayLayers = 1;
 
 	imageCreateInfo.format = format;
@@ -1524,64 +1928,22 @@ void Window::createImage(uint32_t width, uint32_t height, VkFormat format, VkIma
 	VkMemoryRequirements imageMemoryRequirements;
 	vkGetImageMemoryRequirements(m_logicalDevice, *image, &imageMemoryRequirements);
 
-	VkMemoryAllocateInfo memoryAllocateInfo = {};
-	memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	memoryAllocateInfo.allocationSize = imageMemoryRequirements.size;
-	memoryAllocateInfo.memoryTypeIndex = findMemoryType(
-		m_physicalDevice,
-		imageMemoryRequirements.memoryTypeBits,
-		propertyFlags);
-
-	CALL_VK(vkAllocateMemory(m_logicalDevice, &memoryAllocateInfo, nullptr, deviceMemory));
-
-	vkBindImageMemory(m_logicalDevice, *image, *deviceMemory, 0);
-}
-
-void Window::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
-{
-	VkCommandBuffer transferCommandBuffer = beginSingleTimeCommands();
-
-	VkBufferCopy copyRegion = {};
-	copyRegion.srcOffset = 0;
-	copyRegion.dstOffset = 0;
-	copyRegion.size = size;
-	vkCmdCopyBuffer(transferCommandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
-
-	endSingleTimeCommand(transferCommandBuffer);
-}
-
-void Window::copyBufferToImage(VkBuffer srcBuffer, VkImage dstImage, uint32_t width, uint32_t height)
-{
-	VkCommandBuffer transferBuffer = beginSingleTimeCommands();
-
-	VkBufferImageCopy copyRegion = {};
-	copyRegion.bufferOffset = 0;
-	copyRegion.bufferRowLength = 0;
-	copyRegion.bufferImageHeight = 0;
+	*deviceMemory = m_allocator.allocate(imageMemoryRequirements, propertyFlags,
+		tiling == VK_IMAGE_TILING_OPTIMAL ? ResourceType::IMAGE : ResourceType::BUFFER);
 
-	VkImageSubresourceLayers& subresource = copyRegion.imageSubresource;
-	subresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	subresource.mipLevel = 0;
-	subresource.baseArrayLayer = 0;
-	subresource.layerCount = 1;
-
-	copyRegion.imageOffset = { 0, 0, 0 };
-	copyRegion.imageExtent = { width, height, 1 };
-
-	vkCmdCopyBufferToImage(transferBuffer, srcBuffer, dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
-
-	endSingleTimeCommand(transferBuffer);
+	vkBindImageMemory(m_logicalDevice, *image, deviceMemory->memory, deviceMemory->offset);
 }
 
 VkDevice Window::createLogicalDevice(VkPhysicalDevice physicalDevice, QueueFamilyIndexes& familyIndexes)
 {
-	std::set<uint32_t> uniqueQueueFamilies = { familyIndexes.graphical, familyIndexes.present };
+	std::set<uint32_t> uniqueQueueFamilies = { familyIndexes.graphical, familyIndexes.present, familyIndexes.transfer };
 	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
 
+	float queuePriority = 1.0f;
 	for (uint32_t queueFamilyIndex : uniqueQueueFamilies)
 	{
 		queueCreateInfos.push_back(VkDeviceQueueCreateInfo());
-		setQueueCreateInfo(queueCreateInfos[queueCreateInfos.size() - 1], queueFamilyIndex, 1.0f);
+		setQueueCreateInfo(queueCreateInfos[queueCreateInfos.size() - 1], queueFamilyIndex, &queuePriority);
 	}
 
 
@@ -1591,13 +1953,47 @@ VkDevice Window::createLogicalDevice(VkPhysicalDevice physicalDevice, QueueFamil
 	deviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 	deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
 
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+	m_hasMultiDrawIndirect = supportedFeatures.multiDrawIndirect == VK_TRUE;
+	m_hasDrawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance == VK_TRUE;
+
 	VkPhysicalDeviceFeatures physicalDeviceFeatures = {};
 	physicalDeviceFeatures.samplerAnisotropy = VK_TRUE;
+	physicalDeviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+	physicalDeviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+	physicalDeviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+	physicalDeviceFeatures.textureCompressionETC2 = supportedFeatures.textureCompressionETC2;
 
 	deviceCreateInfo.pEnabledFeatures = &physicalDeviceFeatures;
 
-	deviceCreateInfo.ppEnabledExtensionNames = DEVICE_EXTENSIONS.data();
-	deviceCreateInfo.enabledExtensionCount = (uint32_t)DEVICE_EXTENSIONS.size();
+	uint32_t extentionCount;
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extentionCount, nullptr);
+
+	std::vector<VkExtensionProperties> extentionProperties(extentionCount);
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extentionCount, extentionProperties.data());
+
+	std::vector<const char*> extensions;
+	if (!m_isHeadless)
+	{
+		extensions = DEVICE_EXTENSIONS;
+	}
+	for (const char* optionalExtension : OPTIONAL_DEVICE_EXTENSIONS)
+	{
+		for (VkExtensionProperties& ep : extentionProperties)
+		{
+			if (strcmp(ep.extensionName, optionalExtension) == 0)
+			{
+				extensions.push_back(optionalExtension);
+				break;
+			}
+		}
+	}
+	m_hasDrawIndirectCount = std::find_if(extensions.begin(), extensions.end(),
+		[](const char* extension) { return strcmp(extension, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME) == 0; }) != extensions.end();
+
+	deviceCreateInfo.ppEnabledExtensionNames = extensions.data();
+	deviceCreateInfo.enabledExtensionCount = (uint32_t)extensions.size();
 
 #ifndef NDEBUG
 	deviceCreateInfo.enabledLayerCount = (uint32_t)VALIDATION_LAYERS.size();
@@ -1691,6 +2087,36 @@ bool Window::getQueueGraphicsFamilyIndex(VkPhysicalDevice physicalDevice, uint32
 	return found;
 }
 
+uint32_t Window::getQueueTransferFamilyIndex(VkPhysicalDevice physicalDevice, uint32_t graphicalIndex)
+{
+	uint32_t nQueueFamilies;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &nQueueFamilies, nullptr);
+
+	std::vector<VkQueueFamilyProperties> queueFamilyProperties(nQueueFamilies);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &nQueueFamilies, queueFamilyProperties.data());
+
+	// Dedicated DMA family first, then any transfer capable family that is not the graphics one
+	for (uint32_t i = 0; i < nQueueFamilies; ++i)
+	{
+		VkQueueFlags flags = queueFamilyProperties[i].queueFlags;
+		if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+		{
+			return i;
+		}
+	}
+
+	for (uint32_t i = 0; i < nQueueFamilies; ++i)
+	{
+		VkQueueFlags flags = queueFamilyProperties[i].queueFlags;
+		if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT))
+		{
+			return i;
+		}
+	}
+
+	return graphicalIndex;
+}
+
 bool Window::getQueuePresentFamilyIndex(VkPhysicalDevice physicalDevice, VkSurfaceKHR surfaceHandle, uint32_t* index, uint32_t priorityIndex)
 {
 	uint32_t nQueueFamilies;
@@ -1728,18 +2154,19 @@ bool Window::getQueuePresentFamilyIndex(VkPhysicalDevice physicalDevice, VkSurfa
 	return false;
 }
 
-void Window::setQueueCreateInfo(VkDeviceQueueCreateInfo& queueCreateInfo, uint32_t index, float priority)
+void Window::setQueueCreateInfo(VkDeviceQueueCreateInfo& queueCreateInfo, uint32_t index, const float* priority)
 {
 
 	queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
 	queueCreateInfo.queueFamilyIndex = index;
 	queueCreateInfo.queueCount = 1;
-	queueCreateInfo.pQueuePriorities = &priority;
+	queueCreateInfo.pQueuePriorities = priority;
 }
 
 VkShaderModule Window::createShaderModule(const char* shaderPath)
 {
-	std::vector<char> shaderData = FileReader::readData(shaderPath);
+	// Mappings are page aligned, which covers the word alignment pCode needs
+	FileView shaderData = FileReader::openData(shaderPath, MappedFile::AccessHint::WILL_NEED);
 
 	VkShaderModuleCreateInfo createInfo = {};
 	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
@@ -1767,100 +2194,7 @@ VkPipelineShaderStageCreateInfo Window::getCreateShaderPipelineInfo(VkShaderModu
 }
 
 
-///////////////////////////////////////////////////////////////////////
-VkCommandBuffer Window::beginSingleTimeCommands()
-{
-	VkCommandBufferAllocateInfo  cmdBufferAllocateInfo = {};
-	cmdBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	cmdBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	cmdBufferAllocateInfo.commandPool = m_commandPool;
-	cmdBufferAllocateInfo.commandBufferCount = 1;
-
-	VkCommandBuffer commandBuffer;
-	CALL_VK(vkAllocateCommandBuffers(m_logicalDevice, &cmdBufferAllocateInfo, &commandBuffer));
-
-	VkCommandBufferBeginInfo cmdBufferBeginInfo = {};
-	cmdBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	cmdBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-	CALL_VK(vkBeginCommandBuffer(commandBuffer, &cmdBufferBeginInfo));
-
-	return commandBuffer;
-}
-
-void Window::endSingleTimeCommand(VkCommandBuffer commandBuffer)
-{
-	CALL_VK(vkEndCommandBuffer(commandBuffer));
-
-	VkSubmitInfo submitInfo = {};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &commandBuffer;
-
-	vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-	vkQueueWaitIdle(m_graphicsQueue);
-
-	vkFreeCommandBuffers(m_logicalDevice, m_commandPool, 1, &commandBuffer);
-}
-///////////////////////////////////////////////////////////////////////
-
-void Window::transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout)
-{
-	VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
-	VkImageMemoryBarrier barrier = {};
-	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-	barrier.oldLayout = oldLayout;
-	barrier.newLayout = newLayout;
-
-	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-
-	barrier.image = image;
-
-	VkImageSubresourceRange& subresourceRange = barrier.subresourceRange;
-	subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	subresourceRange.baseMipLevel = 0;
-	subresourceRange.levelCount = 1;
-	subresourceRange.baseArrayLayer = 0;
-	subresourceRange.layerCount = 1;
-
-	VkPipelineStageFlags sourceStage;
-	VkPipelineStageFlags destinationStage;
-
-
-	if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-		barrier.srcAccessMask = 0;
-		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-		sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-		destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-	}
-	else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-		sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-		destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-	}
-	else {
-		throw VulkanException("unsupported layout transition!");
-	}
-
-
-	vkCmdPipelineBarrier(
-		commandBuffer,
-		sourceStage, destinationStage,
-		0,
-		0, nullptr,
-		0, nullptr,
-		1, &barrier
-	);
-
-	endSingleTimeCommand(commandBuffer);
-}
-
-VkImageView Window::createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags)
+VkImageView Window::createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels)
 {
 	VkImageViewCreateInfo viewCreateInfo = {};
 	viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -1871,7 +2205,7 @@ VkImageView Window::createImageView(VkImage image, VkFormat format, VkImageAspec
 	VkImageSubresourceRange& subresourceRange = viewCreateInfo.subresourceRange;
 	subresourceRange.aspectMask = aspectFlags;
 	subresourceRange.baseMipLevel = 0;
-	subresourceRange.levelCount = 1;
+	subresourceRange.levelCount = mipLevels;
 	subresourceRange.baseArrayLayer = 0;
 	subresourceRange.layerCount = 1;
 
@@ -1882,6 +2216,15 @@ VkImageView Window::createImageView(VkImage image, VkFormat format, VkImageAspec
 }
 
 
+bool Window::isFormatSampleable(VkFormat format)
+{
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(m_physicalDevice, format, &formatProperties);
+
+	VkFormatFeatureFlags sampledFeatures = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	return (formatProperties.optimalTilingFeatures & sampledFeatures) == sampledFeatures;
+}
+
 VkFormat Window::findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags featureFlags)
 {
 	for (VkFormat format : candidates)
@@ -1922,7 +2265,7 @@ void Window::cleanupSwapChain()
 {
 	vkDestroyImageView(m_logicalDevice, m_depthImageView, nullptr);
 	vkDestroyImage(m_logicalDevice, m_depthImage, nullptr);
-	vkFreeMemory(m_logicalDevice, m_depthImageMemory, nullptr);
+	m_allocator.free(m_depthImageMemory);
 
 
 	for (VkFramebuffer framebuffer : m_framebuffers)
@@ -1930,26 +2273,10 @@ void Window::cleanupSwapChain()
 		vkDestroyFramebuffer(m_logicalDevice, framebuffer, nullptr);
 	}
 
-	vkFreeCommandBuffers(m_logicalDevice, m_commandPool, static_cast<uint32_t>(m_commandBuffers.size()), m_commandBuffers.data());
-
-	vkDestroyPipeline(m_logicalDevice, m_graphicsPipeline, nullptr);
-	vkDestroyPipelineLayout(m_logicalDevice, m_pipelineLayout, nullptr);
-	vkDestroyRenderPass(m_logicalDevice, m_renderPass, nullptr);
-
 	for (VkImageView imageView : m_imageViews)
 	{
 		vkDestroyImageView(m_logicalDevice, imageView, nullptr);
 	}
-
-	vkDestroySwapchainKHR(m_logicalDevice, m_swapchain, nullptr);
-
-	for (int i = 0; i < m_uniformBuffers.size(); ++i)
-	{
-		vkDestroyBuffer(m_logicalDevice, m_uniformBuffers[i], nullptr);
-		vkFreeMemory(m_logicalDevice, m_uniformBuffersMemory[i], nullptr);
-	}
-
-	vkDestroyDescriptorPool(m_logicalDevice, m_descriptorPool, nullptr);
 }
 
 void Window::recreateSwapChain()
@@ -1962,20 +2289,36 @@ void Window::recreateSwapChain()
 		glfwWaitEvents();
 	}
 
-	vkDeviceWaitIdle(m_logicalDevice);
+	// Only the frames in flight can still use the swapchain images, uploads keep going
+	vkWaitForFences(m_logicalDevice, MAX_FRAMES_IN_FLIGHT, m_inFlightFences.data(), VK_TRUE, UINT64_MAX);
 
 	cleanupSwapChain();
-	createSwapChain();
+
+	VkSwapchainKHR oldSwapchain = m_swapchain;
+	VkFormat oldFormat = m_swapchainSupportDetails.surfaceFormat.format;
+
+	createSwapChain(oldSwapchain);
+
+	// Presents queued on the old swapchain aren't covered by the fences
+	{
+		std::lock_guard<std::mutex> queueLock(m_uploadEngine.getQueueMutex());
+		vkQueueWaitIdle(m_presentQueue);
+	}
+	vkDestroySwapchainKHR(m_logicalDevice, oldSwapchain, nullptr);
+
 	m_imageViews = createImageViews(m_logicalDevice, m_images, m_swapchainSupportDetails);
-	createRenderPass();
-	createGraphicsPipeline("shaders/bin/triangle.vert.spv", "shaders/bin/triangle.frag.spv");
 
-	createDepthResources();
+	// The pipeline only depends on the attachment formats
+	if (m_swapchainSupportDetails.surfaceFormat.format != oldFormat)
+	{
+		vkDestroyPipeline(m_logicalDevice, m_graphicsPipeline, nullptr);
+		vkDestroyPipelineLayout(m_logicalDevice, m_pipelineLayout, nullptr);
+		vkDestroyRenderPass(m_logicalDevice, m_renderPass, nullptr);
 
-	createFramebuffers();
-	createUniformBuffers();
-	createDescriptorPool();
-	createDescriptorSets();
+		createRenderPass();
+		createGraphicsPipeline("shaders/bin/triangle.vert.spv", "shaders/bin/triangle.frag.spv");
+	}
 
-	createCommandBuffers();
+	createDepthResources();
+	createFramebuffers();
 }
@@ -5,13 +5,26 @@
 
 #include <vector>
 #include <array>
-
-#include "camera/FocusedCamera.h"
+#include <functional>
+
+#include "memory/DeviceAllocator.h"
+#include "memory/FrameRingBuffer.h"
+#include "memory/UploadEngine.h"
+#include "pipeline/PipelineCache.h"
+#include "render/DrawList.h"
+#include "render/GpuCuller.h"
+#include "render/FramePacer.h"
+#include "jobs/JobSystem.h"
+#include "mesh/MeshLibrary.h"
+#include "mesh/VertexFormat.h"
+#include "profiling/GpuTimer.h"
+#include "sim/Simulation.h"
 
 struct QueueFamilyIndexes
 {
 	uint32_t graphical;
 	uint32_t present;
+	uint32_t transfer;
 };
 
 struct SwapChainSupportDetails
@@ -26,59 +39,35 @@ struct SwapChainSupportDetails
 
 
 struct UniformBufferObject {
-	alignas(16) glm::mat4 model;
 	alignas(16) glm::mat4 view;
 	alignas(16) glm::mat4 projection;
 };
 
-struct Vertex
-{
-	glm::vec3 position;
-	glm::vec3 color;
-	glm::vec2 texCoord;
-
-	static VkVertexInputBindingDescription getBindingDescription()
-	{
-		VkVertexInputBindingDescription bindingDescription = {};
-		bindingDescription.binding = 0;
-		bindingDescription.stride = sizeof(Vertex);
-		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-		return bindingDescription;
-	}
-
-	static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions()
-	{
-		std::vector<VkVertexInputAttributeDescription> attributeDescriptions(3, VkVertexInputAttributeDescription());
-
-		// POSITION
-		attributeDescriptions[0].binding = 0;
-		attributeDescriptions[0].location = 0;
-		attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-		attributeDescriptions[0].offset = offsetof(Vertex, position);
-
-		// COLOR
-		attributeDescriptions[1].binding = 0;
-		attributeDescriptions[1].location = 1;
-		attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-		attributeDescriptions[1].offset = offsetof(Vertex, color);
-
-		// TEX COORD
-		attributeDescriptions[2].binding = 0;
-		attributeDescriptions[2].location = 2;
-		attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
-		attributeDescriptions[2].offset = offsetof(Vertex, texCoord);
-
-		return attributeDescriptions;
-	}
-};
+
+// Layout of mesh files and generated meshes, encoded into Vertex when registered
+typedef VertexFormat<FloatPosition, FloatColor, FloatTexCoord> MeshVertex;
+
+#ifdef COMPACT_VERTICES
+// Half the size, positions are dequantized by the instance model matrix
+typedef VertexFormat<Unorm16Position, Rgba8Color, HalfTexCoord> Vertex;
+#else
+typedef MeshVertex Vertex;
+#endif
+
+// triangle.vert reads the instance model matrix right after the vertex attributes
+static_assert(Vertex::ATTRIBUTE_COUNT == 3, "triangle.vert expects the model matrix at location 3.");
+
+// Pixels of a rendered frame, tightly packed VK_FORMAT_R8G8B8A8_UNORM rows
+typedef std::function<void(const uint8_t* pixels, uint32_t width, uint32_t height)> FrameReadback;
 
 class Window
 {
 public:
+	// A headless window renders into offscreen images, without a surface or a swapchain
 	Window(
 		int width = 800,
-		int heigth = 600);
+		int heigth = 600,
+		bool isHeadless = false);
 
 	void init();
 	void destroy();
@@ -86,16 +75,39 @@ public:
 	bool isOpen();
 	void draw();
 
+	bool isHeadless() const;
+
+	// Recreates the swapchain when the present mode changes, callable before init
+	void setPacingMode(PacingMode mode);
+	// 0 disables the limiter
+	void setFrameLimit(double framesPerSecond);
+
+	// Headless only, called from draw() once the frame's fence has signaled
+	void setFrameReadback(const FrameReadback& frameReadback);
+	// Waits for the frames in flight and hands out their pending readbacks
+	void flushReadbacks();
+
 	VkDevice getDevice();
 
+	// Runs on the simulation thread every tick, set before init
+	void setSceneUpdate(const SceneUpdate& sceneUpdate);
+
+	// Before init, returns the id to draw the mesh with. Mesh 0 is the textured quad.
+	uint32_t loadMesh(const char* relativePath);
+	uint32_t addMesh(const std::vector<MeshVertex>& vertices, const std::vector<uint32_t>& indices, bool isOptimized = false);
+
 	void setResized();
+	void setCursorPosition(double x, double y);
+	void setMouseButton(int button, bool isPressed);
 
 private:
 	
 	void createInstance();
 	void createWindow();
 	void createDevice();
-	void createSwapChain();
+	void createSwapChain(VkSwapchainKHR oldSwapchain = VK_NULL_HANDLE);
+	void createOffscreenImages();
+	void createReadbackBuffers();
 
 	std::vector<VkImageView> createImageViews(VkDevice logicalDevice, std::vector<VkImage>& images, SwapChainSupportDetails& swapchainSupportDetails);
 	void createGraphicsPipeline(const char* vertexPath, const char* fragmentPath);
@@ -106,21 +118,27 @@ private:
 	void createDepthResources();
 
 	void createFramebuffers();
-	void createCommandPool();
+	void createCommandPools();
 
 	void createTextureImage();
 	void createTextureImageView();
 	void createTextureSampler();
 
-	void createVertexBuffer();
-	void createIndexBuffer();
+	void createMeshBuffers();
 	void createUniformBuffers();
+	void createGpuCuller(const char* cullPath);
 
 	void createDescriptorPool();
 	void createDescriptorSets();
+	void updateUniformDescriptor();
 
 	void createCommandBuffers();
+	void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+	void recordDrawBatch(VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t firstBatch, uint32_t endBatch, uint32_t uboOffset, char* instanceData, VkDeviceSize instanceOffset);
+	void recordDraws(VkCommandBuffer commandBuffer, uint32_t firstBatch, uint32_t endBatch, char* instanceData);
+	void recordCpuDraws(VkCommandBuffer commandBuffer, uint32_t firstBatch, uint32_t endBatch, char* instanceData);
 	void createSyncObjects();
+	void deliverReadback(uint32_t frameIndex);
 
 
 	void cleanupSwapChain();
@@ -138,8 +156,9 @@ private:
 	QueueFamilyIndexes getQueueFamilyIndexes(VkPhysicalDevice physicalDevice);
 
 	bool getQueueGraphicsFamilyIndex(VkPhysicalDevice physicalDevice, uint32_t* index);
+	uint32_t getQueueTransferFamilyIndex(VkPhysicalDevice physicalDevice, uint32_t graphicalIndex);
 	bool getQueuePresentFamilyIndex(VkPhysicalDevice physicalDevice, VkSurfaceKHR surfaceHandle, uint32_t* index, uint32_t priorityIndex);
-	void setQueueCreateInfo(VkDeviceQueueCreateInfo& queueCreateInfo, uint32_t index, float priority);
+	void setQueueCreateInfo(VkDeviceQueueCreateInfo& queueCreateInfo, uint32_t index, const float* priority);
 
 
 	// SWAPCHAIN
@@ -153,26 +172,17 @@ private:
 
 
 	// MEMORY SHIT
-	uint32_t findMemoryType(VkPhysicalDevice physicalDevice, uint32_t memoryTypeFilter, VkMemoryPropertyFlags memoryPropertyFlags);
-	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags propertyFlags, VkBuffer* buffer, VkDeviceMemory* bufferMemory);
-	void createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags propertyFlags, VkImage* image, VkDeviceMemory* deviceMemory);
+	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags propertyFlags, VkBuffer* buffer, DeviceAllocation* bufferMemory);
+	void createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags propertyFlags, VkImage* image, DeviceAllocation* deviceMemory);
+
 
-	void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
-	void copyBufferToImage(VkBuffer srcBuffer, VkImage dstImage, uint32_t width, uint32_t height);
-	
 	VkShaderModule createShaderModule(const char* shaderPath);
 
 	VkPipelineShaderStageCreateInfo getCreateShaderPipelineInfo(VkShaderModule shaderModule, VkShaderStageFlagBits shaderStage);
 
-	///////////////////////////////////////////////////////////////////////
-	VkCommandBuffer beginSingleTimeCommands();
-	void endSingleTimeCommand(VkCommandBuffer commandBuffer);
-	///////////////////////////////////////////////////////////////////////
-
-	void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
-
-	VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags);
+	VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels);
 
+	bool isFormatSampleable(VkFormat format);
 	VkFormat findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags featureFlags);
 	VkFormat findDepthFormat();
 	bool hasStencilComponent(VkFormat format);
@@ -181,10 +191,11 @@ private:
 	int m_width;
 	int m_height;
 
-	double m_xpos, m_ypos;
-	bool m_isPressed;
+	// Owns the camera and the scene, draw() renders its latest snapshot
+	Simulation m_simulation;
+	FrameSnapshot* m_snapshot;
 
-	FocusedCamera m_camera;
+	bool m_isHeadless;
 
 	GLFWwindow* m_window;
 	VkSurfaceKHR m_surface;
@@ -196,8 +207,12 @@ private:
 
 	QueueFamilyIndexes m_queueFamilyIndexes;
 
+	DeviceAllocator m_allocator;
+	UploadEngine m_uploadEngine;
+
 	VkQueue m_graphicsQueue;
 	VkQueue m_presentQueue;
+	VkQueue m_transferQueue;
 
 	SwapChainSupportDetails m_swapchainSupportDetails;
 
@@ -205,49 +220,71 @@ private:
 	std::vector<VkImage> m_images;
 	std::vector<VkImageView> m_imageViews;
 
+	// Headless, one offscreen image and readback buffer per frame in flight
+	std::vector<DeviceAllocation> m_offscreenImageMemories;
+	std::vector<VkBuffer> m_readbackBuffers;
+	std::vector<DeviceAllocation> m_readbackMemories;
+	std::vector<bool> m_isReadbackPending;
+	FrameReadback m_frameReadback;
+
 	VkRenderPass m_renderPass;
+	PipelineCache m_pipelineCache;
+	GpuTimer m_gpuTimer;
 	VkPipeline m_graphicsPipeline;
 	VkPipelineLayout m_pipelineLayout;
 
 	std::vector<VkFramebuffer> m_framebuffers;
 
-	VkCommandPool m_commandPool;
+	// One pool per frame in flight, reset as a whole once the frame's fence signals
+	std::vector<VkCommandPool> m_commandPools;
 	std::vector<VkCommandBuffer> m_commandBuffers;
 
+	// Secondary buffers recorded by the job system, one pool per recording thread per frame in flight
+	JobSystem m_jobSystem;
+	std::vector<VkCommandPool> m_secondaryCommandPools;
+	std::vector<VkCommandBuffer> m_secondaryCommandBuffers;
+
+	// Frustum culling and indirect draws, the CPU path is kept when the graphics queue can't compute
+	// or indirect draws can't start past instance 0
+	GpuCuller m_gpuCuller;
+	bool m_isGpuCulling;
+	bool m_hasDrawIndirectCount;
+	bool m_hasMultiDrawIndirect;
+	bool m_hasDrawIndirectFirstInstance;
+
 	std::vector<VkSemaphore> m_semaphoresImageAvailable;
 	std::vector<VkSemaphore> m_semaphoresRenderFinished;
 
 	std::vector<VkFence> m_inFlightFences;
-	std::vector<VkFence> m_imagesInFlight;
 
 	uint32_t m_currentFrameIndex;
-	bool m_framebufferResized;
 
+	// Frames the CPU may run ahead, at most MAX_FRAMES_IN_FLIGHT
+	FramePacer m_framePacer;
+	uint32_t m_framesInFlight;
+	bool m_framebufferResized;
 
-	std::vector<Vertex> m_vertices;
-	std::vector<uint16_t> m_indexes;
-
-	VkBuffer m_vertexBuffer;
-	VkDeviceMemory m_vertexBufferMemory;
 
-	VkBuffer m_indexBuffer;
-	VkDeviceMemory m_indexBufferMemory;
+	// Addressed by DrawObject::mesh
+	MeshLibrary m_meshLibrary;
 
 
 	VkDescriptorSetLayout m_uboDescriptorSetLayout;
 	VkDescriptorPool m_descriptorPool;
-	std::vector<VkDescriptorSet> m_descriptorSets;
+	VkDescriptorSet m_descriptorSet;
 
-	std::vector<VkBuffer> m_uniformBuffers;
-	std::vector<VkDeviceMemory> m_uniformBuffersMemory;
+	FrameRingBuffer m_uniformRing;
+	FrameRingBuffer m_instanceRing;
 	
 	VkImage m_textureImage;
-	VkDeviceMemory m_textureImageMemory;
+	DeviceAllocation m_textureImageMemory;
+	VkFormat m_textureFormat;
+	uint32_t m_textureMipLevels;
 	VkImageView m_textureImageView;
 	VkSampler m_textureSampler;
 
 	VkImage m_depthImage;
-	VkDeviceMemory m_depthImageMemory;
+	DeviceAllocation m_depthImageMemory;
 	VkImageView m_depthImageView;
 
 #ifndef NDEBUG
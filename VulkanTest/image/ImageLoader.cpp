@@ -0,0 +1,83 @@
+#include "ImageLoader.h"
+#include "../FileReader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+// Converted through a cache sized buffer before being streamed out
+const size_t CHUNK_PIXELS = 1024;
+const uint32_t ROWS_PER_JOB = 32;
+
+ImageLoader::ImageLoader(JobSystem& jobSystem) :
+	m_jobSystem(&jobSystem)
+{
+}
+
+std::vector<Image> ImageLoader::decode(const std::vector<const char*>& relativePaths)
+{
+	std::vector<Image> images(relativePaths.size());
+
+	m_jobSystem->parallelFor((uint32_t)relativePaths.size(), [&](uint32_t i)
+		{
+			images[i] = FileReader::readImage(relativePaths[i], 0);
+		});
+
+	for (size_t i = 0; i < images.size(); ++i)
+	{
+		if (images[i].pixels == nullptr)
+		{
+			for (Image& image : images)
+			{
+				image.free();
+			}
+
+			throw std::runtime_error(std::string("Failed to decode image ") + relativePaths[i]);
+		}
+	}
+
+	return images;
+}
+
+void ImageLoader::writeRGBA(const Image& image, uint32_t pixelFlags, void* dst)
+{
+	uint32_t jobCount = (image.height + ROWS_PER_JOB - 1) / ROWS_PER_JOB;
+
+	m_jobSystem->parallelFor(jobCount, [&](uint32_t job)
+		{
+			size_t begin = (size_t)job * ROWS_PER_JOB * image.width;
+			size_t end = std::min((size_t)(job + 1) * ROWS_PER_JOB, (size_t)image.height) * image.width;
+
+			const uint8_t* src = image.pixels + begin * image.pixelChannels;
+			uint8_t* out = static_cast<uint8_t*>(dst) + begin * 4;
+
+			if (pixelFlags == 0)
+			{
+				expandToRGBA(src, image.pixelChannels, out, end - begin);
+				return;
+			}
+
+			alignas(16) uint8_t chunk[CHUNK_PIXELS * 4];
+			for (size_t offset = 0; offset < end - begin; offset += CHUNK_PIXELS)
+			{
+				size_t count = std::min(CHUNK_PIXELS, end - begin - offset);
+				expandToRGBA(src + offset * image.pixelChannels, image.pixelChannels, chunk, count);
+
+				// Premultiplying happens in linear space
+				if (pixelFlags & PIXEL_SRGB_TO_LINEAR)
+				{
+					convertColorSpace(chunk, count, true);
+				}
+				if (pixelFlags & PIXEL_PREMULTIPLY_ALPHA)
+				{
+					premultiplyAlpha(chunk, count);
+				}
+				if (pixelFlags & PIXEL_LINEAR_TO_SRGB)
+				{
+					convertColorSpace(chunk, count, false);
+				}
+
+				memcpy(out + offset * 4, chunk, count * 4);
+			}
+		});
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "../Image.h"
+#include "../jobs/JobSystem.h"
+#include "PixelConversion.h"
+
+#include <vector>
+
+// Decodes images on the job system and converts them to RGBA8 on the way into upload memory
+class ImageLoader
+{
+public:
+	ImageLoader(JobSystem& jobSystem);
+
+	// One job per file, pixels keep the channel count stored in the file and are freed by the caller
+	std::vector<Image> decode(const std::vector<const char*>& relativePaths);
+
+	// Expands to RGBA8 and applies the PixelFlags, rows are split across the job system.
+	// dst is only written to so it can point straight into write combined staging memory.
+	void writeRGBA(const Image& image, uint32_t pixelFlags, void* dst);
+
+private:
+	JobSystem* m_jobSystem;
+};
@@ -0,0 +1,163 @@
+#include "PixelConversion.h"
+
+#include <array>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSSE3__) || defined(__AVX__)
+	#include <tmmintrin.h>
+	#define PIXEL_SSSE3
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define PIXEL_SSE2
+#endif
+
+void expandToRGBA(const uint8_t* src, uint32_t channels, uint8_t* dst, size_t pixelCount)
+{
+	if (channels == 4)
+	{
+		memcpy(dst, src, pixelCount * 4);
+		return;
+	}
+
+	size_t i = 0;
+
+#ifdef PIXEL_SSSE3
+	const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+
+	if (channels == 3)
+	{
+		// 16 bytes are loaded for 4 pixels, the last ones are left to the scalar loop
+		const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+		for (; i + 6 <= pixelCount; i += 4)
+		{
+			__m128i rgb = _mm_loadu_si128((const __m128i*)(src + i * 3));
+			_mm_storeu_si128((__m128i*)(dst + i * 4), _mm_or_si128(_mm_shuffle_epi8(rgb, shuffle), alpha));
+		}
+	}
+	else if (channels == 2)
+	{
+		const __m128i shuffleLow = _mm_setr_epi8(0, 0, 0, 1, 2, 2, 2, 3, 4, 4, 4, 5, 6, 6, 6, 7);
+		const __m128i shuffleHigh = _mm_setr_epi8(8, 8, 8, 9, 10, 10, 10, 11, 12, 12, 12, 13, 14, 14, 14, 15);
+		for (; i + 8 <= pixelCount; i += 8)
+		{
+			__m128i greyAlpha = _mm_loadu_si128((const __m128i*)(src + i * 2));
+			_mm_storeu_si128((__m128i*)(dst + i * 4), _mm_shuffle_epi8(greyAlpha, shuffleLow));
+			_mm_storeu_si128((__m128i*)(dst + i * 4 + 16), _mm_shuffle_epi8(greyAlpha, shuffleHigh));
+		}
+	}
+	else if (channels == 1)
+	{
+		for (; i + 16 <= pixelCount; i += 16)
+		{
+			__m128i grey = _mm_loadu_si128((const __m128i*)(src + i));
+			for (int quarter = 0; quarter < 4; ++quarter)
+			{
+				char b = (char)(quarter * 4);
+				__m128i shuffle = _mm_setr_epi8(b, b, b, -1, b + 1, b + 1, b + 1, -1, b + 2, b + 2, b + 2, -1, b + 3, b + 3, b + 3, -1);
+				_mm_storeu_si128((__m128i*)(dst + i * 4 + quarter * 16), _mm_or_si128(_mm_shuffle_epi8(grey, shuffle), alpha));
+			}
+		}
+	}
+#endif // PIXEL_SSSE3
+
+	for (; i < pixelCount; ++i)
+	{
+		const uint8_t* in = src + i * channels;
+		uint8_t* out = dst + i * 4;
+
+		if (channels >= 3)
+		{
+			out[0] = in[0];
+			out[1] = in[1];
+			out[2] = in[2];
+		}
+		else
+		{
+			out[0] = in[0];
+			out[1] = in[0];
+			out[2] = in[0];
+		}
+
+		out[3] = channels == 2 ? in[1] : 255;
+	}
+}
+
+static std::array<uint8_t, 256> createColorSpaceTable(bool isToLinear)
+{
+	std::array<uint8_t, 256> table;
+	for (uint32_t i = 0; i < 256; ++i)
+	{
+		float value = i / 255.0f;
+		if (isToLinear)
+		{
+			value = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+		}
+		else
+		{
+			value = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+		}
+
+		table[i] = (uint8_t)std::lround(value * 255.0f);
+	}
+
+	return table;
+}
+
+void convertColorSpace(uint8_t* rgba, size_t pixelCount, bool isToLinear)
+{
+	// A gather per channel, a table lookup beats evaluating the curve in vectors at 8 bits
+	static const std::array<uint8_t, 256> toLinear = createColorSpaceTable(true);
+	static const std::array<uint8_t, 256> toSrgb = createColorSpaceTable(false);
+
+	const uint8_t* table = isToLinear ? toLinear.data() : toSrgb.data();
+	for (size_t i = 0; i < pixelCount; ++i)
+	{
+		uint8_t* pixel = rgba + i * 4;
+		pixel[0] = table[pixel[0]];
+		pixel[1] = table[pixel[1]];
+		pixel[2] = table[pixel[2]];
+	}
+}
+
+void premultiplyAlpha(uint8_t* rgba, size_t pixelCount)
+{
+	size_t i = 0;
+
+#ifdef PIXEL_SSE2
+	// x * a / 255 rounded as (t + (t >> 8)) >> 8 with t = x * a + 128, alpha lanes are multiplied by 255
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i alphaLanes = _mm_setr_epi16(0, 0, 0, -1, 0, 0, 0, -1);
+	const __m128i opaque = _mm_set1_epi16(255);
+	const __m128i half = _mm_set1_epi16(128);
+
+	for (; i + 4 <= pixelCount; i += 4)
+	{
+		__m128i pixels = _mm_loadu_si128((const __m128i*)(rgba + i * 4));
+
+		__m128i halves[2] = { _mm_unpacklo_epi8(pixels, zero), _mm_unpackhi_epi8(pixels, zero) };
+		for (__m128i& value : halves)
+		{
+			__m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(value, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+			alpha = _mm_or_si128(_mm_andnot_si128(alphaLanes, alpha), _mm_and_si128(alphaLanes, opaque));
+
+			__m128i product = _mm_add_epi16(_mm_mullo_epi16(value, alpha), half);
+			value = _mm_srli_epi16(_mm_add_epi16(product, _mm_srli_epi16(product, 8)), 8);
+		}
+
+		_mm_storeu_si128((__m128i*)(rgba + i * 4), _mm_packus_epi16(halves[0], halves[1]));
+	}
+#endif // PIXEL_SSE2
+
+	for (; i < pixelCount; ++i)
+	{
+		uint8_t* pixel = rgba + i * 4;
+		for (uint32_t c = 0; c < 3; ++c)
+		{
+			uint32_t product = pixel[c] * pixel[3] + 128;
+			pixel[c] = (uint8_t)((product + (product >> 8)) >> 8);
+		}
+	}
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+enum PixelFlags : uint32_t
+{
+	PIXEL_SRGB_TO_LINEAR = 1 << 0,
+	PIXEL_LINEAR_TO_SRGB = 1 << 1,
+	PIXEL_PREMULTIPLY_ALPHA = 1 << 2
+};
+
+// 1 to 4 channels in, RGBA8 out, missing alpha is opaque and grey is replicated
+void expandToRGBA(const uint8_t* src, uint32_t channels, uint8_t* dst, size_t pixelCount);
+
+// Alpha is left as is
+void convertColorSpace(uint8_t* rgba, size_t pixelCount, bool isToLinear);
+void premultiplyAlpha(uint8_t* rgba, size_t pixelCount);
@@ -0,0 +1,146 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+
+JobSystem::JobSystem() :
+	m_job(nullptr),
+	m_jobCount(0),
+	m_nextJob(0),
+	m_remainingJobs(0),
+	m_generation(0),
+	m_activeWorkers(0),
+
+	m_isRunning(false)
+{
+}
+
+void JobSystem::init(uint32_t workerCount)
+{
+	if (workerCount == 0)
+	{
+		workerCount = std::max(1u, std::thread::hardware_concurrency()) - 1;
+	}
+
+	m_isRunning = true;
+	for (uint32_t i = 0; i < workerCount; ++i)
+	{
+		m_workers.emplace_back(&JobSystem::workerLoop, this);
+	}
+}
+
+void JobSystem::destroy()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_isRunning = false;
+	}
+	m_wakeCondition.notify_all();
+
+	for (std::thread& worker : m_workers)
+	{
+		worker.join();
+	}
+	m_workers.clear();
+}
+
+void JobSystem::parallelFor(uint32_t jobCount, const std::function<void(uint32_t)>& job)
+{
+	if (jobCount == 0)
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_job = &job;
+		m_jobCount = jobCount;
+		m_nextJob = 0;
+		m_remainingJobs = jobCount;
+		m_exception = nullptr;
+		++m_generation;
+	}
+
+	if (jobCount > 1)
+	{
+		m_wakeCondition.notify_all();
+	}
+
+	uint32_t completed = runJobs();
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_remainingJobs -= completed;
+	m_doneCondition.wait(lock, [this]() { return m_remainingJobs == 0 && m_activeWorkers == 0; });
+	m_job = nullptr;
+
+	if (m_exception)
+	{
+		std::rethrow_exception(m_exception);
+	}
+}
+
+uint32_t JobSystem::getThreadCount() const
+{
+	return static_cast<uint32_t>(m_workers.size()) + 1;
+}
+
+void JobSystem::workerLoop()
+{
+	uint64_t generation = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wakeCondition.wait(lock, [&]() { return m_generation != generation || !m_isRunning; });
+
+			if (!m_isRunning)
+			{
+				return;
+			}
+			generation = m_generation;
+
+			// Woke up after the others already finished
+			if (m_remainingJobs == 0)
+			{
+				continue;
+			}
+			++m_activeWorkers;
+		}
+
+		uint32_t completed = runJobs();
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_remainingJobs -= completed;
+		--m_activeWorkers;
+
+		if (m_remainingJobs == 0 && m_activeWorkers == 0)
+		{
+			m_doneCondition.notify_all();
+		}
+	}
+}
+
+uint32_t JobSystem::runJobs()
+{
+	uint32_t completed = 0;
+
+	uint32_t jobIndex;
+	while ((jobIndex = m_nextJob.fetch_add(1)) < m_jobCount)
+	{
+		try
+		{
+			(*m_job)(jobIndex);
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (!m_exception)
+			{
+				m_exception = std::current_exception();
+			}
+		}
+
+		++completed;
+	}
+
+	return completed;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <exception>
+#include <condition_variable>
+
+// Fixed pool of worker threads running fork/join jobs. The calling thread
+// takes part in the work and returns once every job has run.
+class JobSystem
+{
+public:
+	JobSystem();
+
+	// 0 picks one worker per hardware thread besides the caller
+	void init(uint32_t workerCount = 0);
+	void destroy();
+
+	// Runs job(0) .. job(jobCount - 1), at most getThreadCount() of them at once
+	void parallelFor(uint32_t jobCount, const std::function<void(uint32_t)>& job);
+
+	// Workers plus the calling thread
+	uint32_t getThreadCount() const;
+
+private:
+	void workerLoop();
+	uint32_t runJobs();
+
+private:
+	std::vector<std::thread> m_workers;
+
+	std::mutex m_mutex;
+	std::condition_variable m_wakeCondition;
+	std::condition_variable m_doneCondition;
+
+	const std::function<void(uint32_t)>* m_job;
+	uint32_t m_jobCount;
+	std::atomic<uint32_t> m_nextJob;
+	uint32_t m_remainingJobs;
+	uint64_t m_generation;
+
+	// Workers inside runJobs, the next parallelFor waits for them to leave
+	uint32_t m_activeWorkers;
+
+	std::exception_ptr m_exception;
+	bool m_isRunning;
+};
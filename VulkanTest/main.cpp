@@ -1,19 +1,184 @@
 ﻿#include <iostream>
 #include <vector>
+#include <string>
+#include <chrono>
 
 #include "Window.h"
+#include "FileReader.h"
+#include "mesh/MeshGenerator.h"
+#include "profiling/Profiler.h"
 
-int main()
+void printFrameStats(const char* label, const FrameStats& stats)
 {
-	Window window(800, 500);
+	std::cout << label << " frame ms over " << stats.frameCount << " frames:"
+		<< " mean " << stats.mean
+		<< " p50 " << stats.p50
+		<< " p95 " << stats.p95
+		<< " p99 " << stats.p99
+		<< " max " << stats.max << std::endl;
+}
+
+void printFrameStats()
+{
+	printFrameStats("cpu", Profiler::getFrameStats());
+
+	// Empty when the queue has no timestamps
+	FrameStats gpuStats = Profiler::getGpuFrameStats();
+	if (gpuStats.frameCount > 0)
+	{
+		printFrameStats("gpu", gpuStats);
+	}
+
+	printFrameStats("input latency", Profiler::getInputLatencyStats());
+}
+
+// --headless renders offscreen, --frames N stops after N frames, --readback writes the last frame to frame.ppm,
+// --trace FILE exports the profiler zones as a chrome://tracing json,
+// --pacing low-latency|throughput|vsync|uncapped and --fps-limit N control the frame pacing
+int main(int argc, char** argv)
+{
+	bool isHeadless = false;
+	bool isReadback = false;
+	uint32_t frameCount = 0;
+	const char* tracePath = nullptr;
+	PacingMode pacingMode = PacingMode::THROUGHPUT;
+	double frameLimit = 0.0;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string argument(argv[i]);
+		if (argument == "--headless")
+		{
+			isHeadless = true;
+		}
+		else if (argument == "--readback")
+		{
+			isReadback = true;
+		}
+		else if (argument == "--frames" && i + 1 < argc)
+		{
+			frameCount = (uint32_t)std::stoul(argv[++i]);
+		}
+		else if (argument == "--trace" && i + 1 < argc)
+		{
+			tracePath = argv[++i];
+		}
+		else if (argument == "--fps-limit" && i + 1 < argc)
+		{
+			frameLimit = std::stod(argv[++i]);
+		}
+		else if (argument == "--pacing" && i + 1 < argc)
+		{
+			std::string mode(argv[++i]);
+			if (mode == "low-latency")
+			{
+				pacingMode = PacingMode::LOW_LATENCY;
+			}
+			else if (mode == "vsync")
+			{
+				pacingMode = PacingMode::VSYNC;
+			}
+			else if (mode == "uncapped")
+			{
+				pacingMode = PacingMode::UNCAPPED;
+			}
+			else
+			{
+				pacingMode = PacingMode::THROUGHPUT;
+			}
+		}
+	}
+
+	if (isHeadless && frameCount == 0)
+	{
+		frameCount = 1000;
+	}
+
+	Window window(800, 500, isHeadless);
+	window.setPacingMode(pacingMode);
+	window.setFrameLimit(frameLimit);
+
+	uint32_t sphereMesh = window.loadMesh("data/bin/sphere.mesh");
+
+	uint32_t tunnelMesh;
+	{
+		JobSystem jobSystem;
+		jobSystem.init();
+
+		GeneratedSize size = MeshGenerator::getTunnelSize(256, 1024);
+		std::vector<MeshVertex> vertices(size.vertexCount);
+		std::vector<uint32_t> indices(size.indexCount);
+
+		MeshGenerator generator(&jobSystem);
+		generator.generateTunnel(256, 1024, 1.0f, 20.0f, VertexTarget::fromLayout(vertices.data(), MeshVertex::getMeshLayout(), MeshVertex::STRIDE), indices.data());
+		tunnelMesh = window.addMesh(vertices, indices, true);
+
+		jobSystem.destroy();
+	}
+
+	// Simulation thread only
+	glm::mat4 model(1);
+	window.setSceneUpdate([&model, sphereMesh, tunnelMesh](DrawList& drawList, double deltaTime)
+		{
+			model = glm::rotate(model, (float)deltaTime * glm::pi<float>() / 15, glm::vec3(0, 0, 1));
+
+			drawList.add(model);
+			drawList.add(glm::translate(glm::mat4(1), { 1, 2, -1 }));
+
+			drawList.add(glm::scale(glm::translate(glm::mat4(1), { -1.5f, 1, -1 }), glm::vec3(0.5f)), sphereMesh);
+			drawList.add(glm::translate(glm::mat4(1), { 0, 0, -3 }), tunnelMesh);
+		});
+
 	window.init();
 
-	while (window.isOpen()) 
+	std::vector<uint8_t> lastFrame;
+	uint32_t lastWidth = 0, lastHeight = 0;
+	if (isReadback)
+	{
+		window.setFrameReadback([&](const uint8_t* pixels, uint32_t width, uint32_t height)
+			{
+				lastFrame.assign(pixels, pixels + (size_t)width * height * 4);
+				lastWidth = width;
+				lastHeight = height;
+			});
+	}
+
+	auto startTime = std::chrono::steady_clock::now();
+
+	uint32_t frame = 0;
+	for (; window.isOpen() && (frameCount == 0 || frame < frameCount); ++frame)
 	{
 		window.draw();
+
+		if ((frame + 1) % 500 == 0)
+		{
+			printFrameStats();
+		}
 	}
 
+	window.flushReadbacks();
 	vkDeviceWaitIdle(window.getDevice());
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	std::cout << frame << " frames in " << seconds << " s, " << frame / seconds << " fps" << std::endl;
+	printFrameStats();
+
+	if (tracePath != nullptr)
+	{
+		Profiler::exportChromeTrace(tracePath);
+	}
+
+	if (isReadback && !lastFrame.empty())
+	{
+		std::string header = "P6\n" + std::to_string(lastWidth) + " " + std::to_string(lastHeight) + "\n255\n";
+		std::vector<char> ppm(header.begin(), header.end());
+		for (size_t i = 0; i < lastFrame.size(); i += 4)
+		{
+			ppm.insert(ppm.end(), lastFrame.begin() + i, lastFrame.begin() + i + 3);
+		}
+
+		FileReader::writeDataAtomic("frame.ppm", ppm.data(), ppm.size());
+	}
+
 	window.destroy();
 	return 0;
 }
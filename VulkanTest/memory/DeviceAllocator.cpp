@@ -0,0 +1,366 @@
+#include "DeviceAllocator.h"
+#include "../VulkanException.h"
+
+#include <algorithm>
+
+DeviceAllocator::DeviceAllocator() :
+	m_logicalDevice(VK_NULL_HANDLE),
+	m_memoryProperties({}),
+	m_defaultStrategy(AllocationStrategy::FREE_LIST),
+	m_blockSize(0)
+{
+}
+
+void DeviceAllocator::init(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, AllocationStrategy defaultStrategy, VkDeviceSize blockSize)
+{
+	m_logicalDevice = logicalDevice;
+	m_defaultStrategy = defaultStrategy;
+	m_blockSize = blockSize;
+
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &m_memoryProperties);
+}
+
+void DeviceAllocator::destroy()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	for (auto& pool : m_pools)
+	{
+		for (std::unique_ptr<MemoryBlock>& block : pool.second)
+		{
+			if (block->getMapped() != nullptr)
+			{
+				vkUnmapMemory(m_logicalDevice, block->getMemory());
+			}
+
+			vkFreeMemory(m_logicalDevice, block->getMemory(), nullptr);
+		}
+	}
+
+	m_pools.clear();
+	m_dedicatedBlocks.clear();
+}
+
+DeviceAllocation DeviceAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags propertyFlags, ResourceType resourceType)
+{
+	return allocate(requirements, propertyFlags, resourceType, m_defaultStrategy);
+}
+
+DeviceAllocation DeviceAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags propertyFlags, ResourceType resourceType, AllocationStrategy strategy)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	uint32_t memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, propertyFlags);
+	BlockPool& pool = m_pools[getPoolKey(memoryTypeIndex, resourceType, strategy)];
+
+	DeviceAllocation allocation = {};
+	allocation.alignment = requirements.alignment;
+
+	VkDeviceSize heapSize = m_memoryProperties.memoryHeaps[m_memoryProperties.memoryTypes[memoryTypeIndex].heapIndex].size;
+	VkDeviceSize blockSize = std::min(m_blockSize, std::max<VkDeviceSize>(heapSize / 8, 1024 * 1024));
+
+	// Big resources get a block of their own, returned to the driver on free
+	if (requirements.size > blockSize / 2)
+	{
+		MemoryBlock* block = createBlock(memoryTypeIndex, requirements.size, AllocationStrategy::LINEAR);
+		m_dedicatedBlocks.insert(block);
+
+		VkDeviceSize offset;
+		block->allocate(requirements.size, requirements.alignment, &offset);
+		fillAllocation(block, offset, requirements.size, allocation);
+
+		pool.emplace_back(block);
+		return allocation;
+	}
+
+	if (allocateFromPool(pool, requirements, allocation))
+	{
+		return allocation;
+	}
+
+	if (strategy == AllocationStrategy::BUDDY)
+	{
+		VkDeviceSize powerOfTwo = 1;
+		while (powerOfTwo * 2 <= blockSize)
+		{
+			powerOfTwo *= 2;
+		}
+		blockSize = powerOfTwo;
+	}
+
+	pool.emplace_back(createBlock(memoryTypeIndex, blockSize, strategy));
+
+	VkDeviceSize offset;
+	if (!pool.back()->allocate(requirements.size, requirements.alignment, &offset))
+	{
+		throw VulkanException("Failed to sub-allocate device memory.");
+	}
+	fillAllocation(pool.back().get(), offset, requirements.size, allocation);
+
+	return allocation;
+}
+
+void DeviceAllocator::free(DeviceAllocation& allocation)
+{
+	if (allocation.block == nullptr)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	MemoryBlock* block = allocation.block;
+	block->free(allocation.offset, allocation.size);
+
+	if (block->isEmpty() && m_dedicatedBlocks.erase(block) != 0)
+	{
+		destroyBlock(block);
+	}
+
+	allocation = DeviceAllocation();
+}
+
+std::vector<DefragmentationMove> DeviceAllocator::defragment(const std::vector<DeviceAllocation*>& movableAllocations)
+{
+	releaseEmptyBlocks();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// The least used block of every pool gets emptied into the others
+	std::map<MemoryBlock*, BlockPool*> sourceBlocks;
+	for (auto& pool : m_pools)
+	{
+		MemoryBlock* source = nullptr;
+		uint32_t candidateCount = 0;
+		for (std::unique_ptr<MemoryBlock>& block : pool.second)
+		{
+			if (m_dedicatedBlocks.count(block.get()) != 0)
+			{
+				continue;
+			}
+
+			++candidateCount;
+			if (source == nullptr || block->getUsed() < source->getUsed())
+			{
+				source = block.get();
+			}
+		}
+
+		if (candidateCount > 1)
+		{
+			sourceBlocks[source] = &pool.second;
+		}
+	}
+
+	std::vector<DefragmentationMove> moves;
+	for (DeviceAllocation* allocation : movableAllocations)
+	{
+		auto source = sourceBlocks.find(allocation->block);
+		if (source == sourceBlocks.end())
+		{
+			continue;
+		}
+
+		std::vector<MemoryBlock*> destinations;
+		for (std::unique_ptr<MemoryBlock>& block : *source->second)
+		{
+			if (block.get() != source->first && m_dedicatedBlocks.count(block.get()) == 0)
+			{
+				destinations.push_back(block.get());
+			}
+		}
+
+		// Densest blocks first so the sparse ones empty out
+		std::sort(destinations.begin(), destinations.end(), [](MemoryBlock* a, MemoryBlock* b) {
+			return a->getUsed() > b->getUsed();
+		});
+
+		for (MemoryBlock* destination : destinations)
+		{
+			VkDeviceSize offset;
+			if (destination->allocate(allocation->size, allocation->alignment, &offset))
+			{
+				DefragmentationMove move = {};
+				move.allocation = allocation;
+				move.destination.alignment = allocation->alignment;
+				fillAllocation(destination, offset, allocation->size, move.destination);
+
+				moves.push_back(move);
+				break;
+			}
+		}
+	}
+
+	return moves;
+}
+
+void DeviceAllocator::releaseEmptyBlocks()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	std::vector<MemoryBlock*> emptyBlocks;
+	for (auto& pool : m_pools)
+	{
+		// Keep one empty block around per pool to avoid allocation churn
+		bool isSpareKept = false;
+		for (std::unique_ptr<MemoryBlock>& block : pool.second)
+		{
+			if (!block->isEmpty())
+			{
+				continue;
+			}
+
+			if (isSpareKept)
+			{
+				emptyBlocks.push_back(block.get());
+			}
+			isSpareKept = true;
+		}
+	}
+
+	for (MemoryBlock* block : emptyBlocks)
+	{
+		destroyBlock(block);
+	}
+}
+
+DeviceAllocatorStats DeviceAllocator::getStats()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	DeviceAllocatorStats stats = {};
+
+	VkDeviceSize totalFree = 0;
+	VkDeviceSize scatteredFree = 0;
+	for (auto& pool : m_pools)
+	{
+		for (std::unique_ptr<MemoryBlock>& block : pool.second)
+		{
+			stats.bytesReserved += block->getSize();
+			stats.bytesUsed += block->getUsed();
+			stats.allocationCount += block->getAllocationCount();
+			++stats.blockCount;
+
+			VkDeviceSize blockFree = block->getSize() - block->getUsed();
+			totalFree += blockFree;
+			scatteredFree += blockFree - std::min(blockFree, block->getLargestFreeRange());
+		}
+	}
+
+	stats.fragmentation = totalFree == 0 ? 0.0f : (float)((double)scatteredFree / (double)totalFree);
+
+	return stats;
+}
+
+uint32_t DeviceAllocator::findMemoryType(uint32_t memoryTypeFilter, VkMemoryPropertyFlags memoryPropertyFlags) const
+{
+	for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; ++i)
+	{
+		if (memoryTypeFilter & (1 << i) && (m_memoryProperties.memoryTypes[i].propertyFlags & memoryPropertyFlags) == memoryPropertyFlags)
+		{
+			return i;
+		}
+	}
+
+	throw VulkanException("Failed to find suitable memory type.");
+}
+
+const VkPhysicalDeviceMemoryProperties& DeviceAllocator::getMemoryProperties() const
+{
+	return m_memoryProperties;
+}
+
+uint32_t DeviceAllocator::getPoolKey(uint32_t memoryTypeIndex, ResourceType resourceType, AllocationStrategy strategy) const
+{
+	// Buffers and optimal images live in separate blocks so bufferImageGranularity never applies
+	return memoryTypeIndex | ((uint32_t)resourceType << 8) | ((uint32_t)strategy << 16);
+}
+
+MemoryBlock* DeviceAllocator::createBlock(uint32_t memoryTypeIndex, VkDeviceSize size, AllocationStrategy strategy)
+{
+	VkMemoryAllocateInfo memoryAllocateInfo = {};
+	memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	memoryAllocateInfo.allocationSize = size;
+	memoryAllocateInfo.memoryTypeIndex = memoryTypeIndex;
+
+	VkDeviceMemory memory;
+	if (vkAllocateMemory(m_logicalDevice, &memoryAllocateInfo, nullptr, &memory) != VK_SUCCESS)
+	{
+		throw VulkanException("Failed to allocate device memory block.");
+	}
+
+	void* mapped = nullptr;
+	if (m_memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+	{
+		if (vkMapMemory(m_logicalDevice, memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS)
+		{
+			throw VulkanException("Failed to map device memory block.");
+		}
+	}
+
+	switch (strategy)
+	{
+	case AllocationStrategy::LINEAR:
+		return new LinearBlock(memory, size, mapped);
+	case AllocationStrategy::BUDDY:
+		return new BuddyBlock(memory, size, mapped);
+	default:
+		return new FreeListBlock(memory, size, mapped);
+	}
+}
+
+void DeviceAllocator::destroyBlock(MemoryBlock* block)
+{
+	for (auto& pool : m_pools)
+	{
+		for (auto it = pool.second.begin(); it != pool.second.end(); ++it)
+		{
+			if (it->get() != block)
+			{
+				continue;
+			}
+
+			if (block->getMapped() != nullptr)
+			{
+				vkUnmapMemory(m_logicalDevice, block->getMemory());
+			}
+			vkFreeMemory(m_logicalDevice, block->getMemory(), nullptr);
+
+			pool.second.erase(it);
+			return;
+		}
+	}
+}
+
+bool DeviceAllocator::allocateFromPool(BlockPool& pool, const VkMemoryRequirements& requirements, DeviceAllocation& allocation)
+{
+	for (std::unique_ptr<MemoryBlock>& block : pool)
+	{
+		if (m_dedicatedBlocks.count(block.get()) != 0)
+		{
+			continue;
+		}
+
+		VkDeviceSize offset;
+		if (block->allocate(requirements.size, requirements.alignment, &offset))
+		{
+			fillAllocation(block.get(), offset, requirements.size, allocation);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void DeviceAllocator::fillAllocation(MemoryBlock* block, VkDeviceSize offset, VkDeviceSize size, DeviceAllocation& allocation)
+{
+	allocation.memory = block->getMemory();
+	allocation.offset = offset;
+	allocation.size = size;
+	allocation.block = block;
+
+	if (block->getMapped() != nullptr)
+	{
+		allocation.mapped = static_cast<char*>(block->getMapped()) + offset;
+	}
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "MemoryBlock.h"
+
+#include <memory>
+#include <mutex>
+
+enum class ResourceType
+{
+	BUFFER,
+	IMAGE
+};
+
+struct DeviceAllocation
+{
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0;
+	VkDeviceSize alignment = 0;
+
+	// Only set for host visible memory, blocks stay mapped for their whole lifetime
+	void* mapped = nullptr;
+
+	MemoryBlock* block = nullptr;
+};
+
+struct DeviceAllocatorStats
+{
+	VkDeviceSize bytesReserved;
+	VkDeviceSize bytesUsed;
+
+	uint32_t allocationCount;
+	uint32_t blockCount;
+
+	// Free bytes outside each block's largest free range / total free, 0 when every block's free space is contiguous.
+	// Ranges in different blocks can't merge, so a free range counts as contiguous only within its block.
+	float fragmentation;
+};
+
+struct DefragmentationMove
+{
+	DeviceAllocation* allocation;
+	DeviceAllocation destination;
+};
+
+class DeviceAllocator
+{
+public:
+	DeviceAllocator();
+
+	void init(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, AllocationStrategy defaultStrategy = AllocationStrategy::FREE_LIST, VkDeviceSize blockSize = 64 * 1024 * 1024);
+	void destroy();
+
+	DeviceAllocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags propertyFlags, ResourceType resourceType);
+	DeviceAllocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags propertyFlags, ResourceType resourceType, AllocationStrategy strategy);
+	void free(DeviceAllocation& allocation);
+
+	// Releases empty blocks and plans moves out of the emptiest blocks. The destinations are already
+	// reserved, the caller copies the data, rebinds its resource and frees the old allocation.
+	std::vector<DefragmentationMove> defragment(const std::vector<DeviceAllocation*>& movableAllocations);
+	void releaseEmptyBlocks();
+
+	DeviceAllocatorStats getStats();
+
+	uint32_t findMemoryType(uint32_t memoryTypeFilter, VkMemoryPropertyFlags memoryPropertyFlags) const;
+	const VkPhysicalDeviceMemoryProperties& getMemoryProperties() const;
+
+private:
+	typedef std::vector<std::unique_ptr<MemoryBlock>> BlockPool;
+
+	uint32_t getPoolKey(uint32_t memoryTypeIndex, ResourceType resourceType, AllocationStrategy strategy) const;
+
+	MemoryBlock* createBlock(uint32_t memoryTypeIndex, VkDeviceSize size, AllocationStrategy strategy);
+	void destroyBlock(MemoryBlock* block);
+
+	bool allocateFromPool(BlockPool& pool, const VkMemoryRequirements& requirements, DeviceAllocation& allocation);
+	void fillAllocation(MemoryBlock* block, VkDeviceSize offset, VkDeviceSize size, DeviceAllocation& allocation);
+
+private:
+	VkDevice m_logicalDevice;
+
+	VkPhysicalDeviceMemoryProperties m_memoryProperties;
+	AllocationStrategy m_defaultStrategy;
+	VkDeviceSize m_blockSize;
+
+	std::map<uint32_t, BlockPool> m_pools;
+	std::set<MemoryBlock*> m_dedicatedBlocks;
+	std::mutex m_mutex;
+};
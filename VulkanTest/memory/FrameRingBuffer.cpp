@@ -0,0 +1,109 @@
+#include "FrameRingBuffer.h"
+#include "../VulkanException.h"
+
+#include <cstring>
+
+FrameRingBuffer::FrameRingBuffer() :
+	m_logicalDevice(VK_NULL_HANDLE),
+
+	m_buffer(VK_NULL_HANDLE),
+
+	m_frameSize(0),
+	m_frameCount(0),
+	m_alignment(1),
+
+	m_frameOffset(0),
+	m_head(0)
+{
+}
+
+void FrameRingBuffer::init(VkDevice logicalDevice, DeviceAllocator& allocator, VkBufferUsageFlags usageFlags, VkDeviceSize frameSize, uint32_t frameCount, VkDeviceSize alignment)
+{
+	m_logicalDevice = logicalDevice;
+	m_alignment = alignment;
+	m_frameSize = alignUp(frameSize, alignment);
+	m_frameCount = frameCount;
+
+	VkBufferCreateInfo bufferCreateInfo = {};
+	bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferCreateInfo.size = m_frameSize * m_frameCount;
+	bufferCreateInfo.usage = usageFlags;
+	bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateBuffer(m_logicalDevice, &bufferCreateInfo, nullptr, &m_buffer) != VK_SUCCESS)
+	{
+		throw VulkanException("Failed to create ring buffer.");
+	}
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetBufferMemoryRequirements(m_logicalDevice, m_buffer, &memoryRequirements);
+
+	m_memory = allocator.allocate(memoryRequirements,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		ResourceType::BUFFER);
+
+	vkBindBufferMemory(m_logicalDevice, m_buffer, m_memory.memory, m_memory.offset);
+
+	m_frameOffset = 0;
+	m_head = 0;
+}
+
+void FrameRingBuffer::destroy(DeviceAllocator& allocator)
+{
+	vkDestroyBuffer(m_logicalDevice, m_buffer, nullptr);
+	allocator.free(m_memory);
+
+	m_buffer = VK_NULL_HANDLE;
+}
+
+void FrameRingBuffer::beginFrame(uint32_t frameIndex)
+{
+	m_frameOffset = getFrameOffset(frameIndex);
+	m_head = 0;
+}
+
+uint32_t FrameRingBuffer::push(const void* data, VkDeviceSize size)
+{
+	uint32_t offset;
+	memcpy(allocate(size, &offset), data, (size_t)size);
+
+	return offset;
+}
+
+void* FrameRingBuffer::allocate(VkDeviceSize size, uint32_t* offset)
+{
+	if (m_head + size > m_frameSize)
+	{
+		throw VulkanException("Ring buffer frame region overflow.");
+	}
+
+	*offset = (uint32_t)(m_frameOffset + m_head);
+	m_head += getAlignedSize(size);
+
+	return static_cast<char*>(m_memory.mapped) + *offset;
+}
+
+VkDeviceSize FrameRingBuffer::getAlignedSize(VkDeviceSize size) const
+{
+	return alignUp(size, m_alignment);
+}
+
+uint32_t FrameRingBuffer::getFrameOffset(uint32_t frameIndex) const
+{
+	return (uint32_t)(frameIndex * m_frameSize);
+}
+
+VkBuffer FrameRingBuffer::getBuffer() const
+{
+	return m_buffer;
+}
+
+VkDeviceSize FrameRingBuffer::getFrameSize() const
+{
+	return m_frameSize;
+}
+
+uint32_t FrameRingBuffer::getFrameCount() const
+{
+	return m_frameCount;
+}
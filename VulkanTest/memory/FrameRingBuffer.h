@@ -0,0 +1,39 @@
+#pragma once
+
+#include "DeviceAllocator.h"
+
+// One host visible buffer split in a region per frame, written linearly every frame
+// and addressed through dynamic offsets.
+class FrameRingBuffer
+{
+public:
+	FrameRingBuffer();
+
+	void init(VkDevice logicalDevice, DeviceAllocator& allocator, VkBufferUsageFlags usageFlags, VkDeviceSize frameSize, uint32_t frameCount, VkDeviceSize alignment);
+	void destroy(DeviceAllocator& allocator);
+
+	void beginFrame(uint32_t frameIndex);
+
+	uint32_t push(const void* data, VkDeviceSize size);
+	void* allocate(VkDeviceSize size, uint32_t* offset);
+
+	VkDeviceSize getAlignedSize(VkDeviceSize size) const;
+	uint32_t getFrameOffset(uint32_t frameIndex) const;
+
+	VkBuffer getBuffer() const;
+	VkDeviceSize getFrameSize() const;
+	uint32_t getFrameCount() const;
+
+private:
+	VkDevice m_logicalDevice;
+
+	VkBuffer m_buffer;
+	DeviceAllocation m_memory;
+
+	VkDeviceSize m_frameSize;
+	uint32_t m_frameCount;
+	VkDeviceSize m_alignment;
+
+	VkDeviceSize m_frameOffset;
+	VkDeviceSize m_head;
+};
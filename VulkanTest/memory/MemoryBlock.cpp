@@ -0,0 +1,270 @@
+#include "MemoryBlock.h"
+
+#include <algorithm>
+
+VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+	if (alignment <= 1)
+	{
+		return value;
+	}
+
+	return ((value + alignment - 1) / alignment) * alignment;
+}
+
+
+MemoryBlock::MemoryBlock(VkDeviceMemory memory, VkDeviceSize size, void* mapped) :
+	m_memory(memory),
+	m_size(size),
+	m_mapped(mapped),
+
+	m_used(0),
+	m_allocationCount(0)
+{
+}
+
+
+
+////////////////////////
+////// LINEAR //////////
+////////////////////////
+
+LinearBlock::LinearBlock(VkDeviceMemory memory, VkDeviceSize size, void* mapped) :
+	MemoryBlock(memory, size, mapped),
+	m_head(0)
+{
+}
+
+bool LinearBlock::allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize* offset)
+{
+	VkDeviceSize alignedOffset = alignUp(m_head, alignment);
+	if (alignedOffset + size > m_size)
+	{
+		return false;
+	}
+
+	*offset = alignedOffset;
+	m_head = alignedOffset + size;
+
+	m_used += size;
+	++m_allocationCount;
+
+	return true;
+}
+
+void LinearBlock::free(VkDeviceSize offset, VkDeviceSize size)
+{
+	m_used -= size;
+	--m_allocationCount;
+
+	if (m_allocationCount == 0)
+	{
+		m_head = 0;
+	}
+	else if (offset + size == m_head)
+	{
+		m_head = offset;
+	}
+}
+
+VkDeviceSize LinearBlock::getLargestFreeRange() const
+{
+	return m_size - m_head;
+}
+
+
+
+///////////////////////
+////// BUDDY //////////
+///////////////////////
+
+BuddyBlock::BuddyBlock(VkDeviceMemory memory, VkDeviceSize size, void* mapped, VkDeviceSize minBlockSize) :
+	MemoryBlock(memory, size, mapped),
+	m_minBlockSize(minBlockSize)
+{
+	uint32_t maxOrder = 0;
+	while ((m_minBlockSize << maxOrder) < m_size)
+	{
+		++maxOrder;
+	}
+
+	m_freeOffsets.resize(maxOrder + 1);
+	m_freeOffsets[maxOrder].insert(0);
+}
+
+bool BuddyBlock::allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize* offset)
+{
+	// Buddies are aligned to their own size
+	VkDeviceSize needed = std::max({ size, alignment, m_minBlockSize });
+
+	uint32_t order = 0;
+	while (getOrderSize(order) < needed)
+	{
+		++order;
+	}
+
+	if (order >= m_freeOffsets.size())
+	{
+		return false;
+	}
+
+	uint32_t freeOrder = order;
+	while (freeOrder < m_freeOffsets.size() && m_freeOffsets[freeOrder].empty())
+	{
+		++freeOrder;
+	}
+
+	if (freeOrder == m_freeOffsets.size())
+	{
+		return false;
+	}
+
+	VkDeviceSize blockOffset = *m_freeOffsets[freeOrder].begin();
+	m_freeOffsets[freeOrder].erase(m_freeOffsets[freeOrder].begin());
+
+	while (freeOrder > order)
+	{
+		--freeOrder;
+		m_freeOffsets[freeOrder].insert(blockOffset + getOrderSize(freeOrder));
+	}
+
+	m_allocatedOrders[blockOffset] = order;
+	*offset = blockOffset;
+
+	m_used += getOrderSize(order);
+	++m_allocationCount;
+
+	return true;
+}
+
+void BuddyBlock::free(VkDeviceSize offset, VkDeviceSize size)
+{
+	auto allocated = m_allocatedOrders.find(offset);
+	if (allocated == m_allocatedOrders.end())
+	{
+		return;
+	}
+
+	uint32_t order = allocated->second;
+	m_allocatedOrders.erase(allocated);
+
+	m_used -= getOrderSize(order);
+	--m_allocationCount;
+
+	while (order + 1 < m_freeOffsets.size())
+	{
+		VkDeviceSize buddyOffset = offset ^ getOrderSize(order);
+		if (m_freeOffsets[order].erase(buddyOffset) == 0)
+		{
+			break;
+		}
+
+		offset = std::min(offset, buddyOffset);
+		++order;
+	}
+
+	m_freeOffsets[order].insert(offset);
+}
+
+VkDeviceSize BuddyBlock::getLargestFreeRange() const
+{
+	for (int order = (int)m_freeOffsets.size() - 1; order >= 0; --order)
+	{
+		if (!m_freeOffsets[order].empty())
+		{
+			return getOrderSize(order);
+		}
+	}
+
+	return 0;
+}
+
+VkDeviceSize BuddyBlock::getOrderSize(uint32_t order) const
+{
+	return m_minBlockSize << order;
+}
+
+
+
+///////////////////////////
+////// FREE LIST //////////
+///////////////////////////
+
+FreeListBlock::FreeListBlock(VkDeviceMemory memory, VkDeviceSize size, void* mapped) :
+	MemoryBlock(memory, size, mapped)
+{
+	m_freeRanges[0] = size;
+}
+
+bool FreeListBlock::allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize* offset)
+{
+	for (auto range = m_freeRanges.begin(); range != m_freeRanges.end(); ++range)
+	{
+		VkDeviceSize rangeOffset = range->first;
+		VkDeviceSize rangeEnd = range->first + range->second;
+
+		VkDeviceSize alignedOffset = alignUp(rangeOffset, alignment);
+		if (alignedOffset + size > rangeEnd)
+		{
+			continue;
+		}
+
+		m_freeRanges.erase(range);
+
+		// Alignment padding stays in the free list
+		if (alignedOffset > rangeOffset)
+		{
+			m_freeRanges[rangeOffset] = alignedOffset - rangeOffset;
+		}
+
+		if (alignedOffset + size < rangeEnd)
+		{
+			m_freeRanges[alignedOffset + size] = rangeEnd - (alignedOffset + size);
+		}
+
+		*offset = alignedOffset;
+
+		m_used += size;
+		++m_allocationCount;
+
+		return true;
+	}
+
+	return false;
+}
+
+void FreeListBlock::free(VkDeviceSize offset, VkDeviceSize size)
+{
+	m_used -= size;
+	--m_allocationCount;
+
+	auto inserted = m_freeRanges.emplace(offset, size).first;
+
+	auto next = std::next(inserted);
+	if (next != m_freeRanges.end() && inserted->first + inserted->second == next->first)
+	{
+		inserted->second += next->second;
+		m_freeRanges.erase(next);
+	}
+
+	if (inserted != m_freeRanges.begin())
+	{
+		auto previous = std::prev(inserted);
+		if (previous->first + previous->second == inserted->first)
+		{
+			previous->second += inserted->second;
+			m_freeRanges.erase(inserted);
+		}
+	}
+}
+
+VkDeviceSize FreeListBlock::getLargestFreeRange() const
+{
+	VkDeviceSize largest = 0;
+	for (const auto& range : m_freeRanges)
+	{
+		largest = std::max(largest, range.second);
+	}
+
+	return largest;
+}
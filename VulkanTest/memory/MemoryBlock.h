@@ -0,0 +1,99 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <set>
+#include <map>
+
+enum class AllocationStrategy
+{
+	LINEAR,
+	BUDDY,
+	FREE_LIST
+};
+
+VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment);
+
+class MemoryBlock
+{
+public:
+	MemoryBlock(VkDeviceMemory memory, VkDeviceSize size, void* mapped);
+	virtual ~MemoryBlock() = default;
+
+	virtual bool allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize* offset) = 0;
+	virtual void free(VkDeviceSize offset, VkDeviceSize size) = 0;
+
+	virtual VkDeviceSize getLargestFreeRange() const = 0;
+
+	VkDeviceMemory getMemory() const { return m_memory; }
+	VkDeviceSize getSize() const { return m_size; }
+	VkDeviceSize getUsed() const { return m_used; }
+	uint32_t getAllocationCount() const { return m_allocationCount; }
+	void* getMapped() const { return m_mapped; }
+
+	bool isEmpty() const { return m_allocationCount == 0; }
+
+protected:
+	VkDeviceMemory m_memory;
+	VkDeviceSize m_size;
+	void* m_mapped;
+
+	VkDeviceSize m_used;
+	uint32_t m_allocationCount;
+};
+
+
+// Bump allocator, space is only reclaimed from the top or when the block empties.
+class LinearBlock : public MemoryBlock
+{
+public:
+	LinearBlock(VkDeviceMemory memory, VkDeviceSize size, void* mapped);
+
+	bool allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize* offset) override;
+	void free(VkDeviceSize offset, VkDeviceSize size) override;
+
+	VkDeviceSize getLargestFreeRange() const override;
+
+private:
+	VkDeviceSize m_head;
+};
+
+
+// Power of two splitting, size must be a power of two.
+class BuddyBlock : public MemoryBlock
+{
+public:
+	BuddyBlock(VkDeviceMemory memory, VkDeviceSize size, void* mapped, VkDeviceSize minBlockSize = 256);
+
+	bool allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize* offset) override;
+	void free(VkDeviceSize offset, VkDeviceSize size) override;
+
+	VkDeviceSize getLargestFreeRange() const override;
+
+private:
+	VkDeviceSize getOrderSize(uint32_t order) const;
+
+private:
+	VkDeviceSize m_minBlockSize;
+
+	std::vector<std::set<VkDeviceSize>> m_freeOffsets;
+	std::map<VkDeviceSize, uint32_t> m_allocatedOrders;
+};
+
+
+// First fit over sorted free ranges, neighbours are merged on free.
+class FreeListBlock : public MemoryBlock
+{
+public:
+	FreeListBlock(VkDeviceMemory memory, VkDeviceSize size, void* mapped);
+
+	bool allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize* offset) override;
+	void free(VkDeviceSize offset, VkDeviceSize size) override;
+
+	VkDeviceSize getLargestFreeRange() const override;
+
+private:
+	std::map<VkDeviceSize, VkDeviceSize> m_freeRanges;
+};
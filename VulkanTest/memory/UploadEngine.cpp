@@ -0,0 +1,692 @@
+#include "UploadEngine.h"
+#include "../VulkanException.h"
+
+#include <algorithm>
+#include <cstring>
+
+UploadEngine::UploadEngine() :
+	m_logicalDevice(VK_NULL_HANDLE),
+	m_allocator(nullptr),
+
+	m_transferFamily(0),
+	m_transferQueue(VK_NULL_HANDLE),
+	m_graphicsFamily(0),
+	m_graphicsQueue(VK_NULL_HANDLE),
+
+	m_transferCommandPool(VK_NULL_HANDLE),
+	m_graphicsCommandPool(VK_NULL_HANDLE),
+
+	m_stagingBuffer(VK_NULL_HANDLE),
+	m_segmentSize(0),
+
+	m_currentBatch(0),
+	m_isRunning(false)
+{
+}
+
+void UploadEngine::init(
+	VkDevice logicalDevice,
+	DeviceAllocator& allocator,
+	uint32_t transferFamily, VkQueue transferQueue,
+	uint32_t graphicsFamily, VkQueue graphicsQueue,
+	VkDeviceSize stagingSize)
+{
+	m_logicalDevice = logicalDevice;
+	m_allocator = &allocator;
+
+	m_transferFamily = transferFamily;
+	m_transferQueue = transferQueue;
+	m_graphicsFamily = graphicsFamily;
+	m_graphicsQueue = graphicsQueue;
+
+	///////////////////////////
+	////// COMMAND POOLS //////
+	///////////////////////////
+
+	VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+	commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+	commandPoolCreateInfo.queueFamilyIndex = m_transferFamily;
+	if (vkCreateCommandPool(m_logicalDevice, &commandPoolCreateInfo, nullptr, &m_transferCommandPool) != VK_SUCCESS)
+	{
+		throw VulkanException("Failed to create transfer command pool.");
+	}
+
+	commandPoolCreateInfo.queueFamilyIndex = m_graphicsFamily;
+	if (vkCreateCommandPool(m_logicalDevice, &commandPoolCreateInfo, nullptr, &m_graphicsCommandPool) != VK_SUCCESS)
+	{
+		throw VulkanException("Failed to create upload acquire command pool.");
+	}
+
+	/////////////////////
+	////// BATCHES //////
+	/////////////////////
+
+	VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+	commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	commandBufferAllocateInfo.commandBufferCount = 1;
+
+	VkSemaphoreCreateInfo semaphoreCreateInfo = {};
+	semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	VkFenceCreateInfo fenceCreateInfo = {};
+	fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	fenceCreateInfo.flags = 0;
+
+	for (Batch& batch : m_batches)
+	{
+		commandBufferAllocateInfo.commandPool = m_transferCommandPool;
+		if (vkAllocateCommandBuffers(m_logicalDevice, &commandBufferAllocateInfo, &batch.transferCommandBuffer) != VK_SUCCESS)
+		{
+			throw VulkanException("Failed to allocate transfer command buffer.");
+		}
+
+		commandBufferAllocateInfo.commandPool = m_graphicsCommandPool;
+		if (vkAllocateCommandBuffers(m_logicalDevice, &commandBufferAllocateInfo, &batch.acquireCommandBuffer) != VK_SUCCESS)
+		{
+			throw VulkanException("Failed to allocate upload acquire command buffer.");
+		}
+
+		if (vkCreateSemaphore(m_logicalDevice, &semaphoreCreateInfo, nullptr, &batch.transferedSemaphore) != VK_SUCCESS ||
+			vkCreateFence(m_logicalDevice, &fenceCreateInfo, nullptr, &batch.fence) != VK_SUCCESS)
+		{
+			throw VulkanException("Failed to create upload sync objects.");
+		}
+	}
+
+	/////////////////////
+	////// STAGING //////
+	/////////////////////
+
+	// Every batch owns one segment of the ring
+	m_segmentSize = alignUp(stagingSize / BATCH_COUNT, 256);
+
+	VkBufferCreateInfo bufferCreateInfo = {};
+	bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferCreateInfo.size = m_segmentSize * BATCH_COUNT;
+	bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateBuffer(m_logicalDevice, &bufferCreateInfo, nullptr, &m_stagingBuffer) != VK_SUCCESS)
+	{
+		throw VulkanException("Failed to create staging ring.");
+	}
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetBufferMemoryRequirements(m_logicalDevice, m_stagingBuffer, &memoryRequirements);
+
+	m_stagingMemory = m_allocator->allocate(memoryRequirements,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		ResourceType::BUFFER);
+
+	vkBindBufferMemory(m_logicalDevice, m_stagingBuffer, m_stagingMemory.memory, m_stagingMemory.offset);
+
+	m_isRunning = true;
+	m_completionThread = std::thread(&UploadEngine::completionLoop, this);
+}
+
+void UploadEngine::destroy()
+{
+	waitIdle();
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_isRunning = false;
+	}
+	m_condition.notify_all();
+	m_completionThread.join();
+
+	for (Batch& batch : m_batches)
+	{
+		vkDestroySemaphore(m_logicalDevice, batch.transferedSemaphore, nullptr);
+		vkDestroyFence(m_logicalDevice, batch.fence, nullptr);
+	}
+
+	vkDestroyCommandPool(m_logicalDevice, m_transferCommandPool, nullptr);
+	vkDestroyCommandPool(m_logicalDevice, m_graphicsCommandPool, nullptr);
+
+	vkDestroyBuffer(m_logicalDevice, m_stagingBuffer, nullptr);
+	m_allocator->free(m_stagingMemory);
+}
+
+std::shared_future<void> UploadEngine::uploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size)
+{
+	std::lock_guard<std::mutex> recordLock(m_recordMutex);
+
+	VkBuffer stagingBuffer;
+	VkDeviceSize stagingOffset;
+	memcpy(reserveStaging(size, 16, &stagingBuffer, &stagingOffset), data, (size_t)size);
+
+	Batch& batch = m_batches[m_currentBatch];
+
+	VkBufferCopy copyRegion = {};
+	copyRegion.srcOffset = stagingOffset;
+	copyRegion.dstOffset = dstOffset;
+	copyRegion.size = size;
+	vkCmdCopyBuffer(batch.transferCommandBuffer, stagingBuffer, dstBuffer, 1, &copyRegion);
+
+	if (hasSeparateFamilies())
+	{
+		VkBufferMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcQueueFamilyIndex = m_transferFamily;
+		barrier.dstQueueFamilyIndex = m_graphicsFamily;
+		barrier.buffer = dstBuffer;
+		barrier.offset = dstOffset;
+		barrier.size = size;
+
+		// Release
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = 0;
+		vkCmdPipelineBarrier(batch.transferCommandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+			0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+		// Acquire
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+		vkCmdPipelineBarrier(batch.acquireCommandBuffer,
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+			0, 0, nullptr, 1, &barrier, 0, nullptr);
+	}
+
+	return batch.future;
+}
+
+std::shared_future<void> UploadEngine::uploadImage(VkImage dstImage, uint32_t width, uint32_t height, const std::vector<VkDeviceSize>& levelOffsets, const void* data, VkDeviceSize size)
+{
+	return uploadImage(dstImage, width, height, levelOffsets, size, [data, size](void* staging)
+		{
+			memcpy(staging, data, (size_t)size);
+		});
+}
+
+std::shared_future<void> UploadEngine::uploadImage(VkImage dstImage, uint32_t width, uint32_t height, const std::vector<VkDeviceSize>& levelOffsets, VkDeviceSize size, const StagingWriter& writeStaging)
+{
+	std::lock_guard<std::mutex> recordLock(m_recordMutex);
+
+	VkBuffer stagingBuffer;
+	VkDeviceSize stagingOffset;
+	writeStaging(reserveStaging(size, 16, &stagingBuffer, &stagingOffset));
+
+	Batch& batch = m_batches[m_currentBatch];
+
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.image = dstImage;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = (uint32_t)levelOffsets.size();
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	vkCmdPipelineBarrier(batch.transferCommandBuffer,
+		VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	std::vector<VkBufferImageCopy> copyRegions(levelOffsets.size());
+	for (uint32_t level = 0; level < copyRegions.size(); ++level)
+	{
+		VkBufferImageCopy& copyRegion = copyRegions[level];
+		copyRegion.bufferOffset = stagingOffset + levelOffsets[level];
+		copyRegion.bufferRowLength = 0;
+		copyRegion.bufferImageHeight = 0;
+		copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		copyRegion.imageSubresource.mipLevel = level;
+		copyRegion.imageSubresource.baseArrayLayer = 0;
+		copyRegion.imageSubresource.layerCount = 1;
+		copyRegion.imageOffset = { 0, 0, 0 };
+		copyRegion.imageExtent = { std::max(width >> level, 1u), std::max(height >> level, 1u), 1 };
+	}
+	vkCmdCopyBufferToImage(batch.transferCommandBuffer, stagingBuffer, dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		(uint32_t)copyRegions.size(), copyRegions.data());
+
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	if (hasSeparateFamilies())
+	{
+		barrier.srcQueueFamilyIndex = m_transferFamily;
+		barrier.dstQueueFamilyIndex = m_graphicsFamily;
+
+		// Release
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = 0;
+		vkCmdPipelineBarrier(batch.transferCommandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+			0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		// Acquire
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(batch.acquireCommandBuffer,
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			0, 0, nullptr, 0, nullptr, 1, &barrier);
+	}
+	else
+	{
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(batch.transferCommandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			0, 0, nullptr, 0, nullptr, 1, &barrier);
+	}
+
+	return batch.future;
+}
+
+std::shared_future<void> UploadEngine::uploadImageGenerateMips(VkImage dstImage, uint32_t width, uint32_t height, uint32_t mipLevels, const void* data, VkDeviceSize size)
+{
+	return uploadImageGenerateMips(dstImage, width, height, mipLevels, size, [data, size](void* staging)
+		{
+			memcpy(staging, data, (size_t)size);
+		});
+}
+
+std::shared_future<void> UploadEngine::uploadImageGenerateMips(VkImage dstImage, uint32_t width, uint32_t height, uint32_t mipLevels, VkDeviceSize size, const StagingWriter& writeStaging)
+{
+	std::lock_guard<std::mutex> recordLock(m_recordMutex);
+
+	VkBuffer stagingBuffer;
+	VkDeviceSize stagingOffset;
+	writeStaging(reserveStaging(size, 16, &stagingBuffer, &stagingOffset));
+
+	Batch& batch = m_batches[m_currentBatch];
+
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.image = dstImage;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = mipLevels;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	vkCmdPipelineBarrier(batch.transferCommandBuffer,
+		VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	VkBufferImageCopy copyRegion = {};
+	copyRegion.bufferOffset = stagingOffset;
+	copyRegion.bufferRowLength = 0;
+	copyRegion.bufferImageHeight = 0;
+	copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	copyRegion.imageSubresource.mipLevel = 0;
+	copyRegion.imageSubresource.baseArrayLayer = 0;
+	copyRegion.imageSubresource.layerCount = 1;
+	copyRegion.imageOffset = { 0, 0, 0 };
+	copyRegion.imageExtent = { width, height, 1 };
+	vkCmdCopyBufferToImage(batch.transferCommandBuffer, stagingBuffer, dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
+
+	// Blits need a graphics capable queue, a dedicated transfer family hands the whole image over first
+	VkCommandBuffer blitCommandBuffer = batch.transferCommandBuffer;
+	if (hasSeparateFamilies())
+	{
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.srcQueueFamilyIndex = m_transferFamily;
+		barrier.dstQueueFamilyIndex = m_graphicsFamily;
+
+		// Release
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = 0;
+		vkCmdPipelineBarrier(batch.transferCommandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+			0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		// Acquire
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+		vkCmdPipelineBarrier(batch.acquireCommandBuffer,
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+			0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		blitCommandBuffer = batch.acquireCommandBuffer;
+	}
+
+	recordMipBlits(blitCommandBuffer, dstImage, width, height, mipLevels);
+
+	return batch.future;
+}
+
+std::shared_future<void> UploadEngine::flush()
+{
+	std::lock_guard<std::mutex> recordLock(m_recordMutex);
+
+	Batch& batch = m_batches[m_currentBatch];
+	if (batch.state == BatchState::RECORDING)
+	{
+		submitBatch(batch);
+	}
+
+	if (!m_lastFuture.valid())
+	{
+		std::promise<void> ready;
+		ready.set_value();
+		m_lastFuture = ready.get_future().share();
+	}
+
+	return m_lastFuture;
+}
+
+void UploadEngine::waitIdle()
+{
+	flush();
+
+	std::vector<std::shared_future<void>> pending;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (Batch* batch : m_inFlight)
+		{
+			pending.push_back(batch->future);
+		}
+	}
+
+	for (std::shared_future<void>& future : pending)
+	{
+		future.wait();
+	}
+}
+
+std::mutex& UploadEngine::getQueueMutex()
+{
+	return m_queueMutex;
+}
+
+void UploadEngine::recordMipBlits(VkCommandBuffer commandBuffer, VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels)
+{
+	// Every level starts in TRANSFER_DST, is read once as a blit source and then left for the shaders
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.image = image;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+
+	int32_t srcWidth = (int32_t)width;
+	int32_t srcHeight = (int32_t)height;
+
+	for (uint32_t level = 1; level < mipLevels; ++level)
+	{
+		int32_t dstWidth = std::max(srcWidth / 2, 1);
+		int32_t dstHeight = std::max(srcHeight / 2, 1);
+
+		barrier.subresourceRange.baseMipLevel = level - 1;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+			0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		VkImageBlit blit = {};
+		blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		blit.srcSubresource.mipLevel = level - 1;
+		blit.srcSubresource.baseArrayLayer = 0;
+		blit.srcSubresource.layerCount = 1;
+		blit.srcOffsets[0] = { 0, 0, 0 };
+		blit.srcOffsets[1] = { srcWidth, srcHeight, 1 };
+
+		blit.dstSubresource = blit.srcSubresource;
+		blit.dstSubresource.mipLevel = level;
+		blit.dstOffsets[0] = { 0, 0, 0 };
+		blit.dstOffsets[1] = { dstWidth, dstHeight, 1 };
+
+		vkCmdBlitImage(commandBuffer,
+			image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			1, &blit, VK_FILTER_LINEAR);
+
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		srcWidth = dstWidth;
+		srcHeight = dstHeight;
+	}
+
+	barrier.subresourceRange.baseMipLevel = mipLevels - 1;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+bool UploadEngine::hasSeparateFamilies() const
+{
+	return m_transferFamily != m_graphicsFamily;
+}
+
+UploadEngine::Batch& UploadEngine::beginBatch()
+{
+	Batch& batch = m_batches[m_currentBatch];
+
+	// The segment is reused once the GPU is done reading it.
+	// The state is read under the lock, the completion thread sets it back to idle.
+	std::shared_future<void> pending;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (batch.state == BatchState::RECORDING)
+		{
+			return batch;
+		}
+		else if (batch.state == BatchState::IN_FLIGHT)
+		{
+			pending = batch.future;
+		}
+	}
+
+	if (pending.valid())
+	{
+		pending.wait();
+	}
+
+	vkResetFences(m_logicalDevice, 1, &batch.fence);
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	if (vkBeginCommandBuffer(batch.transferCommandBuffer, &beginInfo) != VK_SUCCESS ||
+		(hasSeparateFamilies() && vkBeginCommandBuffer(batch.acquireCommandBuffer, &beginInfo) != VK_SUCCESS))
+	{
+		throw VulkanException("Failed to begin upload command buffer.");
+	}
+
+	batch.promise = std::promise<void>();
+	batch.future = batch.promise.get_future().share();
+	batch.stagingHead = 0;
+	batch.state = BatchState::RECORDING;
+
+	return batch;
+}
+
+void* UploadEngine::reserveStaging(VkDeviceSize size, VkDeviceSize alignment, VkBuffer* stagingBuffer, VkDeviceSize* stagingOffset)
+{
+	// Too big for a segment, gets its own buffer released with the batch
+	if (size > m_segmentSize)
+	{
+		Batch& batch = beginBatch();
+
+		VkBufferCreateInfo bufferCreateInfo = {};
+		bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferCreateInfo.size = size;
+		bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		if (vkCreateBuffer(m_logicalDevice, &bufferCreateInfo, nullptr, stagingBuffer) != VK_SUCCESS)
+		{
+			throw VulkanException("Failed to create dedicated staging buffer.");
+		}
+
+		VkMemoryRequirements memoryRequirements;
+		vkGetBufferMemoryRequirements(m_logicalDevice, *stagingBuffer, &memoryRequirements);
+
+		DeviceAllocation stagingMemory = m_allocator->allocate(memoryRequirements,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			ResourceType::BUFFER, AllocationStrategy::LINEAR);
+
+		vkBindBufferMemory(m_logicalDevice, *stagingBuffer, stagingMemory.memory, stagingMemory.offset);
+
+		batch.dedicatedStaging.push_back({ *stagingBuffer, stagingMemory });
+		*stagingOffset = 0;
+
+		return stagingMemory.mapped;
+	}
+
+	Batch* batch = &beginBatch();
+
+	VkDeviceSize offset = alignUp(batch->stagingHead, alignment);
+	if (offset + size > m_segmentSize)
+	{
+		submitBatch(*batch);
+		batch = &beginBatch();
+		offset = 0;
+	}
+
+	batch->stagingHead = offset + size;
+
+	*stagingBuffer = m_stagingBuffer;
+	*stagingOffset = m_currentBatch * m_segmentSize + offset;
+
+	return static_cast<char*>(m_stagingMemory.mapped) + *stagingOffset;
+}
+
+void UploadEngine::submitBatch(Batch& batch)
+{
+	if (hasSeparateFamilies())
+	{
+		// Release on the transfer queue, acquire on the graphics queue
+		VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+		if (vkEndCommandBuffer(batch.transferCommandBuffer) != VK_SUCCESS ||
+			vkEndCommandBuffer(batch.acquireCommandBuffer) != VK_SUCCESS)
+		{
+			throw VulkanException("Failed to end upload command buffer.");
+		}
+
+		VkSubmitInfo transferSubmitInfo = {};
+		transferSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		transferSubmitInfo.commandBufferCount = 1;
+		transferSubmitInfo.pCommandBuffers = &batch.transferCommandBuffer;
+		transferSubmitInfo.signalSemaphoreCount = 1;
+		transferSubmitInfo.pSignalSemaphores = &batch.transferedSemaphore;
+
+		VkSubmitInfo acquireSubmitInfo = {};
+		acquireSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		acquireSubmitInfo.waitSemaphoreCount = 1;
+		acquireSubmitInfo.pWaitSemaphores = &batch.transferedSemaphore;
+		acquireSubmitInfo.pWaitDstStageMask = &waitStage;
+		acquireSubmitInfo.commandBufferCount = 1;
+		acquireSubmitInfo.pCommandBuffers = &batch.acquireCommandBuffer;
+
+		std::lock_guard<std::mutex> queueLock(m_queueMutex);
+		if (vkQueueSubmit(m_transferQueue, 1, &transferSubmitInfo, VK_NULL_HANDLE) != VK_SUCCESS ||
+			vkQueueSubmit(m_graphicsQueue, 1, &acquireSubmitInfo, batch.fence) != VK_SUCCESS)
+		{
+			throw VulkanException("Failed to submit upload batch.");
+		}
+	}
+	else
+	{
+		// Make the copies visible to whatever reads them next on this queue
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+		vkCmdPipelineBarrier(batch.transferCommandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+			0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		if (vkEndCommandBuffer(batch.transferCommandBuffer) != VK_SUCCESS)
+		{
+			throw VulkanException("Failed to end upload command buffer.");
+		}
+
+		VkSubmitInfo submitInfo = {};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &batch.transferCommandBuffer;
+
+		std::lock_guard<std::mutex> queueLock(m_queueMutex);
+		if (vkQueueSubmit(m_transferQueue, 1, &submitInfo, batch.fence) != VK_SUCCESS)
+		{
+			throw VulkanException("Failed to submit upload batch.");
+		}
+	}
+
+	m_lastFuture = batch.future;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		batch.state = BatchState::IN_FLIGHT;
+		m_inFlight.push_back(&batch);
+	}
+	m_condition.notify_one();
+
+	m_currentBatch = (m_currentBatch + 1) % BATCH_COUNT;
+}
+
+void UploadEngine::completionLoop()
+{
+	while (true)
+	{
+		Batch* batch;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [this]() { return !m_inFlight.empty() || !m_isRunning; });
+
+			if (m_inFlight.empty())
+			{
+				return;
+			}
+			batch = m_inFlight.front();
+		}
+
+		vkWaitForFences(m_logicalDevice, 1, &batch->fence, VK_TRUE, UINT64_MAX);
+
+		std::vector<std::pair<VkBuffer, DeviceAllocation>> dedicatedStaging;
+		std::promise<void> promise;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_inFlight.pop_front();
+
+			dedicatedStaging.swap(batch->dedicatedStaging);
+			promise = std::move(batch->promise);
+			batch->state = BatchState::IDLE;
+		}
+
+		for (std::pair<VkBuffer, DeviceAllocation>& staging : dedicatedStaging)
+		{
+			vkDestroyBuffer(m_logicalDevice, staging.first, nullptr);
+			m_allocator->free(staging.second);
+		}
+
+		promise.set_value();
+	}
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "DeviceAllocator.h"
+
+#include <array>
+#include <deque>
+#include <future>
+#include <functional>
+#include <thread>
+#include <condition_variable>
+
+// Batches staging copies into a reusable staging ring and submits them on the transfer queue.
+// Resources are handed to the graphics family with release/acquire barriers when the families differ.
+class UploadEngine
+{
+public:
+	// Fills the reserved staging range in place of a memcpy from a source buffer
+	typedef std::function<void(void* staging)> StagingWriter;
+
+	UploadEngine();
+
+	void init(
+		VkDevice logicalDevice,
+		DeviceAllocator& allocator,
+		uint32_t transferFamily, VkQueue transferQueue,
+		uint32_t graphicsFamily, VkQueue graphicsQueue,
+		VkDeviceSize stagingSize = 64 * 1024 * 1024);
+	void destroy();
+
+	std::shared_future<void> uploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size);
+
+	// data holds every mip level tightly packed, the image ends up in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+	std::shared_future<void> uploadImage(VkImage dstImage, uint32_t width, uint32_t height, const std::vector<VkDeviceSize>& levelOffsets, const void* data, VkDeviceSize size);
+	std::shared_future<void> uploadImage(VkImage dstImage, uint32_t width, uint32_t height, const std::vector<VkDeviceSize>& levelOffsets, VkDeviceSize size, const StagingWriter& writeStaging);
+
+	// Only level 0 is uploaded, the other levels are blitted down from it on the graphics queue.
+	// The format needs blit and linear filter support with optimal tiling.
+	std::shared_future<void> uploadImageGenerateMips(VkImage dstImage, uint32_t width, uint32_t height, uint32_t mipLevels, const void* data, VkDeviceSize size);
+	std::shared_future<void> uploadImageGenerateMips(VkImage dstImage, uint32_t width, uint32_t height, uint32_t mipLevels, VkDeviceSize size, const StagingWriter& writeStaging);
+
+	std::shared_future<void> flush();
+	void waitIdle();
+
+	// Uploads submit from any thread and the queues may be shared with rendering,
+	// every other submit, present or wait on these queues holds this mutex too
+	std::mutex& getQueueMutex();
+
+private:
+	enum class BatchState
+	{
+		IDLE,
+		RECORDING,
+		IN_FLIGHT
+	};
+
+	struct Batch
+	{
+		BatchState state = BatchState::IDLE;
+
+		VkCommandBuffer transferCommandBuffer = VK_NULL_HANDLE;
+		VkCommandBuffer acquireCommandBuffer = VK_NULL_HANDLE;
+		VkSemaphore transferedSemaphore = VK_NULL_HANDLE;
+		VkFence fence = VK_NULL_HANDLE;
+
+		VkDeviceSize stagingHead = 0;
+
+		std::vector<std::pair<VkBuffer, DeviceAllocation>> dedicatedStaging;
+
+		std::promise<void> promise;
+		std::shared_future<void> future;
+	};
+
+	static const uint32_t BATCH_COUNT = 4;
+
+	bool hasSeparateFamilies() const;
+
+	Batch& beginBatch();
+	void* reserveStaging(VkDeviceSize size, VkDeviceSize alignment, VkBuffer* stagingBuffer, VkDeviceSize* stagingOffset);
+
+	void recordMipBlits(VkCommandBuffer commandBuffer, VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels);
+
+	void submitBatch(Batch& batch);
+	void completionLoop();
+
+private:
+	VkDevice m_logicalDevice;
+	DeviceAllocator* m_allocator;
+
+	uint32_t m_transferFamily;
+	VkQueue m_transferQueue;
+	uint32_t m_graphicsFamily;
+	VkQueue m_graphicsQueue;
+
+	VkCommandPool m_transferCommandPool;
+	VkCommandPool m_graphicsCommandPool;
+
+	VkBuffer m_stagingBuffer;
+	DeviceAllocation m_stagingMemory;
+	VkDeviceSize m_segmentSize;
+
+	std::array<Batch, BATCH_COUNT> m_batches;
+	uint32_t m_currentBatch;
+
+	std::shared_future<void> m_lastFuture;
+
+	// Serializes recording, m_mutex guards what the completion thread touches
+	std::mutex m_recordMutex;
+	std::mutex m_mutex;
+	std::mutex m_queueMutex;
+	std::condition_variable m_condition;
+	std::deque<Batch*> m_inFlight;
+	bool m_isRunning;
+	std::thread m_completionThread;
+};
@@ -0,0 +1,230 @@
+#include "MeshFile.h"
+
+#include <cstring>
+#include <stdexcept>
+
+MeshFile::MeshFile() :
+	topology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST),
+	indexType(VK_INDEX_TYPE_UINT16),
+	vertexCount(0),
+	vertexStride(0),
+	indexCount(0),
+
+	boundsMin(),
+	boundsMax(),
+	sphereCenter(),
+	sphereRadius(0.0f),
+
+	m_header()
+{
+}
+
+void MeshFile::parse(FileView file)
+{
+	m_file = std::move(file);
+
+	if (m_file.size() < sizeof(m_header))
+	{
+		throw std::runtime_error("Mesh file is truncated.");
+	}
+	memcpy(&m_header, m_file.data(), sizeof(m_header));
+
+	if (m_header.magic != MESH_MAGIC || m_header.version != MESH_VERSION)
+	{
+		throw std::runtime_error("Not a supported mesh file.");
+	}
+
+	topology = (VkPrimitiveTopology)m_header.topology;
+	indexType = (VkIndexType)m_header.indexType;
+	vertexCount = m_header.vertexCount;
+	vertexStride = m_header.vertexStride;
+	indexCount = m_header.indexCount;
+
+	if ((topology != VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST && topology != VK_PRIMITIVE_TOPOLOGY_LINE_LIST) ||
+		getIndexSize(indexType) == 0 || vertexCount == 0 || vertexStride == 0)
+	{
+		throw std::runtime_error("Unsupported mesh layout.");
+	}
+
+	if (m_header.vertexDataSize != (uint64_t)vertexCount * vertexStride ||
+		m_header.indexDataSize != (uint64_t)indexCount * getIndexSize(indexType) ||
+		m_header.vertexDataOffset + m_header.vertexDataSize > m_header.indexDataOffset ||
+		m_header.indexDataOffset + m_header.indexDataSize > m_file.size() ||
+		m_header.indexDataOffset % getIndexSize(indexType) != 0)
+	{
+		throw std::runtime_error("Mesh data is out of the file.");
+	}
+
+	memcpy(boundsMin, m_header.boundsMin, sizeof(boundsMin));
+	memcpy(boundsMax, m_header.boundsMax, sizeof(boundsMax));
+	memcpy(sphereCenter, m_header.sphereCenter, sizeof(sphereCenter));
+	sphereRadius = m_header.sphereRadius;
+
+	readSection(m_header.attributesOffset, m_header.attributeCount, attributes);
+	readSection(m_header.lodsOffset, m_header.lodCount, lods);
+	readSection(m_header.meshletsOffset, m_header.meshletCount, meshlets);
+
+	for (const MeshAttribute& attribute : attributes)
+	{
+		uint32_t formatSize = getFormatSize((VkFormat)attribute.format);
+		if (formatSize == 0 || attribute.offset + formatSize > vertexStride)
+		{
+			throw std::runtime_error("Unsupported mesh vertex attribute.");
+		}
+	}
+
+	uint32_t elementCount = indexCount > 0 ? indexCount : vertexCount;
+	for (const MeshLod& lod : lods)
+	{
+		if ((uint64_t)lod.firstIndex + lod.indexCount > elementCount)
+		{
+			throw std::runtime_error("Mesh level of detail is out of range.");
+		}
+	}
+
+	for (const MeshMeshlet& meshlet : meshlets)
+	{
+		if ((uint64_t)meshlet.firstIndex + meshlet.indexCount > elementCount)
+		{
+			throw std::runtime_error("Mesh meshlet is out of range.");
+		}
+	}
+
+	// Out of range indices would read past the vertex buffer on the device
+	bool isInRange = indexType == VK_INDEX_TYPE_UINT16 ? areIndicesInRange<uint16_t>() : areIndicesInRange<uint32_t>();
+	if (!isInRange)
+	{
+		throw std::runtime_error("Mesh index is out of range.");
+	}
+}
+
+const char* MeshFile::getData() const
+{
+	return m_file.data() + m_header.vertexDataOffset;
+}
+
+VkDeviceSize MeshFile::getDataSize() const
+{
+	return m_header.indexDataOffset + m_header.indexDataSize - m_header.vertexDataOffset;
+}
+
+VkDeviceSize MeshFile::getVertexDataOffset() const
+{
+	return 0;
+}
+
+VkDeviceSize MeshFile::getVertexDataSize() const
+{
+	return m_header.vertexDataSize;
+}
+
+VkDeviceSize MeshFile::getIndexDataOffset() const
+{
+	return m_header.indexDataOffset - m_header.vertexDataOffset;
+}
+
+VkDeviceSize MeshFile::getIndexDataSize() const
+{
+	return m_header.indexDataSize;
+}
+
+bool MeshFile::matchesLayout(const std::vector<MeshAttribute>& layout, uint32_t stride) const
+{
+	if (stride != vertexStride || layout.size() != attributes.size())
+	{
+		return false;
+	}
+
+	for (const MeshAttribute& expected : layout)
+	{
+		bool isFound = false;
+		for (const MeshAttribute& attribute : attributes)
+		{
+			if (attribute.semantic == expected.semantic && attribute.format == expected.format && attribute.offset == expected.offset)
+			{
+				isFound = true;
+				break;
+			}
+		}
+
+		if (!isFound)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+uint32_t MeshFile::getFormatSize(VkFormat format)
+{
+	switch (format)
+	{
+	case VK_FORMAT_R8G8B8A8_UNORM:
+	case VK_FORMAT_R8G8B8A8_SNORM:
+	case VK_FORMAT_R16G16_SFLOAT:
+	case VK_FORMAT_R16G16_UNORM:
+	case VK_FORMAT_R16G16_SNORM:
+	case VK_FORMAT_R32_SFLOAT:
+		return 4;
+
+	case VK_FORMAT_R16G16B16A16_SFLOAT:
+	case VK_FORMAT_R16G16B16A16_UNORM:
+	case VK_FORMAT_R16G16B16A16_SNORM:
+	case VK_FORMAT_R32G32_SFLOAT:
+		return 8;
+
+	case VK_FORMAT_R32G32B32_SFLOAT:
+		return 12;
+
+	case VK_FORMAT_R32G32B32A32_SFLOAT:
+		return 16;
+
+	default:
+		return 0;
+	}
+}
+
+uint32_t MeshFile::getIndexSize(VkIndexType indexType)
+{
+	switch (indexType)
+	{
+	case VK_INDEX_TYPE_UINT16:
+		return 2;
+
+	case VK_INDEX_TYPE_UINT32:
+		return 4;
+
+	default:
+		return 0;
+	}
+}
+
+template<typename T>
+void MeshFile::readSection(uint64_t offset, uint32_t count, std::vector<T>& section) const
+{
+	if (offset + (uint64_t)count * sizeof(T) > m_file.size())
+	{
+		throw std::runtime_error("Mesh section is out of the file.");
+	}
+
+	section.resize(count);
+	if (count > 0)
+	{
+		memcpy(section.data(), m_file.data() + offset, count * sizeof(T));
+	}
+}
+
+template<typename T>
+bool MeshFile::areIndicesInRange() const
+{
+	const T* indices = reinterpret_cast<const T*>(m_file.data() + m_header.indexDataOffset);
+
+	T maxIndex = 0;
+	for (uint32_t i = 0; i < indexCount; ++i)
+	{
+		maxIndex = indices[i] > maxIndex ? indices[i] : maxIndex;
+	}
+
+	return indexCount == 0 || maxIndex < vertexCount;
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+#include "../vfs/FileView.h"
+
+#include <vector>
+
+const uint32_t MESH_MAGIC = 0x4853454D; // "MESH"
+const uint32_t MESH_VERSION = 1;
+
+enum class MeshSemantic : uint32_t
+{
+	POSITION = 0,
+	NORMAL = 1,
+	COLOR = 2,
+	TEX_COORD = 3
+};
+
+// Vertex and index data are contiguous so both upload with a single copy
+struct MeshHeader
+{
+	uint32_t magic;
+	uint32_t version;
+
+	uint32_t topology;
+	uint32_t vertexCount;
+	uint32_t vertexStride;
+	uint32_t indexCount;
+	uint32_t indexType;
+
+	uint32_t attributeCount;
+	uint32_t lodCount;
+	uint32_t meshletCount;
+
+	float boundsMin[3];
+	float boundsMax[3];
+	float sphereCenter[3];
+	float sphereRadius;
+
+	uint64_t attributesOffset;
+	uint64_t lodsOffset;
+	uint64_t meshletsOffset;
+
+	uint64_t dataAlignment;
+	uint64_t vertexDataOffset;
+	uint64_t vertexDataSize;
+	uint64_t indexDataOffset;
+	uint64_t indexDataSize;
+};
+
+struct MeshAttribute
+{
+	uint32_t semantic;
+	uint32_t format;
+	uint32_t offset;
+	uint32_t reserved;
+};
+
+// Index range drawn for one level of detail, level 0 is the full mesh
+struct MeshLod
+{
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	float error;
+	uint32_t reserved;
+};
+
+// Small cluster of triangles with its bounding sphere, for culling finer than the whole mesh
+struct MeshMeshlet
+{
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	float center[3];
+	float radius;
+};
+
+// Mesh kept as the file view, vertices and indices are uploaded straight from it.
+// indexCount is 0 for meshes drawn without an index buffer.
+class MeshFile
+{
+public:
+	MeshFile();
+
+	// Throws when the file isn't a mesh the renderer can upload as is
+	void parse(FileView file);
+
+	// Vertex data followed by index data, each at the offsets below
+	const char* getData() const;
+	VkDeviceSize getDataSize() const;
+
+	VkDeviceSize getVertexDataOffset() const;
+	VkDeviceSize getVertexDataSize() const;
+	VkDeviceSize getIndexDataOffset() const;
+	VkDeviceSize getIndexDataSize() const;
+
+	// Whether the vertices can be copied as is into buffers read with the given layout
+	bool matchesLayout(const std::vector<MeshAttribute>& layout, uint32_t stride) const;
+
+	// Bytes used by an attribute format, 0 for formats meshes don't store
+	static uint32_t getFormatSize(VkFormat format);
+	static uint32_t getIndexSize(VkIndexType indexType);
+
+	VkPrimitiveTopology topology;
+	VkIndexType indexType;
+	uint32_t vertexCount;
+	uint32_t vertexStride;
+	uint32_t indexCount;
+
+	float boundsMin[3];
+	float boundsMax[3];
+	float sphereCenter[3];
+	float sphereRadius;
+
+	std::vector<MeshAttribute> attributes;
+	std::vector<MeshLod> lods;
+	std::vector<MeshMeshlet> meshlets;
+
+private:
+	template<typename T>
+	void readSection(uint64_t offset, uint32_t count, std::vector<T>& section) const;
+
+	template<typename T>
+	bool areIndicesInRange() const;
+
+private:
+	FileView m_file;
+	MeshHeader m_header;
+};
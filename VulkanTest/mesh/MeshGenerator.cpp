@@ -0,0 +1,556 @@
+#include "MeshGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define MESH_SSE2
+#endif
+
+// Below this many vertices the job system costs more than it saves
+const uint32_t MIN_PARALLEL_VERTICES = 16384;
+
+const float PI = 3.14159265358979f;
+
+#ifdef MESH_SSE2
+// Cephes single precision sincos: reduction to [-pi/4, pi/4] by octant, then both minimax polynomials
+static void sinCos4(__m128 x, __m128* sines, __m128* cosines)
+{
+	const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000));
+
+	__m128 sinSign = _mm_and_ps(x, signMask);
+	x = _mm_andnot_ps(signMask, x);
+
+	__m128i octant = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(1.27323954473516f)));
+	octant = _mm_and_si128(_mm_add_epi32(octant, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+	__m128 y = _mm_cvtepi32_ps(octant);
+
+	__m128 sinSwap = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(octant, _mm_set1_epi32(4)), 29));
+	__m128 cosSwap = _mm_castsi128_ps(_mm_slli_epi32(_mm_andnot_si128(_mm_sub_epi32(octant, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29));
+	__m128 isSinPolynomial = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(octant, _mm_set1_epi32(2)), _mm_setzero_si128()));
+
+	sinSign = _mm_xor_ps(sinSign, sinSwap);
+
+	// Extended precision modular arithmetic
+	x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(-0.78515625f)));
+	x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(-2.4187564849853515625e-4f)));
+	x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(-3.77489497744594108e-8f)));
+
+	__m128 z = _mm_mul_ps(x, x);
+
+	__m128 cosPolynomial = _mm_set1_ps(2.443315711809948e-5f);
+	cosPolynomial = _mm_add_ps(_mm_mul_ps(cosPolynomial, z), _mm_set1_ps(-1.388731625493765e-3f));
+	cosPolynomial = _mm_add_ps(_mm_mul_ps(cosPolynomial, z), _mm_set1_ps(4.166664568298827e-2f));
+	cosPolynomial = _mm_mul_ps(_mm_mul_ps(cosPolynomial, z), z);
+	cosPolynomial = _mm_sub_ps(cosPolynomial, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+	cosPolynomial = _mm_add_ps(cosPolynomial, _mm_set1_ps(1.0f));
+
+	__m128 sinPolynomial = _mm_set1_ps(-1.9515295891e-4f);
+	sinPolynomial = _mm_add_ps(_mm_mul_ps(sinPolynomial, z), _mm_set1_ps(8.3321608736e-3f));
+	sinPolynomial = _mm_add_ps(_mm_mul_ps(sinPolynomial, z), _mm_set1_ps(-1.6666654611e-1f));
+	sinPolynomial = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(sinPolynomial, z), x), x);
+
+	__m128 sinResult = _mm_or_ps(_mm_and_ps(isSinPolynomial, sinPolynomial), _mm_andnot_ps(isSinPolynomial, cosPolynomial));
+	__m128 cosResult = _mm_or_ps(_mm_and_ps(isSinPolynomial, cosPolynomial), _mm_andnot_ps(isSinPolynomial, sinPolynomial));
+
+	*sines = _mm_xor_ps(sinResult, sinSign);
+	*cosines = _mm_xor_ps(cosResult, cosSwap);
+}
+#endif
+
+void sinCos(const float* angles, float* sines, float* cosines, size_t count)
+{
+	size_t i = 0;
+
+#ifdef MESH_SSE2
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 sine;
+		__m128 cosine;
+		sinCos4(_mm_loadu_ps(angles + i), &sine, &cosine);
+
+		_mm_storeu_ps(sines + i, sine);
+		_mm_storeu_ps(cosines + i, cosine);
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		sines[i] = std::sin(angles[i]);
+		cosines[i] = std::cos(angles[i]);
+	}
+}
+
+
+
+/////////////////////////////
+////// VERTEX TARGET ////////
+/////////////////////////////
+
+VertexTarget VertexTarget::fromLayout(void* vertices, const std::vector<MeshAttribute>& layout, uint32_t stride)
+{
+	VertexTarget target;
+	target.vertices = static_cast<char*>(vertices);
+	target.stride = stride;
+	target.positionOffset = NO_ATTRIBUTE;
+	target.normalOffset = NO_ATTRIBUTE;
+	target.colorOffset = NO_ATTRIBUTE;
+	target.texCoordOffset = NO_ATTRIBUTE;
+
+	for (const MeshAttribute& attribute : layout)
+	{
+		uint32_t* offset = nullptr;
+		VkFormat format = VK_FORMAT_R32G32B32_SFLOAT;
+		switch ((MeshSemantic)attribute.semantic)
+		{
+		case MeshSemantic::POSITION:
+			offset = &target.positionOffset;
+			break;
+
+		case MeshSemantic::NORMAL:
+			offset = &target.normalOffset;
+			break;
+
+		case MeshSemantic::COLOR:
+			offset = &target.colorOffset;
+			break;
+
+		case MeshSemantic::TEX_COORD:
+			offset = &target.texCoordOffset;
+			format = VK_FORMAT_R32G32_SFLOAT;
+			break;
+
+		default:
+			continue;
+		}
+
+		if ((VkFormat)attribute.format != format)
+		{
+			throw std::runtime_error("Vertex layout can't be generated into.");
+		}
+
+		*offset = attribute.offset;
+	}
+
+	if (target.positionOffset == NO_ATTRIBUTE)
+	{
+		throw std::runtime_error("Vertex layout has no position.");
+	}
+
+	return target;
+}
+
+
+
+/////////////////////////////
+////// GENERATOR ////////////
+/////////////////////////////
+
+MeshGenerator::MeshGenerator(JobSystem* jobSystem) :
+	m_jobSystem(jobSystem)
+{
+}
+
+GeneratedSize MeshGenerator::getUvSphereSize(uint32_t segments, uint32_t rings)
+{
+	checkMinimum(segments, 3, "UV sphere segments");
+	checkMinimum(rings, 2, "UV sphere rings");
+
+	return { (segments + 1) * (rings + 1), 6 * segments * (rings - 1) };
+}
+
+void MeshGenerator::generateUvSphere(uint32_t segments, uint32_t rings, const VertexTarget& target, uint32_t* indices) const
+{
+	checkMinimum(segments, 3, "UV sphere segments");
+	checkMinimum(rings, 2, "UV sphere rings");
+
+	std::vector<float> segmentSines;
+	std::vector<float> segmentCosines;
+	computeCircle(segments, 0.0f, segmentSines, segmentCosines);
+
+	std::vector<float> ringAngles(rings + 1);
+	std::vector<float> ringSines(rings + 1);
+	std::vector<float> ringCosines(rings + 1);
+	for (uint32_t ring = 0; ring <= rings; ++ring)
+	{
+		ringAngles[ring] = PI * ring / rings;
+	}
+	sinCos(ringAngles.data(), ringSines.data(), ringCosines.data(), ringAngles.size());
+
+	// Exact poles
+	ringSines[0] = 0.0f;
+	ringCosines[0] = 1.0f;
+	ringSines[rings] = 0.0f;
+	ringCosines[rings] = -1.0f;
+
+	uint32_t rowSize = segments + 1;
+	forRows(rings + 1, rowSize, [&](uint32_t firstRow, uint32_t endRow)
+		{
+			for (uint32_t ring = firstRow; ring < endRow; ++ring)
+			{
+				for (uint32_t segment = 0; segment <= segments; ++segment)
+				{
+					float position[3] = {
+						ringSines[ring] * segmentCosines[segment],
+						ringCosines[ring],
+						ringSines[ring] * segmentSines[segment] };
+
+					writeVertex(target, ring * rowSize + segment, position, position, (float)segment / segments, (float)ring / rings);
+				}
+			}
+		});
+
+	// The first and last bands are triangle fans around the poles
+	forRows(rings, rowSize, [&](uint32_t firstRow, uint32_t endRow)
+		{
+			for (uint32_t ring = firstRow; ring < endRow; ++ring)
+			{
+				uint32_t* bandIndices = indices + (ring == 0 ? 0 : (6 * ring - 3) * segments);
+				for (uint32_t segment = 0; segment < segments; ++segment)
+				{
+					uint32_t topLeft = ring * rowSize + segment;
+					uint32_t bottomLeft = topLeft + rowSize;
+
+					if (ring == 0)
+					{
+						uint32_t fan[] = { topLeft + 1, bottomLeft + 1, bottomLeft };
+						memcpy(bandIndices, fan, sizeof(fan));
+						bandIndices += 3;
+					}
+					else if (ring == rings - 1)
+					{
+						uint32_t fan[] = { topLeft, topLeft + 1, bottomLeft };
+						memcpy(bandIndices, fan, sizeof(fan));
+						bandIndices += 3;
+					}
+					else
+					{
+						writeQuadIndices(bandIndices, topLeft, topLeft + 1, bottomLeft, bottomLeft + 1);
+						bandIndices += 6;
+					}
+				}
+			}
+		});
+}
+
+GeneratedSize MeshGenerator::getIcosphereSize(uint32_t subdivisions)
+{
+	checkMinimum(subdivisions, 1, "Icosphere subdivisions");
+
+	return { 20 * (subdivisions + 1) * (subdivisions + 2) / 2, 20 * 3 * subdivisions * subdivisions };
+}
+
+void MeshGenerator::generateIcosphere(uint32_t subdivisions, const VertexTarget& target, uint32_t* indices) const
+{
+	checkMinimum(subdivisions, 1, "Icosphere subdivisions");
+
+	const float t = 1.61803398874989f;
+	const float corners[12][3] = {
+		{ -1, t, 0 }, { 1, t, 0 }, { -1, -t, 0 }, { 1, -t, 0 },
+		{ 0, -1, t }, { 0, 1, t }, { 0, -1, -t }, { 0, 1, -t },
+		{ t, 0, -1 }, { t, 0, 1 }, { -t, 0, -1 }, { -t, 0, 1 } };
+
+	const uint32_t faces[20][3] = {
+		{ 0, 11, 5 }, { 0, 5, 1 }, { 0, 1, 7 }, { 0, 7, 10 }, { 0, 10, 11 },
+		{ 1, 5, 9 }, { 5, 11, 4 }, { 11, 10, 2 }, { 10, 7, 6 }, { 7, 1, 8 },
+		{ 3, 9, 4 }, { 3, 4, 2 }, { 3, 2, 6 }, { 3, 6, 8 }, { 3, 8, 9 },
+		{ 4, 9, 5 }, { 2, 4, 11 }, { 6, 2, 10 }, { 8, 6, 7 }, { 9, 8, 1 } };
+
+	uint32_t n = subdivisions;
+	GeneratedSize faceSize = { (n + 1) * (n + 2) / 2, 3 * n * n };
+
+	// Faces are generated independently, shared edges come out bitwise identical since
+	// the weighted sums only differ by their order and by zero terms
+	forRows(20, faceSize.vertexCount, [&](uint32_t firstFace, uint32_t endFace)
+		{
+			for (uint32_t face = firstFace; face < endFace; ++face)
+			{
+				const float* a = corners[faces[face][0]];
+				const float* b = corners[faces[face][1]];
+				const float* c = corners[faces[face][2]];
+
+				uint32_t firstVertex = face * faceSize.vertexCount;
+				auto getVertex = [firstVertex, n](uint32_t i, uint32_t j)
+				{
+					return firstVertex + i * (n + 1) - i * (i - 1) / 2 + j;
+				};
+
+				for (uint32_t i = 0; i <= n; ++i)
+				{
+					for (uint32_t j = 0; i + j <= n; ++j)
+					{
+						float weightA = (float)(n - i - j);
+						float weightB = (float)i;
+						float weightC = (float)j;
+
+						float position[3];
+						for (uint32_t axis = 0; axis < 3; ++axis)
+						{
+							position[axis] = (weightA * a[axis] + weightB * b[axis]) + weightC * c[axis];
+						}
+
+						float inverseLength = 1.0f / std::sqrt(position[0] * position[0] + position[1] * position[1] + position[2] * position[2]);
+						for (uint32_t axis = 0; axis < 3; ++axis)
+						{
+							position[axis] *= inverseLength;
+						}
+
+						float u = std::atan2(position[2], position[0]) / (2.0f * PI);
+						float v = std::acos(std::min(std::max(position[1], -1.0f), 1.0f)) / PI;
+
+						writeVertex(target, getVertex(i, j), position, position, u < 0.0f ? u + 1.0f : u, v);
+					}
+				}
+
+				uint32_t* faceIndices = indices + face * faceSize.indexCount;
+				for (uint32_t i = 0; i < n; ++i)
+				{
+					for (uint32_t j = 0; i + j < n; ++j)
+					{
+						uint32_t up[] = { getVertex(i, j), getVertex(i + 1, j), getVertex(i, j + 1) };
+						memcpy(faceIndices, up, sizeof(up));
+						faceIndices += 3;
+
+						if (i + j + 1 < n)
+						{
+							uint32_t down[] = { getVertex(i + 1, j), getVertex(i + 1, j + 1), getVertex(i, j + 1) };
+							memcpy(faceIndices, down, sizeof(down));
+							faceIndices += 3;
+						}
+					}
+				}
+			}
+		});
+}
+
+GeneratedSize MeshGenerator::getTunnelSize(uint32_t sides, uint32_t segments)
+{
+	checkMinimum(sides, 3, "Tunnel sides");
+	checkMinimum(segments, 1, "Tunnel segments");
+
+	return { (sides + 1) * (segments + 1), 6 * sides * segments };
+}
+
+void MeshGenerator::generateTunnel(uint32_t sides, uint32_t segments, float radius, float length, const VertexTarget& target, uint32_t* indices) const
+{
+	checkMinimum(sides, 3, "Tunnel sides");
+	checkMinimum(segments, 1, "Tunnel segments");
+
+	std::vector<float> sines;
+	std::vector<float> cosines;
+	computeCircle(sides, 0.0f, sines, cosines);
+
+	uint32_t rowSize = sides + 1;
+	forRows(segments + 1, rowSize, [&](uint32_t firstRow, uint32_t endRow)
+		{
+			for (uint32_t segment = firstRow; segment < endRow; ++segment)
+			{
+				float z = length * ((float)segment / segments - 0.5f);
+				for (uint32_t side = 0; side <= sides; ++side)
+				{
+					float position[3] = { radius * cosines[side], radius * sines[side], z };
+					float normal[3] = { -cosines[side], -sines[side], 0.0f };
+
+					writeVertex(target, segment * rowSize + side, position, normal, (float)side / sides, (float)segment / segments);
+				}
+			}
+		});
+
+	forRows(segments, rowSize, [&](uint32_t firstRow, uint32_t endRow)
+		{
+			for (uint32_t segment = firstRow; segment < endRow; ++segment)
+			{
+				for (uint32_t side = 0; side < sides; ++side)
+				{
+					uint32_t topLeft = segment * rowSize + side;
+					// Seen from the inside
+					writeQuadIndices(indices + (segment * sides + side) * 6, topLeft + rowSize, topLeft + rowSize + 1, topLeft, topLeft + 1);
+				}
+			}
+		});
+}
+
+GeneratedSize MeshGenerator::getGridSize(uint32_t columns, uint32_t rows)
+{
+	checkMinimum(columns, 1, "Grid columns");
+	checkMinimum(rows, 1, "Grid rows");
+
+	return { (columns + 1) * (rows + 1), 6 * columns * rows };
+}
+
+void MeshGenerator::generateGrid(uint32_t columns, uint32_t rows, float width, float depth, const VertexTarget& target, uint32_t* indices) const
+{
+	checkMinimum(columns, 1, "Grid columns");
+	checkMinimum(rows, 1, "Grid rows");
+
+	const float normal[3] = { 0.0f, 1.0f, 0.0f };
+
+	uint32_t rowSize = columns + 1;
+	forRows(rows + 1, rowSize, [&](uint32_t firstRow, uint32_t endRow)
+		{
+			for (uint32_t row = firstRow; row < endRow; ++row)
+			{
+				for (uint32_t column = 0; column <= columns; ++column)
+				{
+					float u = (float)column / columns;
+					float v = (float)row / rows;
+					float position[3] = { width * (u - 0.5f), 0.0f, depth * (v - 0.5f) };
+
+					writeVertex(target, row * rowSize + column, position, normal, u, v);
+				}
+			}
+		});
+
+	forRows(rows, rowSize, [&](uint32_t firstRow, uint32_t endRow)
+		{
+			for (uint32_t row = firstRow; row < endRow; ++row)
+			{
+				for (uint32_t column = 0; column < columns; ++column)
+				{
+					uint32_t topLeft = row * rowSize + column;
+					writeQuadIndices(indices + (row * columns + column) * 6, topLeft + rowSize, topLeft + rowSize + 1, topLeft, topLeft + 1);
+				}
+			}
+		});
+}
+
+GeneratedSize MeshGenerator::getPrismSize(uint32_t sides)
+{
+	checkMinimum(sides, 3, "Prism sides");
+
+	return { 4 * sides + 2 * (sides + 1), 12 * sides };
+}
+
+void MeshGenerator::generatePrism(uint32_t sides, float radius, float height, const VertexTarget& target, uint32_t* indices) const
+{
+	checkMinimum(sides, 3, "Prism sides");
+
+	// Starting half a side in keeps 4 sides axis aligned
+	std::vector<float> sines;
+	std::vector<float> cosines;
+	computeCircle(sides, PI / sides, sines, cosines);
+
+	std::vector<float> normalSines;
+	std::vector<float> normalCosines;
+	computeCircle(sides, 0.0f, normalSines, normalCosines);
+
+	float top = height * 0.5f;
+	float bottom = -top;
+
+	// Every side gets its own 4 vertices for flat normals
+	for (uint32_t side = 0; side < sides; ++side)
+	{
+		float normal[3] = { normalCosines[side + 1], 0.0f, normalSines[side + 1] };
+		float u = (float)side / sides;
+		float nextU = (float)(side + 1) / sides;
+
+		float corners[4][3] = {
+			{ radius * cosines[side], top, radius * sines[side] },
+			{ radius * cosines[side + 1], top, radius * sines[side + 1] },
+			{ radius * cosines[side], bottom, radius * sines[side] },
+			{ radius * cosines[side + 1], bottom, radius * sines[side + 1] } };
+
+		uint32_t firstVertex = side * 4;
+		writeVertex(target, firstVertex + 0, corners[0], normal, u, 0.0f);
+		writeVertex(target, firstVertex + 1, corners[1], normal, nextU, 0.0f);
+		writeVertex(target, firstVertex + 2, corners[2], normal, u, 1.0f);
+		writeVertex(target, firstVertex + 3, corners[3], normal, nextU, 1.0f);
+
+		writeQuadIndices(indices + side * 6, firstVertex, firstVertex + 1, firstVertex + 2, firstVertex + 3);
+	}
+
+	// Caps are fans around their center
+	for (uint32_t cap = 0; cap < 2; ++cap)
+	{
+		float y = cap == 0 ? top : bottom;
+		float normal[3] = { 0.0f, cap == 0 ? 1.0f : -1.0f, 0.0f };
+
+		uint32_t center = 4 * sides + cap * (sides + 1);
+		float centerPosition[3] = { 0.0f, y, 0.0f };
+		writeVertex(target, center, centerPosition, normal, 0.5f, 0.5f);
+
+		uint32_t* capIndices = indices + 6 * sides + cap * 3 * sides;
+		for (uint32_t side = 0; side < sides; ++side)
+		{
+			float position[3] = { radius * cosines[side], y, radius * sines[side] };
+			writeVertex(target, center + 1 + side, position, normal, 0.5f + 0.5f * cosines[side], 0.5f + 0.5f * sines[side]);
+
+			uint32_t next = center + 1 + (side + 1) % sides;
+			uint32_t fan[] = { center, cap == 0 ? next : center + 1 + side, cap == 0 ? center + 1 + side : next };
+			memcpy(capIndices + side * 3, fan, sizeof(fan));
+		}
+	}
+}
+
+void MeshGenerator::checkMinimum(uint32_t value, uint32_t minimum, const char* name)
+{
+	if (value < minimum)
+	{
+		throw std::runtime_error(std::string(name) + " must be at least " + std::to_string(minimum) + ".");
+	}
+}
+
+void MeshGenerator::forRows(uint32_t rowCount, uint32_t verticesPerRow, const std::function<void(uint32_t firstRow, uint32_t endRow)>& rowJob) const
+{
+	if (m_jobSystem == nullptr || (uint64_t)rowCount * verticesPerRow < MIN_PARALLEL_VERTICES)
+	{
+		rowJob(0, rowCount);
+		return;
+	}
+
+	// A few chunks per thread to even out the load
+	uint32_t chunkCount = std::min(rowCount, m_jobSystem->getThreadCount() * 4);
+	m_jobSystem->parallelFor(chunkCount, [&](uint32_t chunk)
+		{
+			rowJob((uint32_t)((uint64_t)rowCount * chunk / chunkCount), (uint32_t)((uint64_t)rowCount * (chunk + 1) / chunkCount));
+		});
+}
+
+void MeshGenerator::computeCircle(uint32_t count, float startAngle, std::vector<float>& sines, std::vector<float>& cosines)
+{
+	std::vector<float> angles(count + 1);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		angles[i] = startAngle + 2.0f * PI * i / count;
+	}
+
+	sines.resize(count + 1);
+	cosines.resize(count + 1);
+	sinCos(angles.data(), sines.data(), cosines.data(), count);
+
+	sines[count] = sines[0];
+	cosines[count] = cosines[0];
+}
+
+void MeshGenerator::writeVertex(const VertexTarget& target, uint32_t index, const float* position, const float* normal, float u, float v)
+{
+	char* vertex = target.vertices + (size_t)index * target.stride;
+
+	memcpy(vertex + target.positionOffset, position, 3 * sizeof(float));
+
+	if (target.normalOffset != VertexTarget::NO_ATTRIBUTE)
+	{
+		memcpy(vertex + target.normalOffset, normal, 3 * sizeof(float));
+	}
+	else if (target.colorOffset != VertexTarget::NO_ATTRIBUTE)
+	{
+		float color[3] = { normal[0] * 0.5f + 0.5f, normal[1] * 0.5f + 0.5f, normal[2] * 0.5f + 0.5f };
+		memcpy(vertex + target.colorOffset, color, sizeof(color));
+	}
+
+	if (target.texCoordOffset != VertexTarget::NO_ATTRIBUTE)
+	{
+		float texCoord[2] = { u, v };
+		memcpy(vertex + target.texCoordOffset, texCoord, sizeof(texCoord));
+	}
+}
+
+void MeshGenerator::writeQuadIndices(uint32_t* indices, uint32_t topLeft, uint32_t topRight, uint32_t bottomLeft, uint32_t bottomRight)
+{
+	uint32_t quad[] = { topLeft, topRight, bottomLeft, topRight, bottomRight, bottomLeft };
+	memcpy(indices, quad, sizeof(quad));
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "MeshFile.h"
+#include "../jobs/JobSystem.h"
+
+#include <vector>
+
+// Sines and cosines of a batch of angles, 4 at a time where SSE2 is available
+void sinCos(const float* angles, float* sines, float* cosines, size_t count);
+
+struct GeneratedSize
+{
+	uint32_t vertexCount;
+	uint32_t indexCount;
+};
+
+// Where generated vertices are written. Attributes the layout doesn't have are skipped,
+// without a NORMAL attribute normals are encoded in the color as n * 0.5 + 0.5.
+struct VertexTarget
+{
+	static const uint32_t NO_ATTRIBUTE = UINT32_MAX;
+
+	// Only 32 bit float attributes, throws on other formats
+	static VertexTarget fromLayout(void* vertices, const std::vector<MeshAttribute>& layout, uint32_t stride);
+
+	char* vertices;
+	uint32_t stride;
+
+	uint32_t positionOffset;
+	uint32_t normalOffset;
+	uint32_t colorOffset;
+	uint32_t texCoordOffset;
+};
+
+// Procedural triangle lists written straight into caller memory, sized with the matching get*Size.
+// Indices are 32 bit and counter clockwise seen from the side the normals point to.
+// Large tessellations are split across the job system, a null one generates on the calling thread.
+// Tessellations below the minimums noted on each shape throw.
+class MeshGenerator
+{
+public:
+	MeshGenerator(JobSystem* jobSystem = nullptr);
+
+	// Unit radius around the y axis, the seam and the poles are duplicated for the texture coordinates.
+	// At least 3 segments and 2 rings.
+	static GeneratedSize getUvSphereSize(uint32_t segments, uint32_t rings);
+	void generateUvSphere(uint32_t segments, uint32_t rings, const VertexTarget& target, uint32_t* indices) const;
+
+	// Unit radius, every icosahedron edge split in subdivisions, 1 is the icosahedron itself
+	static GeneratedSize getIcosphereSize(uint32_t subdivisions);
+	void generateIcosphere(uint32_t subdivisions, const VertexTarget& target, uint32_t* indices) const;
+
+	// Open tube along z centered on the origin, normals face inwards. At least 3 sides and 1 segment.
+	static GeneratedSize getTunnelSize(uint32_t sides, uint32_t segments);
+	void generateTunnel(uint32_t sides, uint32_t segments, float radius, float length, const VertexTarget& target, uint32_t* indices) const;
+
+	// In the xz plane centered on the origin, facing +y. At least 1 column and 1 row.
+	static GeneratedSize getGridSize(uint32_t columns, uint32_t rows);
+	void generateGrid(uint32_t columns, uint32_t rows, float width, float depth, const VertexTarget& target, uint32_t* indices) const;
+
+	// Closed and flat shaded along y centered on the origin, at least 3 sides. 4 sides make an axis aligned box.
+	static GeneratedSize getPrismSize(uint32_t sides);
+	void generatePrism(uint32_t sides, float radius, float height, const VertexTarget& target, uint32_t* indices) const;
+
+private:
+	static void checkMinimum(uint32_t value, uint32_t minimum, const char* name);
+
+	// Runs rowJob over [0, rowCount) in chunks, on the job system when the work is worth it
+	void forRows(uint32_t rowCount, uint32_t verticesPerRow, const std::function<void(uint32_t firstRow, uint32_t endRow)>& rowJob) const;
+
+	// count + 1 points around the circle from startAngle, the last one is a bitwise copy of the first
+	static void computeCircle(uint32_t count, float startAngle, std::vector<float>& sines, std::vector<float>& cosines);
+
+	static void writeVertex(const VertexTarget& target, uint32_t index, const float* position, const float* normal, float u, float v);
+	static void writeQuadIndices(uint32_t* indices, uint32_t topLeft, uint32_t topRight, uint32_t bottomLeft, uint32_t bottomRight);
+
+private:
+	JobSystem* m_jobSystem;
+};
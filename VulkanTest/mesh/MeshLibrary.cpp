@@ -0,0 +1,255 @@
+#include "MeshLibrary.h"
+#include "MeshOptimizer.h"
+#include "../FileReader.h"
+#include "../VulkanException.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+#include <stdexcept>
+
+MeshLibrary::MeshLibrary(const std::vector<MeshAttribute>& vertexLayout, uint32_t vertexStride, const VertexEncoding& encoding) :
+	m_vertexLayout(vertexLayout),
+	m_vertexStride(vertexStride),
+	m_encoding(encoding),
+
+	m_vertexCount(0),
+	m_indexCounts(),
+
+	m_logicalDevice(VK_NULL_HANDLE),
+
+	m_vertexBuffer(VK_NULL_HANDLE),
+	m_indexBuffer(VK_NULL_HANDLE),
+	m_wideIndexOffset(0)
+{
+	if (m_encoding.encode == nullptr)
+	{
+		m_encoding.stride = m_vertexStride;
+	}
+}
+
+uint32_t MeshLibrary::load(const char* relativePath)
+{
+	MeshFile mesh;
+	FileReader::readMesh(relativePath, mesh);
+
+	if (mesh.topology != VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST || !mesh.matchesLayout(m_vertexLayout, m_vertexStride))
+	{
+		throw std::runtime_error(std::string("Mesh doesn't match the vertex layout ") + relativePath);
+	}
+
+	// Both keep the file mapped until the upload copied them
+	FileView file(std::shared_ptr<const void>(std::make_shared<MeshFile>(mesh)), mesh.getData(), (size_t)mesh.getDataSize());
+	FileView vertices = file.slice((size_t)mesh.getVertexDataOffset(), (size_t)mesh.getVertexDataSize());
+	FileView indices = file.slice((size_t)mesh.getIndexDataOffset(), (size_t)mesh.getIndexDataSize());
+
+	glm::vec3 boundsMin(mesh.boundsMin[0], mesh.boundsMin[1], mesh.boundsMin[2]);
+	glm::vec3 boundsMax(mesh.boundsMax[0], mesh.boundsMax[1], mesh.boundsMax[2]);
+	glm::vec4 boundingSphere(mesh.sphereCenter[0], mesh.sphereCenter[1], mesh.sphereCenter[2], mesh.sphereRadius);
+	if (mesh.indexCount > 0)
+	{
+		return addRange(vertices, mesh.vertexCount, indices, mesh.indexType, boundsMin, boundsMax, boundingSphere);
+	}
+
+	// Drawn indexed like every other mesh
+	std::vector<uint32_t> sequence(mesh.vertexCount);
+	for (uint32_t i = 0; i < mesh.vertexCount; ++i)
+	{
+		sequence[i] = i;
+	}
+
+	VkIndexType indexType = getIndexType(mesh.vertexCount);
+	return addRange(vertices, mesh.vertexCount, packIndices(sequence, indexType), indexType, boundsMin, boundsMax, boundingSphere);
+}
+
+uint32_t MeshLibrary::add(const void* vertices, uint32_t vertexCount, const std::vector<uint32_t>& indices, bool isOptimized)
+{
+	std::shared_ptr<std::vector<char>> vertexData = std::make_shared<std::vector<char>>((size_t)vertexCount * m_vertexStride);
+	memcpy(vertexData->data(), vertices, vertexData->size());
+
+	std::vector<uint32_t> optimizedIndices;
+	if (isOptimized)
+	{
+		optimizedIndices = indices;
+
+		MeshOptimizer::optimizeVertexCache(optimizedIndices.data(), optimizedIndices.size(), vertexCount);
+		MeshOptimizer::optimizeOverdraw(optimizedIndices.data(), optimizedIndices.size(),
+			vertexData->data() + m_vertexLayout[0].offset, m_vertexStride, vertexCount);
+
+		vertexCount = MeshOptimizer::optimizeVertexFetch(vertexData->data(), vertexCount, m_vertexStride, optimizedIndices.data(), optimizedIndices.size());
+		vertexData->resize((size_t)vertexCount * m_vertexStride);
+	}
+
+	// Around the box center, positions come first in every vertex
+	glm::vec3 boundsMin(FLT_MAX);
+	glm::vec3 boundsMax(-FLT_MAX);
+	for (uint32_t i = 0; i < vertexCount; ++i)
+	{
+		glm::vec3 position;
+		memcpy(&position, vertexData->data() + (size_t)i * m_vertexStride + m_vertexLayout[0].offset, sizeof(position));
+
+		boundsMin = glm::min(boundsMin, position);
+		boundsMax = glm::max(boundsMax, position);
+	}
+
+	glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+	float radius = 0.0f;
+	for (uint32_t i = 0; i < vertexCount; ++i)
+	{
+		glm::vec3 position;
+		memcpy(&position, vertexData->data() + (size_t)i * m_vertexStride + m_vertexLayout[0].offset, sizeof(position));
+
+		radius = std::max(radius, glm::length(position - center));
+	}
+
+	VkIndexType indexType = getIndexType(vertexCount);
+	return addRange(
+		FileView(vertexData, vertexData->data(), vertexData->size()), vertexCount,
+		packIndices(isOptimized ? optimizedIndices : indices, indexType), indexType,
+		boundsMin, boundsMax, glm::vec4(center, radius));
+}
+
+uint32_t MeshLibrary::addRange(FileView vertices, uint32_t vertexCount, FileView indices, VkIndexType indexType,
+	const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::vec4& boundingSphere)
+{
+	VertexQuantization quantization;
+	if (m_encoding.isQuantized)
+	{
+		quantization = VertexQuantization::fromBounds(boundsMin, boundsMax);
+	}
+
+	if (m_encoding.encode != nullptr)
+	{
+		std::shared_ptr<std::vector<char>> encoded = std::make_shared<std::vector<char>>((size_t)vertexCount * m_encoding.stride);
+		m_encoding.encode(vertices.data(), vertexCount, quantization, encoded->data());
+
+		vertices = FileView(encoded, encoded->data(), encoded->size());
+	}
+
+	uint32_t& indexCount = m_indexCounts[indexType == VK_INDEX_TYPE_UINT16 ? 0 : 1];
+
+	MeshRange range = {};
+	range.firstIndex = indexCount;
+	range.indexCount = (uint32_t)(indices.size() / MeshFile::getIndexSize(indexType));
+	range.vertexOffset = (int32_t)m_vertexCount;
+	range.indexType = indexType;
+	range.boundingSphere = glm::vec4((glm::vec3(boundingSphere) - quantization.origin) / quantization.scale, boundingSphere.w / quantization.scale);
+	range.isQuantized = m_encoding.isQuantized;
+	range.dequantization = quantization.getDequantization();
+
+	m_vertexCount += vertexCount;
+	indexCount += range.indexCount;
+
+	m_meshes.push_back(range);
+	m_pendingMeshes.push_back({ std::move(vertices), std::move(indices) });
+
+	return (uint32_t)m_meshes.size() - 1;
+}
+
+VkIndexType MeshLibrary::getIndexType(uint32_t vertexCount)
+{
+	return vertexCount <= UINT16_MAX ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+}
+
+FileView MeshLibrary::packIndices(const std::vector<uint32_t>& indices, VkIndexType indexType)
+{
+	uint32_t indexSize = MeshFile::getIndexSize(indexType);
+
+	std::shared_ptr<std::vector<char>> indexData = std::make_shared<std::vector<char>>(indices.size() * indexSize);
+	for (size_t i = 0; i < indices.size(); ++i)
+	{
+		if (indexType == VK_INDEX_TYPE_UINT16)
+		{
+			uint16_t index = (uint16_t)indices[i];
+			memcpy(indexData->data() + i * indexSize, &index, indexSize);
+		}
+		else
+		{
+			memcpy(indexData->data() + i * indexSize, &indices[i], indexSize);
+		}
+	}
+
+	return FileView(indexData, indexData->data(), indexData->size());
+}
+
+void MeshLibrary::build(VkDevice logicalDevice, DeviceAllocator& allocator, UploadEngine& uploadEngine)
+{
+	m_logicalDevice = logicalDevice;
+
+	m_wideIndexOffset = alignUp(m_indexCounts[0] * sizeof(uint16_t), sizeof(uint32_t));
+	VkDeviceSize indexBufferSize = m_wideIndexOffset + m_indexCounts[1] * sizeof(uint32_t);
+
+	createBuffer(std::max<VkDeviceSize>((VkDeviceSize)m_vertexCount * m_encoding.stride, 1), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		&m_vertexBuffer, &m_vertexMemory, allocator);
+	createBuffer(std::max<VkDeviceSize>(indexBufferSize, 1), VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		&m_indexBuffer, &m_indexMemory, allocator);
+
+	for (size_t i = 0; i < m_meshes.size(); ++i)
+	{
+		const MeshRange& mesh = m_meshes[i];
+		const PendingMesh& pending = m_pendingMeshes[i];
+
+		VkDeviceSize indexSize = MeshFile::getIndexSize(mesh.indexType);
+		uploadEngine.uploadBuffer(m_vertexBuffer, (VkDeviceSize)mesh.vertexOffset * m_encoding.stride, pending.vertices.data(), pending.vertices.size());
+		uploadEngine.uploadBuffer(m_indexBuffer, getIndexOffset(mesh.indexType) + mesh.firstIndex * indexSize, pending.indices.data(), pending.indices.size());
+	}
+
+	m_pendingMeshes.clear();
+}
+
+void MeshLibrary::destroy(DeviceAllocator& allocator)
+{
+	vkDestroyBuffer(m_logicalDevice, m_vertexBuffer, nullptr);
+	allocator.free(m_vertexMemory);
+
+	vkDestroyBuffer(m_logicalDevice, m_indexBuffer, nullptr);
+	allocator.free(m_indexMemory);
+
+	m_vertexBuffer = VK_NULL_HANDLE;
+	m_indexBuffer = VK_NULL_HANDLE;
+}
+
+const std::vector<MeshRange>& MeshLibrary::getMeshes() const
+{
+	return m_meshes;
+}
+
+VkBuffer MeshLibrary::getVertexBuffer() const
+{
+	return m_vertexBuffer;
+}
+
+VkBuffer MeshLibrary::getIndexBuffer() const
+{
+	return m_indexBuffer;
+}
+
+VkDeviceSize MeshLibrary::getIndexOffset(VkIndexType indexType) const
+{
+	return indexType == VK_INDEX_TYPE_UINT16 ? 0 : m_wideIndexOffset;
+}
+
+bool MeshLibrary::hasMixedIndexTypes() const
+{
+	return m_indexCounts[0] > 0 && m_indexCounts[1] > 0;
+}
+
+void MeshLibrary::createBuffer(VkDeviceSize size, VkBufferUsageFlags usageFlags, VkBuffer* buffer, DeviceAllocation* memory, DeviceAllocator& allocator)
+{
+	VkBufferCreateInfo bufferCreateInfo = {};
+	bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferCreateInfo.size = size;
+	bufferCreateInfo.usage = usageFlags;
+	bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateBuffer(m_logicalDevice, &bufferCreateInfo, nullptr, buffer) != VK_SUCCESS)
+	{
+		throw VulkanException("Failed to create mesh buffer.");
+	}
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetBufferMemoryRequirements(m_logicalDevice, *buffer, &memoryRequirements);
+
+	*memory = allocator.allocate(memoryRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, ResourceType::BUFFER);
+	vkBindBufferMemory(m_logicalDevice, *buffer, memory->memory, memory->offset);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "MeshFile.h"
+#include "VertexFormat.h"
+#include "../memory/UploadEngine.h"
+#include "../render/DrawList.h"
+
+#include <string>
+#include <vector>
+
+// Every mesh shares one vertex buffer and one index buffer, addressed through MeshRange offsets.
+// 16 and 32 bit indices live in two regions of the index buffer, bound at getIndexOffset().
+// Vertices are encoded into the vertex buffer's format when registered, quantized per mesh.
+class MeshLibrary
+{
+public:
+	// Meshes must all use this vertex layout, the first attribute being a R32G32B32_SFLOAT position
+	MeshLibrary(const std::vector<MeshAttribute>& vertexLayout, uint32_t vertexStride, const VertexEncoding& encoding);
+
+	// Registered before build, the returned id is the mesh's index in getMeshes()
+	uint32_t load(const char* relativePath);
+	// Indices are narrowed to 16 bits when the vertex count allows it.
+	// Optimizing reorders the triangles and vertices like the mesh converter does for mesh files.
+	uint32_t add(const void* vertices, uint32_t vertexCount, const std::vector<uint32_t>& indices, bool isOptimized = false);
+
+	// Creates the shared buffers and queues the uploads, the registered data is released once copied to staging
+	void build(VkDevice logicalDevice, DeviceAllocator& allocator, UploadEngine& uploadEngine);
+	void destroy(DeviceAllocator& allocator);
+
+	const std::vector<MeshRange>& getMeshes() const;
+
+	VkBuffer getVertexBuffer() const;
+	VkBuffer getIndexBuffer() const;
+	VkDeviceSize getIndexOffset(VkIndexType indexType) const;
+
+	// Whether the draws need both index types
+	bool hasMixedIndexTypes() const;
+
+private:
+	struct PendingMesh
+	{
+		FileView vertices;
+		FileView indices;
+	};
+
+	// vertices are in the registered layout, the bounds in object space
+	uint32_t addRange(FileView vertices, uint32_t vertexCount, FileView indices, VkIndexType indexType,
+		const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::vec4& boundingSphere);
+
+	static VkIndexType getIndexType(uint32_t vertexCount);
+	static FileView packIndices(const std::vector<uint32_t>& indices, VkIndexType indexType);
+	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usageFlags, VkBuffer* buffer, DeviceAllocation* memory, DeviceAllocator& allocator);
+
+private:
+	std::vector<MeshAttribute> m_vertexLayout;
+	uint32_t m_vertexStride;
+	VertexEncoding m_encoding;
+
+	std::vector<MeshRange> m_meshes;
+	std::vector<PendingMesh> m_pendingMeshes;
+
+	uint32_t m_vertexCount;
+	uint32_t m_indexCounts[2];
+
+	VkDevice m_logicalDevice;
+
+	VkBuffer m_vertexBuffer;
+	DeviceAllocation m_vertexMemory;
+
+	VkBuffer m_indexBuffer;
+	DeviceAllocation m_indexMemory;
+	VkDeviceSize m_wideIndexOffset;
+};
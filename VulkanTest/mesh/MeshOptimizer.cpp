@@ -0,0 +1,362 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <vector>
+
+// Forsyth's scoring
+const float CACHE_DECAY_POWER = 1.5f;
+const float LAST_TRIANGLE_SCORE = 0.75f;
+const float VALENCE_BOOST_SCALE = 2.0f;
+const float VALENCE_BOOST_POWER = 0.5f;
+
+// Clusters shorter than this don't amortize the cache restart
+const uint32_t MIN_CLUSTER_TRIANGLES = 16;
+
+static float getVertexScore(int32_t cachePosition, uint32_t remainingValence)
+{
+	if (remainingValence == 0)
+	{
+		return -1.0f;
+	}
+
+	float score = 0.0f;
+	if (cachePosition >= 0)
+	{
+		// The last triangle's vertices get a fixed score so the next triangle doesn't just reuse them
+		if (cachePosition < 3)
+		{
+			score = LAST_TRIANGLE_SCORE;
+		}
+		else
+		{
+			float scaler = 1.0f / (MeshOptimizer::LRU_CACHE_SIZE - 3);
+			score = std::pow(1.0f - (cachePosition - 3) * scaler, CACHE_DECAY_POWER);
+		}
+	}
+
+	// Vertices with few triangles left are finished off first
+	return score + VALENCE_BOOST_SCALE * std::pow((float)remainingValence, -VALENCE_BOOST_POWER);
+}
+
+void MeshOptimizer::optimizeVertexCache(uint32_t* indices, size_t indexCount, uint32_t vertexCount)
+{
+	size_t triangleCount = indexCount / 3;
+
+	// Triangles of every vertex, packed
+	std::vector<uint32_t> valences(vertexCount, 0);
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		++valences[indices[i]];
+	}
+
+	std::vector<uint32_t> firstTriangle(vertexCount + 1, 0);
+	for (uint32_t vertex = 0; vertex < vertexCount; ++vertex)
+	{
+		firstTriangle[vertex + 1] = firstTriangle[vertex] + valences[vertex];
+	}
+
+	std::vector<uint32_t> vertexTriangles(indexCount);
+	std::vector<uint32_t> cursors(firstTriangle.begin(), firstTriangle.end() - 1);
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		vertexTriangles[cursors[indices[i]]++] = (uint32_t)(i / 3);
+	}
+
+	std::vector<float> vertexScores(vertexCount);
+	for (uint32_t vertex = 0; vertex < vertexCount; ++vertex)
+	{
+		vertexScores[vertex] = getVertexScore(-1, valences[vertex]);
+	}
+
+	std::vector<float> triangleScores(triangleCount);
+	for (size_t triangle = 0; triangle < triangleCount; ++triangle)
+	{
+		const uint32_t* corners = indices + triangle * 3;
+		triangleScores[triangle] = vertexScores[corners[0]] + vertexScores[corners[1]] + vertexScores[corners[2]];
+	}
+
+	std::vector<uint32_t> source(indices, indices + indexCount);
+	std::vector<bool> isEmitted(triangleCount, false);
+	std::vector<int32_t> cachePositions(vertexCount, -1);
+
+	// Room for the 3 vertices pushed in by the emitted triangle
+	uint32_t cache[LRU_CACHE_SIZE + 3];
+	uint32_t cacheCount = 0;
+
+	size_t inputCursor = 0;
+	for (size_t output = 0; output < triangleCount; ++output)
+	{
+		// Best triangle touching the cache, any remaining triangle when the cache is dead
+		int64_t bestTriangle = -1;
+		float bestScore = -1.0f;
+		for (uint32_t entry = 0; entry < cacheCount; ++entry)
+		{
+			uint32_t vertex = cache[entry];
+			for (uint32_t i = firstTriangle[vertex]; i < firstTriangle[vertex] + valences[vertex]; ++i)
+			{
+				uint32_t triangle = vertexTriangles[i];
+				if (triangleScores[triangle] > bestScore)
+				{
+					bestScore = triangleScores[triangle];
+					bestTriangle = triangle;
+				}
+			}
+		}
+
+		if (bestTriangle < 0)
+		{
+			while (isEmitted[inputCursor])
+			{
+				++inputCursor;
+			}
+			bestTriangle = (int64_t)inputCursor;
+		}
+
+		const uint32_t* corners = &source[bestTriangle * 3];
+		memcpy(indices + output * 3, corners, 3 * sizeof(uint32_t));
+		isEmitted[bestTriangle] = true;
+		triangleScores[bestTriangle] = -1.0f;
+
+		// Only the triangles not emitted yet stay in the adjacency
+		for (uint32_t corner = 0; corner < 3; ++corner)
+		{
+			uint32_t vertex = corners[corner];
+			uint32_t* triangles = &vertexTriangles[firstTriangle[vertex]];
+			uint32_t* last = triangles + valences[vertex];
+			*std::find(triangles, last, (uint32_t)bestTriangle) = *(last - 1);
+			--valences[vertex];
+		}
+
+		// Move to front, the emitted vertices first
+		uint32_t newCache[LRU_CACHE_SIZE + 3];
+		uint32_t newCount = 0;
+		for (uint32_t corner = 0; corner < 3; ++corner)
+		{
+			if (std::find(newCache, newCache + newCount, corners[corner]) == newCache + newCount)
+			{
+				newCache[newCount++] = corners[corner];
+			}
+		}
+
+		for (uint32_t entry = 0; entry < cacheCount; ++entry)
+		{
+			uint32_t vertex = cache[entry];
+			if (vertex != corners[0] && vertex != corners[1] && vertex != corners[2])
+			{
+				newCache[newCount++] = vertex;
+			}
+		}
+
+		// Evicted vertices lose their cache score
+		for (uint32_t entry = LRU_CACHE_SIZE; entry < newCount; ++entry)
+		{
+			cachePositions[newCache[entry]] = -1;
+		}
+
+		cacheCount = std::min(newCount, LRU_CACHE_SIZE);
+		memcpy(cache, newCache, cacheCount * sizeof(uint32_t));
+
+		// Rescore the touched vertices and their remaining triangles
+		for (uint32_t entry = 0; entry < newCount; ++entry)
+		{
+			uint32_t vertex = newCache[entry];
+			int32_t position = entry < LRU_CACHE_SIZE ? (int32_t)entry : -1;
+			cachePositions[vertex] = position;
+
+			float newScore = getVertexScore(position, valences[vertex]);
+			float delta = newScore - vertexScores[vertex];
+			vertexScores[vertex] = newScore;
+
+			for (uint32_t i = firstTriangle[vertex]; i < firstTriangle[vertex] + valences[vertex]; ++i)
+			{
+				triangleScores[vertexTriangles[i]] += delta;
+			}
+		}
+	}
+}
+
+void MeshOptimizer::optimizeOverdraw(uint32_t* indices, size_t indexCount, const void* positions, size_t positionStride, uint32_t vertexCount, float threshold)
+{
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	const uint32_t cacheSize = 16;
+	float targetAcmr = analyzeVertexCache(indices, indexCount, vertexCount, cacheSize).acmr * threshold;
+
+	// FIFO cache restarted at every cluster, a cluster ends once it amortized the restart
+	std::vector<size_t> clusterStarts(1, 0);
+	std::vector<uint32_t> cacheTimestamps(vertexCount, 0);
+	uint32_t timestamp = cacheSize + 1;
+	uint32_t clusterMisses = 0;
+	for (size_t triangle = 0; triangle < triangleCount; ++triangle)
+	{
+		for (uint32_t corner = 0; corner < 3; ++corner)
+		{
+			uint32_t vertex = indices[triangle * 3 + corner];
+			if (timestamp - cacheTimestamps[vertex] > cacheSize)
+			{
+				cacheTimestamps[vertex] = timestamp++;
+				++clusterMisses;
+			}
+		}
+
+		size_t clusterTriangles = triangle + 1 - clusterStarts.back();
+		if (clusterTriangles >= MIN_CLUSTER_TRIANGLES && clusterMisses <= targetAcmr * clusterTriangles && triangle + 1 < triangleCount)
+		{
+			clusterStarts.push_back(triangle + 1);
+			clusterMisses = 0;
+			timestamp += cacheSize + 1;
+		}
+	}
+	clusterStarts.push_back(triangleCount);
+
+	auto getPosition = [positions, positionStride](uint32_t vertex, float* position)
+	{
+		memcpy(position, static_cast<const char*>(positions) + vertex * positionStride, 3 * sizeof(float));
+	};
+
+	// Area weighted centroid and normal of every cluster
+	size_t clusterCount = clusterStarts.size() - 1;
+	std::vector<float> clusterCentroids(clusterCount * 3, 0.0f);
+	std::vector<float> clusterNormals(clusterCount * 3, 0.0f);
+	float meshCentroid[3] = {};
+	float meshArea = 0.0f;
+	for (size_t cluster = 0; cluster < clusterCount; ++cluster)
+	{
+		float clusterArea = 0.0f;
+		for (size_t triangle = clusterStarts[cluster]; triangle < clusterStarts[cluster + 1]; ++triangle)
+		{
+			float a[3];
+			float b[3];
+			float c[3];
+			getPosition(indices[triangle * 3 + 0], a);
+			getPosition(indices[triangle * 3 + 1], b);
+			getPosition(indices[triangle * 3 + 2], c);
+
+			float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+			float ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+			float normal[3] = {
+				ab[1] * ac[2] - ab[2] * ac[1],
+				ab[2] * ac[0] - ab[0] * ac[2],
+				ab[0] * ac[1] - ab[1] * ac[0] };
+			float area = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+			for (uint32_t axis = 0; axis < 3; ++axis)
+			{
+				float centroid = (a[axis] + b[axis] + c[axis]) / 3.0f;
+				clusterCentroids[cluster * 3 + axis] += centroid * area;
+				clusterNormals[cluster * 3 + axis] += normal[axis];
+				meshCentroid[axis] += centroid * area;
+			}
+			clusterArea += area;
+		}
+
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			clusterCentroids[cluster * 3 + axis] /= std::max(clusterArea, FLT_MIN);
+		}
+		meshArea += clusterArea;
+	}
+
+	for (uint32_t axis = 0; axis < 3; ++axis)
+	{
+		meshCentroid[axis] /= std::max(meshArea, FLT_MIN);
+	}
+
+	// Clusters far out along their own normal are the likeliest occluders
+	std::vector<float> sortKeys(clusterCount);
+	for (size_t cluster = 0; cluster < clusterCount; ++cluster)
+	{
+		const float* normal = &clusterNormals[cluster * 3];
+		float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+		float key = 0.0f;
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			key += (clusterCentroids[cluster * 3 + axis] - meshCentroid[axis]) * normal[axis];
+		}
+		sortKeys[cluster] = length > 0.0f ? key / length : 0.0f;
+	}
+
+	std::vector<uint32_t> order(clusterCount);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&sortKeys](uint32_t a, uint32_t b)
+		{
+			return sortKeys[a] > sortKeys[b];
+		});
+
+	std::vector<uint32_t> source(indices, indices + indexCount);
+	uint32_t* output = indices;
+	for (uint32_t cluster : order)
+	{
+		size_t first = clusterStarts[cluster] * 3;
+		size_t count = clusterStarts[cluster + 1] * 3 - first;
+
+		memcpy(output, &source[first], count * sizeof(uint32_t));
+		output += count;
+	}
+}
+
+uint32_t MeshOptimizer::optimizeVertexFetch(void* vertices, uint32_t vertexCount, uint32_t vertexStride, uint32_t* indices, size_t indexCount)
+{
+	std::vector<uint32_t> remap(vertexCount, UINT32_MAX);
+	uint32_t nextVertex = 0;
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		uint32_t& newVertex = remap[indices[i]];
+		if (newVertex == UINT32_MAX)
+		{
+			newVertex = nextVertex++;
+		}
+		indices[i] = newVertex;
+	}
+
+	char* vertexData = static_cast<char*>(vertices);
+	std::vector<char> source(vertexData, vertexData + (size_t)vertexCount * vertexStride);
+	for (uint32_t vertex = 0; vertex < vertexCount; ++vertex)
+	{
+		if (remap[vertex] != UINT32_MAX)
+		{
+			memcpy(vertexData + (size_t)remap[vertex] * vertexStride, &source[(size_t)vertex * vertexStride], vertexStride);
+		}
+	}
+
+	return nextVertex;
+}
+
+VertexCacheStatistics MeshOptimizer::analyzeVertexCache(const uint32_t* indices, size_t indexCount, uint32_t vertexCount, uint32_t cacheSize)
+{
+	VertexCacheStatistics statistics = {};
+
+	std::vector<uint32_t> cacheTimestamps(vertexCount, 0);
+	std::vector<bool> isReferenced(vertexCount, false);
+	uint32_t referencedCount = 0;
+	uint32_t timestamp = cacheSize + 1;
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		uint32_t vertex = indices[i];
+		if (timestamp - cacheTimestamps[vertex] > cacheSize)
+		{
+			cacheTimestamps[vertex] = timestamp++;
+			++statistics.vertexTransforms;
+		}
+
+		if (!isReferenced[vertex])
+		{
+			isReferenced[vertex] = true;
+			++referencedCount;
+		}
+	}
+
+	statistics.acmr = indexCount > 0 ? (float)statistics.vertexTransforms / (indexCount / 3) : 0.0f;
+	statistics.atvr = referencedCount > 0 ? (float)statistics.vertexTransforms / referencedCount : 0.0f;
+
+	return statistics;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+struct VertexCacheStatistics
+{
+	uint32_t vertexTransforms;
+
+	// Transforms per triangle, 0.5 at best for large regular meshes, 3 at worst
+	float acmr;
+	// Transforms per referenced vertex, 1 at best
+	float atvr;
+};
+
+// Index buffer reordering for triangle lists, every pass works in place
+class MeshOptimizer
+{
+public:
+	// Forsyth's linear speed vertex cache optimisation, tuned for a 32 entry LRU cache
+	static void optimizeVertexCache(uint32_t* indices, size_t indexCount, uint32_t vertexCount);
+
+	// Splits the cache optimized order into clusters and draws the outward facing ones first.
+	// Clusters only end where it keeps the ACMR below threshold times the input's.
+	// positions are float xyz, positionStride bytes apart.
+	static void optimizeOverdraw(uint32_t* indices, size_t indexCount, const void* positions, size_t positionStride, uint32_t vertexCount, float threshold = 1.05f);
+
+	// Renumbers the vertices in first use order and drops the unreferenced ones, returns the new vertex count
+	static uint32_t optimizeVertexFetch(void* vertices, uint32_t vertexCount, uint32_t vertexStride, uint32_t* indices, size_t indexCount);
+
+	// Simulates a FIFO post transform cache, the kind most hardware has
+	static VertexCacheStatistics analyzeVertexCache(const uint32_t* indices, size_t indexCount, uint32_t vertexCount, uint32_t cacheSize = 16);
+
+	static const uint32_t LRU_CACHE_SIZE = 32;
+
+private:
+	MeshOptimizer();
+};
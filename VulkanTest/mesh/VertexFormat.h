@@ -0,0 +1,417 @@
+#pragma once
+
+#include "MeshFile.h"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Quantized positions are relative to the cube around the mesh's bounding box.
+// One scale for every axis keeps the dequantization a similarity, bounding spheres stay spheres.
+struct VertexQuantization
+{
+	glm::vec3 origin = glm::vec3(0.0f);
+	float scale = 1.0f;
+
+	static VertexQuantization fromBounds(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+	{
+		glm::vec3 extent = boundsMax - boundsMin;
+
+		VertexQuantization quantization;
+		quantization.origin = boundsMin;
+		quantization.scale = glm::max(glm::max(extent.x, extent.y), glm::max(extent.z, 1e-6f));
+
+		return quantization;
+	}
+
+	// Vertex buffer positions to object space, applied before the model matrix
+	glm::mat4 getDequantization() const
+	{
+		glm::mat4 dequantization(scale);
+		dequantization[3] = glm::vec4(origin, 1.0f);
+
+		return dequantization;
+	}
+};
+
+
+
+//////////////////////////
+////// ATTRIBUTES ////////
+//////////////////////////
+
+// Every attribute converts a Value to its storage with encode and back with decode.
+// Sizes are multiples of 4 bytes so every attribute stays aligned in the vertex.
+
+struct FloatPosition
+{
+	typedef glm::vec3 Value;
+	static const MeshSemantic SEMANTIC = MeshSemantic::POSITION;
+	static const VkFormat FORMAT = VK_FORMAT_R32G32B32_SFLOAT;
+	static const bool IS_QUANTIZED = false;
+
+	float value[3];
+
+	void encode(const Value& position, const VertexQuantization&)
+	{
+		memcpy(value, &position, sizeof(value));
+	}
+
+	Value decode(const VertexQuantization&) const
+	{
+		return Value(value[0], value[1], value[2]);
+	}
+};
+
+// 16 bit normalized in the quantization cube, w is padding since 3 component 16 bit formats
+// are rarely supported for vertex buffers
+struct Unorm16Position
+{
+	typedef glm::vec3 Value;
+	static const MeshSemantic SEMANTIC = MeshSemantic::POSITION;
+	static const VkFormat FORMAT = VK_FORMAT_R16G16B16A16_UNORM;
+	static const bool IS_QUANTIZED = true;
+
+	uint16_t value[4];
+
+	void encode(const Value& position, const VertexQuantization& quantization)
+	{
+		glm::vec3 normalized = glm::clamp((position - quantization.origin) / quantization.scale, 0.0f, 1.0f);
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			value[axis] = (uint16_t)(normalized[axis] * UINT16_MAX + 0.5f);
+		}
+		value[3] = UINT16_MAX;
+	}
+
+	Value decode(const VertexQuantization& quantization) const
+	{
+		return quantization.origin + Value(value[0], value[1], value[2]) * (quantization.scale / UINT16_MAX);
+	}
+};
+
+struct FloatNormal
+{
+	typedef glm::vec3 Value;
+	static const MeshSemantic SEMANTIC = MeshSemantic::NORMAL;
+	static const VkFormat FORMAT = VK_FORMAT_R32G32B32_SFLOAT;
+	static const bool IS_QUANTIZED = false;
+
+	float value[3];
+
+	void encode(const Value& normal, const VertexQuantization&)
+	{
+		memcpy(value, &normal, sizeof(value));
+	}
+
+	Value decode(const VertexQuantization&) const
+	{
+		return Value(value[0], value[1], value[2]);
+	}
+};
+
+// Unit vector projected on the octahedron and its lower half folded over the upper one,
+// the shader unfolds it with n = (xy, 1 - |x| - |y|), xy += sign(xy) * min(n.z, 0)
+struct OctahedralNormal
+{
+	typedef glm::vec3 Value;
+	static const MeshSemantic SEMANTIC = MeshSemantic::NORMAL;
+	static const VkFormat FORMAT = VK_FORMAT_R16G16_SNORM;
+	static const bool IS_QUANTIZED = false;
+
+	uint32_t value;
+
+	void encode(const Value& normal, const VertexQuantization&)
+	{
+		glm::vec2 projected = glm::vec2(normal) / glm::max(glm::abs(normal.x) + glm::abs(normal.y) + glm::abs(normal.z), 1e-6f);
+		if (normal.z < 0.0f)
+		{
+			projected = (1.0f - glm::abs(glm::vec2(projected.y, projected.x))) * signNotZero(projected);
+		}
+		value = glm::packSnorm2x16(projected);
+	}
+
+	Value decode(const VertexQuantization&) const
+	{
+		glm::vec2 projected = glm::unpackSnorm2x16(value);
+		glm::vec3 normal(projected, 1.0f - glm::abs(projected.x) - glm::abs(projected.y));
+		if (normal.z < 0.0f)
+		{
+			glm::vec2 folded = (1.0f - glm::abs(glm::vec2(normal.y, normal.x))) * signNotZero(glm::vec2(normal));
+			normal.x = folded.x;
+			normal.y = folded.y;
+		}
+		return glm::normalize(normal);
+	}
+
+private:
+	static glm::vec2 signNotZero(const glm::vec2& v)
+	{
+		return glm::vec2(v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f);
+	}
+};
+
+struct FloatColor
+{
+	typedef glm::vec3 Value;
+	static const MeshSemantic SEMANTIC = MeshSemantic::COLOR;
+	static const VkFormat FORMAT = VK_FORMAT_R32G32B32_SFLOAT;
+	static const bool IS_QUANTIZED = false;
+
+	float value[3];
+
+	void encode(const Value& color, const VertexQuantization&)
+	{
+		memcpy(value, &color, sizeof(value));
+	}
+
+	Value decode(const VertexQuantization&) const
+	{
+		return Value(value[0], value[1], value[2]);
+	}
+};
+
+// Opaque, alpha is always 1
+struct Rgba8Color
+{
+	typedef glm::vec3 Value;
+	static const MeshSemantic SEMANTIC = MeshSemantic::COLOR;
+	static const VkFormat FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+	static const bool IS_QUANTIZED = false;
+
+	uint32_t value;
+
+	void encode(const Value& color, const VertexQuantization&)
+	{
+		value = glm::packUnorm4x8(glm::vec4(color, 1.0f));
+	}
+
+	Value decode(const VertexQuantization&) const
+	{
+		return Value(glm::unpackUnorm4x8(value));
+	}
+};
+
+struct FloatTexCoord
+{
+	typedef glm::vec2 Value;
+	static const MeshSemantic SEMANTIC = MeshSemantic::TEX_COORD;
+	static const VkFormat FORMAT = VK_FORMAT_R32G32_SFLOAT;
+	static const bool IS_QUANTIZED = false;
+
+	float value[2];
+
+	void encode(const Value& texCoord, const VertexQuantization&)
+	{
+		memcpy(value, &texCoord, sizeof(value));
+	}
+
+	Value decode(const VertexQuantization&) const
+	{
+		return Value(value[0], value[1]);
+	}
+};
+
+struct HalfTexCoord
+{
+	typedef glm::vec2 Value;
+	static const MeshSemantic SEMANTIC = MeshSemantic::TEX_COORD;
+	static const VkFormat FORMAT = VK_FORMAT_R16G16_SFLOAT;
+	static const bool IS_QUANTIZED = false;
+
+	uint32_t value;
+
+	void encode(const Value& texCoord, const VertexQuantization&)
+	{
+		value = glm::packHalf2x16(texCoord);
+	}
+
+	Value decode(const VertexQuantization&) const
+	{
+		return glm::unpackHalf2x16(value);
+	}
+};
+
+
+
+//////////////////////////////
+////// VERTEX FORMAT /////////
+//////////////////////////////
+
+template<typename... Attributes>
+constexpr uint32_t getAttributeOffset(uint32_t location)
+{
+	const uint32_t sizes[] = { 0, (uint32_t)sizeof(Attributes)... };
+
+	uint32_t offset = 0;
+	for (uint32_t i = 0; i < location; ++i)
+	{
+		offset += sizes[i + 1];
+	}
+
+	return offset;
+}
+
+template<typename... Attributes>
+constexpr bool hasQuantizedAttribute()
+{
+	const bool isQuantized[] = { false, Attributes::IS_QUANTIZED... };
+
+	for (bool attributeIsQuantized : isQuantized)
+	{
+		if (attributeIsQuantized)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Converts vertexCount tightly packed vertices of one format into another
+typedef void (*VertexEncoder)(const void* vertices, uint32_t vertexCount, const VertexQuantization& quantization, void* encoded);
+
+// How a MeshLibrary stores its vertices, a null encoder stores them as registered
+struct VertexEncoding
+{
+	uint32_t stride;
+	bool isQuantized;
+	VertexEncoder encode;
+};
+
+// Vertex of the given attributes packed in declaration order, attribute i at shader location i.
+// The Vulkan vertex input descriptions are generated from the declaration.
+template<typename... Attributes>
+class VertexFormat
+{
+public:
+	static const uint32_t ATTRIBUTE_COUNT = sizeof...(Attributes);
+	static const uint32_t STRIDE = getAttributeOffset<Attributes...>(sizeof...(Attributes));
+
+	// Positions need a VertexQuantization computed from the mesh bounds
+	static const bool IS_QUANTIZED = hasQuantizedAttribute<Attributes...>();
+
+	template<uint32_t LOCATION>
+	using Attribute = typename std::tuple_element<LOCATION, std::tuple<Attributes...>>::type;
+
+	VertexFormat() = default;
+
+	VertexFormat(const typename Attributes::Value&... values, const VertexQuantization& quantization = VertexQuantization())
+	{
+		set(quantization, std::index_sequence_for<Attributes...>(), values...);
+	}
+
+	template<uint32_t LOCATION>
+	Attribute<LOCATION>& get()
+	{
+		return *reinterpret_cast<Attribute<LOCATION>*>(m_data + getAttributeOffset<Attributes...>(LOCATION));
+	}
+
+	template<uint32_t LOCATION>
+	const Attribute<LOCATION>& get() const
+	{
+		return *reinterpret_cast<const Attribute<LOCATION>*>(m_data + getAttributeOffset<Attributes...>(LOCATION));
+	}
+
+	// Location of the attribute with this semantic, ATTRIBUTE_COUNT when there is none
+	static constexpr uint32_t findSemantic(MeshSemantic semantic)
+	{
+		const MeshSemantic semantics[] = { semantic, Attributes::SEMANTIC... };
+
+		for (uint32_t location = 0; location < ATTRIBUTE_COUNT; ++location)
+		{
+			if (semantics[location + 1] == semantic)
+			{
+				return location;
+			}
+		}
+
+		return ATTRIBUTE_COUNT;
+	}
+
+	static constexpr VkVertexInputBindingDescription getBindingDescription(uint32_t binding)
+	{
+		return { binding, STRIDE, VK_VERTEX_INPUT_RATE_VERTEX };
+	}
+
+	static constexpr std::array<VkVertexInputAttributeDescription, sizeof...(Attributes)> getAttributeDescriptions(uint32_t binding)
+	{
+		return getAttributeDescriptions(binding, std::index_sequence_for<Attributes...>());
+	}
+
+	// Layout of mesh files holding these vertices
+	static std::vector<MeshAttribute> getMeshLayout()
+	{
+		return getMeshLayout(std::index_sequence_for<Attributes...>());
+	}
+
+	// Attributes are matched by semantic, the ones Source doesn't have are zero
+	template<typename Source>
+	static void encode(const void* vertices, uint32_t vertexCount, const VertexQuantization& quantization, void* encoded)
+	{
+		static_assert(!Source::IS_QUANTIZED, "Vertices are only encoded from unquantized formats.");
+
+		const Source* source = static_cast<const Source*>(vertices);
+		VertexFormat* destination = static_cast<VertexFormat*>(encoded);
+		for (uint32_t i = 0; i < vertexCount; ++i)
+		{
+			destination[i].assign(source[i], quantization, std::index_sequence_for<Attributes...>());
+		}
+	}
+
+	template<typename Source>
+	static VertexEncoding getEncoding()
+	{
+		return { STRIDE, IS_QUANTIZED, std::is_same<Source, VertexFormat>::value ? nullptr : &encode<Source> };
+	}
+
+private:
+	template<size_t... LOCATIONS>
+	static constexpr std::array<VkVertexInputAttributeDescription, sizeof...(Attributes)> getAttributeDescriptions(uint32_t binding, std::index_sequence<LOCATIONS...>)
+	{
+		return { { { (uint32_t)LOCATIONS, binding, Attributes::FORMAT, getAttributeOffset<Attributes...>((uint32_t)LOCATIONS) }... } };
+	}
+
+	template<size_t... LOCATIONS>
+	static std::vector<MeshAttribute> getMeshLayout(std::index_sequence<LOCATIONS...>)
+	{
+		return { { (uint32_t)Attributes::SEMANTIC, Attributes::FORMAT, getAttributeOffset<Attributes...>((uint32_t)LOCATIONS), 0 }... };
+	}
+
+	template<size_t... LOCATIONS>
+	void set(const VertexQuantization& quantization, std::index_sequence<LOCATIONS...>, const typename Attributes::Value&... values)
+	{
+		int expansion[] = { 0, (get<LOCATIONS>().encode(values, quantization), 0)... };
+		(void)expansion;
+	}
+
+	template<typename Source, size_t... LOCATIONS>
+	void assign(const Source& source, const VertexQuantization& quantization, std::index_sequence<LOCATIONS...>)
+	{
+		int expansion[] = { 0, (assignAttribute<LOCATIONS, Source::findSemantic(Attribute<LOCATIONS>::SEMANTIC)>(source, quantization,
+			std::integral_constant<bool, (Source::findSemantic(Attribute<LOCATIONS>::SEMANTIC) < Source::ATTRIBUTE_COUNT)>()), 0)... };
+		(void)expansion;
+	}
+
+	template<uint32_t LOCATION, uint32_t SOURCE_LOCATION, typename Source>
+	void assignAttribute(const Source& source, const VertexQuantization& quantization, std::true_type)
+	{
+		get<LOCATION>().encode(source.template get<SOURCE_LOCATION>().decode(VertexQuantization()), quantization);
+	}
+
+	template<uint32_t LOCATION, uint32_t SOURCE_LOCATION, typename Source>
+	void assignAttribute(const Source&, const VertexQuantization& quantization, std::false_type)
+	{
+		get<LOCATION>().encode(typename Attribute<LOCATION>::Value(0.0f), quantization);
+	}
+
+private:
+	alignas(4) char m_data[STRIDE];
+};
@@ -0,0 +1,142 @@
+#include "PipelineCache.h"
+#include "../FileReader.h"
+#include "../VulkanException.h"
+
+#include <cstring>
+#include <iostream>
+
+PipelineCache::PipelineCache() :
+	m_logicalDevice(VK_NULL_HANDLE),
+	m_deviceProperties(),
+
+	m_relativePath(nullptr),
+
+	m_pipelineCache(VK_NULL_HANDLE)
+{
+}
+
+void PipelineCache::init(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, const char* relativePath)
+{
+	m_logicalDevice = logicalDevice;
+	m_relativePath = relativePath;
+
+	vkGetPhysicalDeviceProperties(physicalDevice, &m_deviceProperties);
+
+	// Unmapped before save() replaces the file
+	FileView fileData;
+	bool isLoaded = FileReader::tryOpenData(m_relativePath, fileData, MappedFile::AccessHint::WILL_NEED) &&
+		isCompatible(fileData.data(), fileData.size());
+
+	VkPipelineCacheCreateInfo pipelineCacheCreateInfo = {};
+	pipelineCacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+
+	if (isLoaded)
+	{
+		pipelineCacheCreateInfo.initialDataSize = fileData.size() - sizeof(FileHeader);
+		pipelineCacheCreateInfo.pInitialData = fileData.data() + sizeof(FileHeader);
+	}
+
+	if (vkCreatePipelineCache(m_logicalDevice, &pipelineCacheCreateInfo, nullptr, &m_pipelineCache) != VK_SUCCESS)
+	{
+		throw VulkanException("Failed to create pipeline cache.");
+	}
+}
+
+void PipelineCache::destroy()
+{
+	try
+	{
+		save();
+	}
+	catch (const std::exception& e)
+	{
+		// A missing cache only costs compile time on the next run
+		std::cerr << "Pipeline cache not saved: " << e.what() << std::endl;
+	}
+
+	vkDestroyPipelineCache(m_logicalDevice, m_pipelineCache, nullptr);
+	m_pipelineCache = VK_NULL_HANDLE;
+}
+
+void PipelineCache::save()
+{
+	size_t dataSize = 0;
+	if (vkGetPipelineCacheData(m_logicalDevice, m_pipelineCache, &dataSize, nullptr) != VK_SUCCESS)
+	{
+		throw VulkanException("Failed to query pipeline cache size.");
+	}
+
+	std::vector<char> fileData(sizeof(FileHeader) + dataSize);
+	if (vkGetPipelineCacheData(m_logicalDevice, m_pipelineCache, &dataSize, fileData.data() + sizeof(FileHeader)) != VK_SUCCESS)
+	{
+		throw VulkanException("Failed to read pipeline cache.");
+	}
+	fileData.resize(sizeof(FileHeader) + dataSize);
+
+	FileHeader header = {};
+	header.magic = FILE_MAGIC;
+	header.version = FILE_VERSION;
+	header.vendorID = m_deviceProperties.vendorID;
+	header.deviceID = m_deviceProperties.deviceID;
+	header.driverVersion = m_deviceProperties.driverVersion;
+	memcpy(header.pipelineCacheUUID, m_deviceProperties.pipelineCacheUUID, VK_UUID_SIZE);
+	header.dataSize = dataSize;
+	header.checksum = computeChecksum(fileData.data() + sizeof(FileHeader), dataSize);
+
+	memcpy(fileData.data(), &header, sizeof(FileHeader));
+
+	FileReader::writeDataAtomic(m_relativePath, fileData.data(), fileData.size());
+}
+
+VkPipelineCache PipelineCache::getHandle() const
+{
+	return m_pipelineCache;
+}
+
+bool PipelineCache::isCompatible(const char* fileData, size_t fileSize) const
+{
+	if (fileSize < sizeof(FileHeader) + sizeof(VkPipelineCacheHeaderVersionOne))
+	{
+		return false;
+	}
+
+	FileHeader header;
+	memcpy(&header, fileData, sizeof(FileHeader));
+
+	const char* data = fileData + sizeof(FileHeader);
+	size_t dataSize = fileSize - sizeof(FileHeader);
+
+	if (header.magic != FILE_MAGIC || header.version != FILE_VERSION ||
+		header.vendorID != m_deviceProperties.vendorID ||
+		header.deviceID != m_deviceProperties.deviceID ||
+		header.driverVersion != m_deviceProperties.driverVersion ||
+		memcmp(header.pipelineCacheUUID, m_deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) != 0 ||
+		header.dataSize != dataSize ||
+		header.checksum != computeChecksum(data, dataSize))
+	{
+		return false;
+	}
+
+	// The driver's own header has to agree as well
+	VkPipelineCacheHeaderVersionOne cacheHeader;
+	memcpy(&cacheHeader, data, sizeof(VkPipelineCacheHeaderVersionOne));
+
+	return cacheHeader.headerSize >= sizeof(VkPipelineCacheHeaderVersionOne) &&
+		cacheHeader.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+		cacheHeader.vendorID == m_deviceProperties.vendorID &&
+		cacheHeader.deviceID == m_deviceProperties.deviceID &&
+		memcmp(cacheHeader.pipelineCacheUUID, m_deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+uint64_t PipelineCache::computeChecksum(const char* data, size_t size)
+{
+	// FNV-1a
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= (uint8_t)data[i];
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
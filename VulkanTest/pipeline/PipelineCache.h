@@ -0,0 +1,50 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+
+// VkPipelineCache backed by a file. The blob is only reused when it was written by
+// the same device and driver, otherwise the cache starts empty.
+class PipelineCache
+{
+public:
+	PipelineCache();
+
+	void init(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, const char* relativePath);
+	void destroy();
+
+	void save();
+
+	VkPipelineCache getHandle() const;
+
+private:
+	struct FileHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+
+		uint32_t vendorID;
+		uint32_t deviceID;
+		uint32_t driverVersion;
+		uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+
+		uint64_t dataSize;
+		uint64_t checksum;
+	};
+
+	static const uint32_t FILE_MAGIC = 0x43505456; // "VTPC"
+	static const uint32_t FILE_VERSION = 1;
+
+	bool isCompatible(const char* fileData, size_t fileSize) const;
+	static uint64_t computeChecksum(const char* data, size_t size);
+
+private:
+	VkDevice m_logicalDevice;
+	VkPhysicalDeviceProperties m_deviceProperties;
+
+	const char* m_relativePath;
+
+	VkPipelineCache m_pipelineCache;
+};
@@ -0,0 +1,190 @@
+#include "GpuTimer.h"
+#include "Profiler.h"
+#include "../VulkanException.h"
+
+#include <algorithm>
+
+GpuTimer::GpuTimer() :
+	m_logicalDevice(VK_NULL_HANDLE),
+	m_queryPool(VK_NULL_HANDLE),
+
+	m_isEnabled(false),
+	m_timestampPeriod(1.0),
+	m_timestampMask(~0ull),
+
+	m_frameCount(0),
+	m_currentFrame(0),
+
+	m_clockOffset(0),
+	m_hasClockOffset(false)
+{
+}
+
+void GpuTimer::init(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, uint32_t queueFamilyIndex, uint32_t frameCount)
+{
+	m_logicalDevice = logicalDevice;
+	m_frameCount = frameCount;
+
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+	uint32_t validBits = queueFamilies[queueFamilyIndex].timestampValidBits;
+	m_isEnabled = validBits > 0;
+	if (!m_isEnabled)
+	{
+		return;
+	}
+
+	m_timestampMask = validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+	m_timestampPeriod = deviceProperties.limits.timestampPeriod;
+
+	VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+	queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolCreateInfo.queryCount = m_frameCount * MAX_ZONES_PER_FRAME * 2;
+
+	if (vkCreateQueryPool(m_logicalDevice, &queryPoolCreateInfo, nullptr, &m_queryPool) != VK_SUCCESS)
+	{
+		throw VulkanException("Failed to create timestamp query pool.");
+	}
+
+	m_frames.reset(new Frame[m_frameCount]);
+	for (uint32_t i = 0; i < m_frameCount; ++i)
+	{
+		m_frames[i].zoneCount = 0;
+		m_frames[i].submitTime = 0;
+		m_frames[i].isPending = false;
+	}
+
+	m_results.resize(MAX_ZONES_PER_FRAME * 2);
+}
+
+void GpuTimer::destroy()
+{
+	if (m_queryPool != VK_NULL_HANDLE)
+	{
+		vkDestroyQueryPool(m_logicalDevice, m_queryPool, nullptr);
+		m_queryPool = VK_NULL_HANDLE;
+	}
+}
+
+bool GpuTimer::isEnabled() const
+{
+	return m_isEnabled;
+}
+
+void GpuTimer::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+{
+	if (!m_isEnabled)
+	{
+		return;
+	}
+
+	collectFrame(frameIndex);
+
+	m_currentFrame = frameIndex;
+	m_frames[frameIndex].zoneCount = 0;
+
+	vkCmdResetQueryPool(commandBuffer, m_queryPool, frameIndex * MAX_ZONES_PER_FRAME * 2, MAX_ZONES_PER_FRAME * 2);
+}
+
+uint32_t GpuTimer::beginZone(VkCommandBuffer commandBuffer, const char* name, VkPipelineStageFlagBits stage)
+{
+	if (!m_isEnabled)
+	{
+		return INVALID_ZONE;
+	}
+
+	Frame& frame = m_frames[m_currentFrame];
+	uint32_t zone = frame.zoneCount.fetch_add(1);
+	if (zone >= MAX_ZONES_PER_FRAME)
+	{
+		return INVALID_ZONE;
+	}
+
+	frame.names[zone] = name;
+	vkCmdWriteTimestamp(commandBuffer, stage, m_queryPool, (m_currentFrame * MAX_ZONES_PER_FRAME + zone) * 2);
+
+	return zone;
+}
+
+void GpuTimer::endZone(VkCommandBuffer commandBuffer, uint32_t zone, VkPipelineStageFlagBits stage)
+{
+	if (zone == INVALID_ZONE)
+	{
+		return;
+	}
+
+	vkCmdWriteTimestamp(commandBuffer, stage, m_queryPool, (m_currentFrame * MAX_ZONES_PER_FRAME + zone) * 2 + 1);
+}
+
+void GpuTimer::markSubmit()
+{
+	if (!m_isEnabled)
+	{
+		return;
+	}
+
+	Frame& frame = m_frames[m_currentFrame];
+	frame.submitTime = Profiler::now();
+	frame.isPending = true;
+}
+
+void GpuTimer::collectFrame(uint32_t frameIndex)
+{
+	Frame& frame = m_frames[frameIndex];
+	if (!frame.isPending)
+	{
+		return;
+	}
+	frame.isPending = false;
+
+	uint32_t zoneCount = std::min(frame.zoneCount.load(), MAX_ZONES_PER_FRAME);
+	if (zoneCount == 0)
+	{
+		return;
+	}
+
+	// No wait flag, a frame with a missing timestamp is dropped rather than waited for
+	VkResult result = vkGetQueryPoolResults(m_logicalDevice, m_queryPool,
+		frameIndex * MAX_ZONES_PER_FRAME * 2, zoneCount * 2,
+		zoneCount * 2 * sizeof(uint64_t), m_results.data(), sizeof(uint64_t),
+		VK_QUERY_RESULT_64_BIT);
+
+	if (result != VK_SUCCESS)
+	{
+		return;
+	}
+
+	uint64_t frameStart = ~0ull;
+	uint64_t frameEnd = 0;
+	for (uint32_t i = 0; i < zoneCount * 2; ++i)
+	{
+		m_results[i] = (uint64_t)((m_results[i] & m_timestampMask) * m_timestampPeriod);
+		frameStart = std::min(frameStart, m_results[i]);
+		frameEnd = std::max(frameEnd, m_results[i]);
+	}
+
+	// The GPU starts the frame after its submission, every frame bounds the offset from below
+	int64_t offset = (int64_t)frame.submitTime - (int64_t)frameStart;
+	if (!m_hasClockOffset || offset > m_clockOffset)
+	{
+		m_clockOffset = offset;
+		m_hasClockOffset = true;
+	}
+
+	for (uint32_t i = 0; i < zoneCount; ++i)
+	{
+		Profiler::recordGpuZone(frame.names[i],
+			(uint64_t)((int64_t)m_results[i * 2] + m_clockOffset),
+			(uint64_t)((int64_t)m_results[i * 2 + 1] + m_clockOffset));
+	}
+
+	Profiler::recordGpuFrame(frameEnd - frameStart);
+}
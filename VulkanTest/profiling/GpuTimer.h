@@ -0,0 +1,65 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Timestamp queries around GPU work, one query range per frame in flight. A frame's results are
+// read once its slot comes around again, the fence has signaled by then and nothing blocks.
+// Zones end up on the profiler's GPU track, shifted into the CPU time base.
+class GpuTimer
+{
+public:
+	static const uint32_t MAX_ZONES_PER_FRAME = 64;
+	static const uint32_t INVALID_ZONE = ~0u;
+
+	GpuTimer();
+
+	// Disabled when the queue family has no valid timestamp bits
+	void init(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, uint32_t queueFamilyIndex, uint32_t frameCount);
+	void destroy();
+
+	bool isEnabled() const;
+
+	// Outside of a render pass, once the frame's fence has signaled
+	void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+	// Any command buffer of the frame, from any recording thread
+	uint32_t beginZone(VkCommandBuffer commandBuffer, const char* name, VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+	void endZone(VkCommandBuffer commandBuffer, uint32_t zone, VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+
+	// Right before the frame is submitted, the GPU can't start it any earlier
+	void markSubmit();
+
+private:
+	struct Frame
+	{
+		const char* names[MAX_ZONES_PER_FRAME];
+		std::atomic<uint32_t> zoneCount;
+		uint64_t submitTime;
+		bool isPending;
+	};
+
+	void collectFrame(uint32_t frameIndex);
+
+private:
+	VkDevice m_logicalDevice;
+	VkQueryPool m_queryPool;
+
+	bool m_isEnabled;
+	double m_timestampPeriod;
+	uint64_t m_timestampMask;
+
+	uint32_t m_frameCount;
+	std::unique_ptr<Frame[]> m_frames;
+	uint32_t m_currentFrame;
+
+	// GPU to CPU time offset in nanoseconds, the tightest bound seen so far
+	int64_t m_clockOffset;
+	bool m_hasClockOffset;
+
+	std::vector<uint64_t> m_results;
+};
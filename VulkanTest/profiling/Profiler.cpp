@@ -0,0 +1,238 @@
+#include "Profiler.h"
+#include "../FileReader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <sstream>
+
+namespace
+{
+	const std::chrono::steady_clock::time_point s_epoch = std::chrono::steady_clock::now();
+
+	std::mutex s_threadRingsMutex;
+
+	struct FrameHistory
+	{
+		std::mutex mutex;
+		std::vector<uint64_t> frameTimes;
+		uint64_t frameCount = 0;
+	};
+
+	FrameHistory s_cpuFrames;
+	FrameHistory s_gpuFrames;
+	FrameHistory s_inputLatencies;
+	uint64_t s_lastFrameMark = 0;
+
+	thread_local void* t_threadRing = nullptr;
+
+	// Callers hold the history's mutex
+	void pushFrameTime(FrameHistory& history, uint64_t frameTime)
+	{
+		if (history.frameTimes.size() < Profiler::FRAME_HISTORY)
+		{
+			history.frameTimes.push_back(frameTime);
+		}
+		else
+		{
+			history.frameTimes[history.frameCount % Profiler::FRAME_HISTORY] = frameTime;
+		}
+		++history.frameCount;
+	}
+
+	FrameStats computeFrameStats(FrameHistory& history)
+	{
+		std::vector<uint64_t> frameTimes;
+		{
+			std::lock_guard<std::mutex> lock(history.mutex);
+			frameTimes = history.frameTimes;
+		}
+
+		FrameStats stats;
+		if (frameTimes.empty())
+		{
+			return stats;
+		}
+
+		std::sort(frameTimes.begin(), frameTimes.end());
+
+		auto percentile = [&frameTimes](double fraction)
+		{
+			size_t index = std::min(frameTimes.size() - 1, (size_t)(fraction * frameTimes.size()));
+			return frameTimes[index] / 1e6;
+		};
+
+		uint64_t total = 0;
+		for (uint64_t frameTime : frameTimes)
+		{
+			total += frameTime;
+		}
+
+		stats.frameCount = (uint32_t)frameTimes.size();
+		stats.mean = (double)total / frameTimes.size() / 1e6;
+		stats.p50 = percentile(0.50);
+		stats.p95 = percentile(0.95);
+		stats.p99 = percentile(0.99);
+		stats.max = frameTimes.back() / 1e6;
+
+		return stats;
+	}
+}
+
+uint64_t Profiler::now()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s_epoch).count();
+}
+
+void Profiler::beginZone(const char* name)
+{
+	ThreadRing& ring = getThreadRing();
+
+	// Deeper zones are dropped, their end still has to be matched
+	if (ring.depth < MAX_ZONE_DEPTH)
+	{
+		ring.openZones[ring.depth] = { name, now(), 0, ring.depth };
+	}
+	++ring.depth;
+}
+
+void Profiler::endZone()
+{
+	ThreadRing& ring = getThreadRing();
+	if (ring.depth == 0)
+	{
+		return;
+	}
+
+	--ring.depth;
+	if (ring.depth < MAX_ZONE_DEPTH)
+	{
+		Zone& zone = ring.openZones[ring.depth];
+		zone.end = now();
+
+		pushZone(ring, zone);
+	}
+}
+
+void Profiler::markFrame()
+{
+	uint64_t time = now();
+
+	std::lock_guard<std::mutex> lock(s_cpuFrames.mutex);
+	if (s_lastFrameMark != 0)
+	{
+		pushFrameTime(s_cpuFrames, time - s_lastFrameMark);
+	}
+	s_lastFrameMark = time;
+}
+
+FrameStats Profiler::getFrameStats()
+{
+	return computeFrameStats(s_cpuFrames);
+}
+
+void Profiler::recordGpuZone(const char* name, uint64_t start, uint64_t end)
+{
+	pushZone(getGpuRing(), { name, start, end, 0 });
+}
+
+void Profiler::recordGpuFrame(uint64_t duration)
+{
+	std::lock_guard<std::mutex> lock(s_gpuFrames.mutex);
+	pushFrameTime(s_gpuFrames, duration);
+}
+
+FrameStats Profiler::getGpuFrameStats()
+{
+	return computeFrameStats(s_gpuFrames);
+}
+
+void Profiler::recordInputLatency(uint64_t latency)
+{
+	std::lock_guard<std::mutex> lock(s_inputLatencies.mutex);
+	pushFrameTime(s_inputLatencies, latency);
+}
+
+FrameStats Profiler::getInputLatencyStats()
+{
+	return computeFrameStats(s_inputLatencies);
+}
+
+void Profiler::exportChromeTrace(const char* relativePath)
+{
+	std::ostringstream trace;
+	trace << "{\"traceEvents\":[";
+
+	bool isFirst = true;
+	{
+		std::lock_guard<std::mutex> lock(s_threadRingsMutex);
+		for (const std::unique_ptr<ThreadRing>& ring : getThreadRings())
+		{
+			if (ring->name != nullptr)
+			{
+				trace << (isFirst ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << ring->threadIndex
+					<< ",\"args\":{\"name\":\"" << ring->name << "\"}}";
+				isFirst = false;
+			}
+
+			uint64_t count = std::min<uint64_t>(ring->head, ZONES_PER_THREAD);
+			for (uint64_t i = ring->head - count; i < ring->head; ++i)
+			{
+				const Zone& zone = ring->zones[i % ZONES_PER_THREAD];
+
+				// Complete events, microseconds
+				trace << (isFirst ? "" : ",") << "\n{\"name\":\"" << zone.name
+					<< "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << ring->threadIndex
+					<< ",\"ts\":" << zone.start / 1000.0
+					<< ",\"dur\":" << (zone.end - zone.start) / 1000.0 << "}";
+				isFirst = false;
+			}
+		}
+	}
+
+	trace << "\n]}\n";
+
+	std::string traceString = trace.str();
+	FileReader::writeDataAtomic(relativePath, traceString.data(), traceString.size());
+}
+
+Profiler::ThreadRing& Profiler::getThreadRing()
+{
+	if (t_threadRing == nullptr)
+	{
+		t_threadRing = createThreadRing(nullptr);
+	}
+
+	return *static_cast<ThreadRing*>(t_threadRing);
+}
+
+Profiler::ThreadRing& Profiler::getGpuRing()
+{
+	static ThreadRing* gpuRing = createThreadRing("GPU");
+	return *gpuRing;
+}
+
+void Profiler::pushZone(ThreadRing& ring, const Zone& zone)
+{
+	ring.zones[ring.head % ZONES_PER_THREAD] = zone;
+	++ring.head;
+}
+
+Profiler::ThreadRing* Profiler::createThreadRing(const char* name)
+{
+	std::unique_ptr<ThreadRing> ring(new ThreadRing());
+	ring->zones.resize(ZONES_PER_THREAD);
+	ring->name = name;
+
+	std::lock_guard<std::mutex> lock(s_threadRingsMutex);
+	ring->threadIndex = (uint32_t)getThreadRings().size();
+	getThreadRings().push_back(std::move(ring));
+
+	return getThreadRings().back().get();
+}
+
+std::vector<std::unique_ptr<Profiler::ThreadRing>>& Profiler::getThreadRings()
+{
+	static std::vector<std::unique_ptr<ThreadRing>> threadRings;
+	return threadRings;
+}
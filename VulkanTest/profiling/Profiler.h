@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <memory>
+
+// Frame times over the last FRAME_HISTORY frames, in milliseconds
+struct FrameStats
+{
+	uint32_t frameCount = 0;
+
+	double mean = 0.0;
+	double p50 = 0.0;
+	double p95 = 0.0;
+	double p99 = 0.0;
+	double max = 0.0;
+};
+
+// Scoped CPU zones on steady_clock. Every thread writes its own ring of closed zones,
+// nothing is shared on the recording path besides a one time registration.
+class Profiler
+{
+public:
+	static const uint32_t ZONES_PER_THREAD = 1 << 16;
+	static const uint32_t FRAME_HISTORY = 4096;
+	static const uint32_t MAX_ZONE_DEPTH = 32;
+
+	// Nanoseconds since the first call
+	static uint64_t now();
+
+	// The name has to outlive the profiler, string literals only
+	static void beginZone(const char* name);
+	static void endZone();
+
+	// Closes a frame on the calling thread, its duration is the time since the previous mark
+	static void markFrame();
+	static FrameStats getFrameStats();
+
+	// Zones measured on the GPU, already converted to the now() time base
+	static void recordGpuZone(const char* name, uint64_t start, uint64_t end);
+	static void recordGpuFrame(uint64_t duration);
+	static FrameStats getGpuFrameStats();
+
+	// Input sampling to the GPU finishing the frame built from it
+	static void recordInputLatency(uint64_t latency);
+	static FrameStats getInputLatencyStats();
+
+	// Zones still in the rings, meant to be called once the recording threads are idle
+	static void exportChromeTrace(const char* relativePath);
+
+private:
+	Profiler();
+
+	struct Zone
+	{
+		const char* name;
+		uint64_t start;
+		uint64_t end;
+		uint32_t depth;
+	};
+
+	struct ThreadRing
+	{
+		uint32_t threadIndex = 0;
+		const char* name = nullptr;
+
+		std::vector<Zone> zones;
+		uint64_t head = 0;
+
+		Zone openZones[MAX_ZONE_DEPTH];
+		uint32_t depth = 0;
+	};
+
+	static ThreadRing& getThreadRing();
+	static ThreadRing& getGpuRing();
+	static void pushZone(ThreadRing& ring, const Zone& zone);
+	static ThreadRing* createThreadRing(const char* name);
+
+	// Rings outlive their threads, the trace can be exported after the workers are gone
+	static std::vector<std::unique_ptr<ThreadRing>>& getThreadRings();
+};
+
+class ProfileZone
+{
+public:
+	explicit ProfileZone(const char* name)
+	{
+		Profiler::beginZone(name);
+	}
+
+	~ProfileZone()
+	{
+		Profiler::endZone();
+	}
+
+	ProfileZone(const ProfileZone&) = delete;
+	ProfileZone& operator=(const ProfileZone&) = delete;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
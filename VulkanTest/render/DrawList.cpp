@@ -0,0 +1,78 @@
+#include "DrawList.h"
+
+DrawList::DrawList()
+{
+}
+
+void DrawList::clear()
+{
+	m_objects.clear();
+}
+
+void DrawList::add(const glm::mat4& model, uint32_t mesh)
+{
+	m_objects.push_back({ mesh, model });
+}
+
+void DrawList::buildBatches()
+{
+	m_batches.clear();
+	m_instances.resize(m_objects.size());
+
+	// Counting sort on the mesh, keeps the submission order inside a mesh
+	m_meshCounts.clear();
+	for (const DrawObject& object : m_objects)
+	{
+		if (object.mesh >= m_meshCounts.size())
+		{
+			m_meshCounts.resize(object.mesh + 1, 0);
+		}
+		++m_meshCounts[object.mesh];
+	}
+
+	uint32_t firstInstance = 0;
+	for (uint32_t mesh = 0; mesh < m_meshCounts.size(); ++mesh)
+	{
+		uint32_t instanceCount = m_meshCounts[mesh];
+		if (instanceCount == 0)
+		{
+			continue;
+		}
+
+		m_batches.push_back({ mesh, firstInstance, 0 });
+
+		// Reused as the write cursor of the mesh
+		m_meshCounts[mesh] = firstInstance;
+		firstInstance += instanceCount;
+	}
+
+	for (const DrawObject& object : m_objects)
+	{
+		m_instances[m_meshCounts[object.mesh]++] = object.model;
+	}
+
+	for (InstanceBatch& batch : m_batches)
+	{
+		batch.instanceCount = m_meshCounts[batch.mesh] - batch.firstInstance;
+	}
+}
+
+const std::vector<DrawObject>& DrawList::getObjects() const
+{
+	return m_objects;
+}
+
+const std::vector<glm::mat4>& DrawList::getInstances() const
+{
+	return m_instances;
+}
+
+const std::vector<InstanceBatch>& DrawList::getBatches() const
+{
+	return m_batches;
+}
+
+bool DrawList::isEmpty() const
+{
+	return m_objects.empty();
+}
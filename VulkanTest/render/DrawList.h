@@ -0,0 +1,72 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include "vulkan/vulkan.h"
+
+#include <vector>
+
+// Per instance vertex data, binding 1
+struct InstanceData
+{
+	glm::mat4 model;
+};
+
+// firstIndex counts from the start of the index buffer region holding indexType indices
+struct MeshRange
+{
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	int32_t vertexOffset;
+	VkIndexType indexType;
+
+	// Vertex buffer space center in xyz, radius in w
+	glm::vec4 boundingSphere;
+
+	// Vertex buffer positions to object space, folded into the model matrix of quantized meshes
+	bool isQuantized;
+	glm::mat4 dequantization;
+};
+
+struct DrawObject
+{
+	uint32_t mesh;
+	glm::mat4 model;
+};
+
+// Instances [firstInstance, firstInstance + instanceCount) of getInstances() all use the same mesh
+struct InstanceBatch
+{
+	uint32_t mesh;
+	uint32_t firstInstance;
+	uint32_t instanceCount;
+};
+
+// Objects visible this frame. Filled by the application before every Window::draw,
+// the frame's command buffer is recorded from it with one instanced draw per mesh.
+class DrawList
+{
+public:
+	DrawList();
+
+	void clear();
+	void add(const glm::mat4& model, uint32_t mesh = 0);
+
+	// Groups the objects by mesh, the instances of a batch end up contiguous
+	void buildBatches();
+
+	const std::vector<DrawObject>& getObjects() const;
+	const std::vector<glm::mat4>& getInstances() const;
+	const std::vector<InstanceBatch>& getBatches() const;
+
+	bool isEmpty() const;
+
+private:
+	std::vector<DrawObject> m_objects;
+
+	std::vector<glm::mat4> m_instances;
+	std::vector<InstanceBatch> m_batches;
+	std::vector<uint32_t> m_meshCounts;
+};
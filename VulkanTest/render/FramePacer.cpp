@@ -0,0 +1,126 @@
+#include "FramePacer.h"
+#include "../profiling/Profiler.h"
+
+#include <algorithm>
+#include <thread>
+
+// Sleeps overshoot by about a scheduler tick
+const std::chrono::microseconds SPIN_DURATION(1500);
+
+FramePacer::FramePacer() :
+	m_mode(PacingMode::THROUGHPUT),
+	m_maxFramesInFlight(1),
+
+	m_framePeriod(0)
+{
+}
+
+void FramePacer::init(uint32_t maxFramesInFlight)
+{
+	m_maxFramesInFlight = maxFramesInFlight;
+
+	m_inputTimes.assign(maxFramesInFlight, 0);
+	m_isLatencyPending.assign(maxFramesInFlight, false);
+}
+
+void FramePacer::setMode(PacingMode mode)
+{
+	m_mode = mode;
+}
+
+PacingMode FramePacer::getMode() const
+{
+	return m_mode;
+}
+
+uint32_t FramePacer::getFramesInFlight() const
+{
+	switch (m_mode)
+	{
+	case PacingMode::LOW_LATENCY:
+		return 1;
+	case PacingMode::VSYNC:
+		return std::min(2u, m_maxFramesInFlight);
+	default:
+		return m_maxFramesInFlight;
+	}
+}
+
+VkPresentModeKHR FramePacer::choosePresentMode(const std::vector<VkPresentModeKHR>& presentModes) const
+{
+	std::vector<VkPresentModeKHR> preferred;
+	switch (m_mode)
+	{
+	case PacingMode::LOW_LATENCY:
+	case PacingMode::THROUGHPUT:
+		preferred = { VK_PRESENT_MODE_MAILBOX_KHR };
+		break;
+	case PacingMode::UNCAPPED:
+		preferred = { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR };
+		break;
+	case PacingMode::VSYNC:
+		break;
+	}
+
+	for (VkPresentModeKHR presentMode : preferred)
+	{
+		if (std::find(presentModes.begin(), presentModes.end(), presentMode) != presentModes.end())
+		{
+			return presentMode;
+		}
+	}
+
+	// always avalible
+	return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+void FramePacer::setFrameLimit(double framesPerSecond)
+{
+	if (framesPerSecond <= 0.0)
+	{
+		m_framePeriod = std::chrono::steady_clock::duration(0);
+		return;
+	}
+
+	m_framePeriod = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / framesPerSecond));
+	m_nextFrameTime = std::chrono::steady_clock::now();
+}
+
+void FramePacer::waitForNextFrame()
+{
+	if (m_framePeriod.count() == 0)
+	{
+		return;
+	}
+
+	if (std::chrono::steady_clock::now() < m_nextFrameTime - SPIN_DURATION)
+	{
+		std::this_thread::sleep_until(m_nextFrameTime - SPIN_DURATION);
+	}
+
+	while (std::chrono::steady_clock::now() < m_nextFrameTime)
+	{
+		std::this_thread::yield();
+	}
+
+	// A late frame moves the schedule instead of bursting to catch up
+	m_nextFrameTime = std::max(m_nextFrameTime + m_framePeriod, std::chrono::steady_clock::now());
+}
+
+void FramePacer::markInput(uint32_t frameIndex, uint64_t inputTime)
+{
+	m_inputTimes[frameIndex] = inputTime;
+	m_isLatencyPending[frameIndex] = true;
+}
+
+void FramePacer::collectLatency(VkDevice logicalDevice, const std::vector<VkFence>& fences)
+{
+	for (uint32_t i = 0; i < m_maxFramesInFlight; ++i)
+	{
+		if (m_isLatencyPending[i] && vkGetFenceStatus(logicalDevice, fences[i]) == VK_SUCCESS)
+		{
+			Profiler::recordInputLatency(Profiler::now() - m_inputTimes[i]);
+			m_isLatencyPending[i] = false;
+		}
+	}
+}
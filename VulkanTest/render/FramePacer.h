@@ -0,0 +1,55 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <chrono>
+#include <vector>
+
+enum class PacingMode
+{
+	// One frame in flight, input is sampled once the previous frame is done
+	LOW_LATENCY,
+	// Every frame in flight, mailbox when available
+	THROUGHPUT,
+	// FIFO with two frames in flight
+	VSYNC,
+	// Immediate when available, every frame in flight
+	UNCAPPED
+};
+
+// Decides how far the CPU runs ahead of the display and measures what that costs:
+// the latency from the input a frame was built with to the GPU finishing it.
+class FramePacer
+{
+public:
+	FramePacer();
+
+	void init(uint32_t maxFramesInFlight);
+
+	void setMode(PacingMode mode);
+	PacingMode getMode() const;
+
+	uint32_t getFramesInFlight() const;
+	VkPresentModeKHR choosePresentMode(const std::vector<VkPresentModeKHR>& presentModes) const;
+
+	// 0 disables the limiter
+	void setFrameLimit(double framesPerSecond);
+	// Sleeps until the next frame is due, the last stretch is spun for accuracy
+	void waitForNextFrame();
+
+	// The frame in this slot is built from input sampled at inputTime, a Profiler::now() value
+	void markInput(uint32_t frameIndex, uint64_t inputTime);
+	// Records the latency of every pending frame whose fence has signaled
+	void collectLatency(VkDevice logicalDevice, const std::vector<VkFence>& fences);
+
+private:
+	PacingMode m_mode;
+	uint32_t m_maxFramesInFlight;
+
+	std::chrono::steady_clock::duration m_framePeriod;
+	std::chrono::steady_clock::time_point m_nextFrameTime;
+
+	std::vector<uint64_t> m_inputTimes;
+	std::vector<bool> m_isLatencyPending;
+};
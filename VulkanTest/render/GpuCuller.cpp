@@ -0,0 +1,364 @@
+#include "GpuCuller.h"
+#include "../VulkanException.h"
+
+#include <array>
+#include <cstring>
+
+GpuCuller::GpuCuller() :
+	m_logicalDevice(VK_NULL_HANDLE),
+	m_frameCount(0),
+
+	m_hasDrawIndirectCount(false),
+	m_hasMultiDrawIndirect(false),
+	m_cmdDrawIndexedIndirectCount(nullptr),
+
+	m_visibleRegionSize(0),
+	m_visibleBuffer(VK_NULL_HANDLE),
+
+	m_drawRegionSize(0),
+	m_drawBuffer(VK_NULL_HANDLE),
+
+	m_descriptorSetLayout(VK_NULL_HANDLE),
+	m_descriptorPool(VK_NULL_HANDLE),
+
+	m_pipelineLayout(VK_NULL_HANDLE),
+	m_pipeline(VK_NULL_HANDLE)
+{
+}
+
+void GpuCuller::init(
+	VkPhysicalDevice physicalDevice,
+	VkDevice logicalDevice,
+	DeviceAllocator& allocator,
+	VkPipelineCache pipelineCache,
+	VkShaderModule cullModule,
+	uint32_t frameCount,
+	bool hasDrawIndirectCount,
+	bool hasMultiDrawIndirect)
+{
+	m_logicalDevice = logicalDevice;
+	m_frameCount = frameCount;
+	m_hasMultiDrawIndirect = hasMultiDrawIndirect;
+
+	if (hasDrawIndirectCount)
+	{
+		m_cmdDrawIndexedIndirectCount = (PFN_vkCmdDrawIndexedIndirectCountKHR)vkGetDeviceProcAddr(m_logicalDevice, "vkCmdDrawIndexedIndirectCountKHR");
+	}
+	m_hasDrawIndirectCount = m_cmdDrawIndexedIndirectCount != nullptr;
+
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+	VkDeviceSize alignment = deviceProperties.limits.minStorageBufferOffsetAlignment;
+
+	// Each input is the only allocation of its frame region, descriptors can point at fixed offsets
+	m_instanceRing.init(m_logicalDevice, allocator, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		sizeof(CullInstance) * MAX_INSTANCES_PER_FRAME, m_frameCount, alignment);
+	m_batchRing.init(m_logicalDevice, allocator, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		sizeof(CullBatch) * MAX_DRAWS_PER_FRAME, m_frameCount, alignment);
+
+	m_visibleRegionSize = alignUp(sizeof(InstanceData) * MAX_INSTANCES_PER_FRAME, alignment);
+	createBuffer(m_visibleRegionSize * m_frameCount,
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		&m_visibleBuffer, &m_visibleMemory, allocator);
+
+	m_drawRegionSize = alignUp(DRAW_REGION_SIZE, alignment);
+	createBuffer(m_drawRegionSize * m_frameCount,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		&m_drawBuffer, &m_drawMemory, allocator);
+
+	createDescriptors();
+	createPipeline(pipelineCache, cullModule);
+}
+
+void GpuCuller::destroy(DeviceAllocator& allocator)
+{
+	vkDestroyPipeline(m_logicalDevice, m_pipeline, nullptr);
+	vkDestroyPipelineLayout(m_logicalDevice, m_pipelineLayout, nullptr);
+
+	vkDestroyDescriptorPool(m_logicalDevice, m_descriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(m_logicalDevice, m_descriptorSetLayout, nullptr);
+
+	vkDestroyBuffer(m_logicalDevice, m_drawBuffer, nullptr);
+	allocator.free(m_drawMemory);
+
+	vkDestroyBuffer(m_logicalDevice, m_visibleBuffer, nullptr);
+	allocator.free(m_visibleMemory);
+
+	m_batchRing.destroy(allocator);
+	m_instanceRing.destroy(allocator);
+}
+
+void GpuCuller::recordCulling(VkCommandBuffer commandBuffer, uint32_t frameIndex, const DrawList& drawList, const std::vector<MeshRange>& meshes, const glm::mat4& viewProjection)
+{
+	const std::vector<glm::mat4>& instances = drawList.getInstances();
+	const std::vector<InstanceBatch>& batches = drawList.getBatches();
+
+	if (instances.size() > MAX_INSTANCES_PER_FRAME || batches.size() > MAX_DRAWS_PER_FRAME)
+	{
+		throw VulkanException("Too many instances to cull.");
+	}
+
+	m_instanceRing.beginFrame(frameIndex);
+	m_batchRing.beginFrame(frameIndex);
+
+	uint32_t offset;
+	CullInstance* cullInstances = static_cast<CullInstance*>(m_instanceRing.allocate(sizeof(CullInstance) * std::max<size_t>(instances.size(), 1), &offset));
+	CullBatch* cullBatches = static_cast<CullBatch*>(m_batchRing.allocate(sizeof(CullBatch) * std::max<size_t>(batches.size(), 1), &offset));
+
+	for (uint32_t i = 0; i < batches.size(); ++i)
+	{
+		const InstanceBatch& batch = batches[i];
+		const MeshRange& mesh = meshes[batch.mesh];
+
+		CullBatch& cullBatch = cullBatches[i];
+		cullBatch.boundingSphere = mesh.boundingSphere;
+		cullBatch.indexCount = mesh.indexCount;
+		cullBatch.firstIndex = mesh.firstIndex;
+		cullBatch.vertexOffset = mesh.vertexOffset;
+		cullBatch.firstInstance = batch.firstInstance;
+
+		for (uint32_t j = batch.firstInstance; j < batch.firstInstance + batch.instanceCount; ++j)
+		{
+			cullInstances[j].model = mesh.isQuantized ? instances[j] * mesh.dequantization : instances[j];
+			cullInstances[j].batch = i;
+		}
+	}
+
+	VkDeviceSize drawOffset = m_drawRegionSize * frameIndex;
+
+	// Counters start at zero, commands of culled batches are fully overwritten by the emit pass
+	vkCmdFillBuffer(commandBuffer, m_drawBuffer, drawOffset + DRAW_COUNT_OFFSET, sizeof(uint32_t), 0);
+	vkCmdFillBuffer(commandBuffer, m_drawBuffer, drawOffset + BATCH_COUNTS_OFFSET, MAX_DRAWS_PER_FRAME * sizeof(uint32_t), 0);
+
+	VkMemoryBarrier memoryBarrier = {};
+	memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &m_descriptorSets[frameIndex], 0, nullptr);
+
+	CullConstants constants = {};
+	extractFrustumPlanes(viewProjection, constants.planes);
+	constants.instanceCount = static_cast<uint32_t>(instances.size());
+	constants.batchCount = static_cast<uint32_t>(batches.size());
+	constants.isCompacted = m_hasDrawIndirectCount ? 1 : 0;
+
+	// Pass 0 culls the instances and counts them per batch
+	constants.pass = 0;
+	vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+	vkCmdDispatch(commandBuffer, (constants.instanceCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+
+	memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+	// Pass 1 writes a draw command per batch
+	constants.pass = 1;
+	vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+	vkCmdDispatch(commandBuffer, (constants.batchCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+
+	memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	memoryBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+		0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+}
+
+void GpuCuller::recordDraws(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t firstBatch, uint32_t endBatch) const
+{
+	if (endBatch <= firstBatch)
+	{
+		return;
+	}
+
+	const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+	VkDeviceSize commandsOffset = m_drawRegionSize * frameIndex + DRAW_COMMANDS_OFFSET;
+
+	if (m_hasDrawIndirectCount)
+	{
+		// Compacted, the GPU knows how many batches survived
+		m_cmdDrawIndexedIndirectCount(commandBuffer,
+			m_drawBuffer, commandsOffset,
+			m_drawBuffer, m_drawRegionSize * frameIndex + DRAW_COUNT_OFFSET,
+			endBatch, stride);
+	}
+	else if (m_hasMultiDrawIndirect)
+	{
+		vkCmdDrawIndexedIndirect(commandBuffer, m_drawBuffer, commandsOffset + firstBatch * stride, endBatch - firstBatch, stride);
+	}
+	else
+	{
+		for (uint32_t i = firstBatch; i < endBatch; ++i)
+		{
+			vkCmdDrawIndexedIndirect(commandBuffer, m_drawBuffer, commandsOffset + i * stride, 1, stride);
+		}
+	}
+}
+
+VkBuffer GpuCuller::getInstanceBuffer() const
+{
+	return m_visibleBuffer;
+}
+
+VkDeviceSize GpuCuller::getInstanceOffset(uint32_t frameIndex) const
+{
+	return m_visibleRegionSize * frameIndex;
+}
+
+bool GpuCuller::canSplitDraws() const
+{
+	return !m_hasDrawIndirectCount;
+}
+
+void GpuCuller::createBuffer(VkDeviceSize size, VkBufferUsageFlags usageFlags, VkBuffer* buffer, DeviceAllocation* memory, DeviceAllocator& allocator)
+{
+	VkBufferCreateInfo bufferCreateInfo = {};
+	bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferCreateInfo.size = size;
+	bufferCreateInfo.usage = usageFlags;
+	bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateBuffer(m_logicalDevice, &bufferCreateInfo, nullptr, buffer) != VK_SUCCESS)
+	{
+		throw VulkanException("Failed to create culling buffer.");
+	}
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetBufferMemoryRequirements(m_logicalDevice, *buffer, &memoryRequirements);
+
+	*memory = allocator.allocate(memoryRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, ResourceType::BUFFER);
+	vkBindBufferMemory(m_logicalDevice, *buffer, memory->memory, memory->offset);
+}
+
+void GpuCuller::createDescriptors()
+{
+	// 0: instances, 1: batches, 2: visible instances, 3: draw commands and counters
+	std::array<VkDescriptorSetLayoutBinding, 4> bindings = {};
+	for (uint32_t i = 0; i < bindings.size(); ++i)
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {};
+	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutCreateInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutCreateInfo.pBindings = bindings.data();
+
+	if (vkCreateDescriptorSetLayout(m_logicalDevice, &layoutCreateInfo, nullptr, &m_descriptorSetLayout) != VK_SUCCESS)
+	{
+		throw VulkanException("Failed to create culling descriptor set layout.");
+	}
+
+	VkDescriptorPoolSize poolSize = {};
+	poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSize.descriptorCount = static_cast<uint32_t>(bindings.size()) * m_frameCount;
+
+	VkDescriptorPoolCreateInfo poolCreateInfo = {};
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolCreateInfo.poolSizeCount = 1;
+	poolCreateInfo.pPoolSizes = &poolSize;
+	poolCreateInfo.maxSets = m_frameCount;
+
+	if (vkCreateDescriptorPool(m_logicalDevice, &poolCreateInfo, nullptr, &m_descriptorPool) != VK_SUCCESS)
+	{
+		throw VulkanException("Failed to create culling descriptor pool.");
+	}
+
+	std::vector<VkDescriptorSetLayout> layouts(m_frameCount, m_descriptorSetLayout);
+
+	VkDescriptorSetAllocateInfo allocateInfo = {};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocateInfo.descriptorPool = m_descriptorPool;
+	allocateInfo.descriptorSetCount = m_frameCount;
+	allocateInfo.pSetLayouts = layouts.data();
+
+	m_descriptorSets.resize(m_frameCount);
+	if (vkAllocateDescriptorSets(m_logicalDevice, &allocateInfo, m_descriptorSets.data()) != VK_SUCCESS)
+	{
+		throw VulkanException("Failed to allocate culling descriptor sets.");
+	}
+
+	for (uint32_t frame = 0; frame < m_frameCount; ++frame)
+	{
+		std::array<VkDescriptorBufferInfo, 4> bufferInfos = {};
+		bufferInfos[0] = { m_instanceRing.getBuffer(), m_instanceRing.getFrameOffset(frame), m_instanceRing.getFrameSize() };
+		bufferInfos[1] = { m_batchRing.getBuffer(), m_batchRing.getFrameOffset(frame), m_batchRing.getFrameSize() };
+		bufferInfos[2] = { m_visibleBuffer, m_visibleRegionSize * frame, m_visibleRegionSize };
+		bufferInfos[3] = { m_drawBuffer, m_drawRegionSize * frame, DRAW_REGION_SIZE };
+
+		std::array<VkWriteDescriptorSet, 4> writes = {};
+		for (uint32_t i = 0; i < writes.size(); ++i)
+		{
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = m_descriptorSets[frame];
+			writes[i].dstBinding = i;
+			writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writes[i].descriptorCount = 1;
+			writes[i].pBufferInfo = &bufferInfos[i];
+		}
+
+		vkUpdateDescriptorSets(m_logicalDevice, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+	}
+}
+
+void GpuCuller::createPipeline(VkPipelineCache pipelineCache, VkShaderModule cullModule)
+{
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(CullConstants);
+
+	VkPipelineLayoutCreateInfo layoutCreateInfo = {};
+	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutCreateInfo.setLayoutCount = 1;
+	layoutCreateInfo.pSetLayouts = &m_descriptorSetLayout;
+	layoutCreateInfo.pushConstantRangeCount = 1;
+	layoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(m_logicalDevice, &layoutCreateInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS)
+	{
+		throw VulkanException("Failed to create culling pipeline layout.");
+	}
+
+	VkComputePipelineCreateInfo pipelineCreateInfo = {};
+	pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineCreateInfo.stage.module = cullModule;
+	pipelineCreateInfo.stage.pName = "main";
+	pipelineCreateInfo.layout = m_pipelineLayout;
+
+	if (vkCreateComputePipelines(m_logicalDevice, pipelineCache, 1, &pipelineCreateInfo, nullptr, &m_pipeline) != VK_SUCCESS)
+	{
+		throw VulkanException("Failed to create culling pipeline.");
+	}
+}
+
+void GpuCuller::extractFrustumPlanes(const glm::mat4& viewProjection, glm::vec4* planes)
+{
+	// Rows of the matrix, glm is column major
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; ++i)
+	{
+		rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+	}
+
+	// Left, right, bottom, top, near and far for a [0, 1] depth range
+	planes[0] = rows[3] + rows[0];
+	planes[1] = rows[3] - rows[0];
+	planes[2] = rows[3] + rows[1];
+	planes[3] = rows[3] - rows[1];
+	planes[4] = rows[2];
+	planes[5] = rows[3] - rows[2];
+
+	for (int i = 0; i < 6; ++i)
+	{
+		planes[i] /= glm::length(glm::vec3(planes[i]));
+	}
+}
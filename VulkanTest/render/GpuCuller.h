@@ -0,0 +1,109 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "DrawList.h"
+#include "../memory/FrameRingBuffer.h"
+
+// Frustum culls the draw list in a compute pass and writes the indirect draw commands.
+// The visible instances of a batch are compacted in place of the batch's instance range.
+class GpuCuller
+{
+public:
+	static const uint32_t MAX_DRAWS_PER_FRAME = 1024;
+	static const uint32_t MAX_INSTANCES_PER_FRAME = 65536;
+
+	GpuCuller();
+
+	// hasDrawIndirectCount compacts the draws and emits a draw count, otherwise empty draws stay in place
+	void init(
+		VkPhysicalDevice physicalDevice,
+		VkDevice logicalDevice,
+		DeviceAllocator& allocator,
+		VkPipelineCache pipelineCache,
+		VkShaderModule cullModule,
+		uint32_t frameCount,
+		bool hasDrawIndirectCount,
+		bool hasMultiDrawIndirect);
+	void destroy(DeviceAllocator& allocator);
+
+	// Outside of a render pass, before the draws that consume the results
+	void recordCulling(VkCommandBuffer commandBuffer, uint32_t frameIndex, const DrawList& drawList, const std::vector<MeshRange>& meshes, const glm::mat4& viewProjection);
+
+	// Draws the batches [firstBatch, endBatch) of the last culled draw list
+	void recordDraws(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t firstBatch, uint32_t endBatch) const;
+
+	// Visible instances, to bind at the instance rate binding
+	VkBuffer getInstanceBuffer() const;
+	VkDeviceSize getInstanceOffset(uint32_t frameIndex) const;
+
+	// A draw count can only be consumed as a whole
+	bool canSplitDraws() const;
+
+private:
+	struct CullInstance
+	{
+		glm::mat4 model;
+		uint32_t batch;
+		uint32_t padding[3];
+	};
+
+	struct CullBatch
+	{
+		glm::vec4 boundingSphere;
+		uint32_t indexCount;
+		uint32_t firstIndex;
+		int32_t vertexOffset;
+		uint32_t firstInstance;
+	};
+
+	struct CullConstants
+	{
+		glm::vec4 planes[6];
+		uint32_t instanceCount;
+		uint32_t batchCount;
+		uint32_t pass;
+		uint32_t isCompacted;
+	};
+
+	// Layout of a frame's region of the draw buffer, matches cull.comp
+	static const VkDeviceSize DRAW_COUNT_OFFSET = 0;
+	static const VkDeviceSize DRAW_COMMANDS_OFFSET = 16;
+	static const VkDeviceSize BATCH_COUNTS_OFFSET = DRAW_COMMANDS_OFFSET + MAX_DRAWS_PER_FRAME * sizeof(VkDrawIndexedIndirectCommand);
+	static const VkDeviceSize DRAW_REGION_SIZE = BATCH_COUNTS_OFFSET + MAX_DRAWS_PER_FRAME * sizeof(uint32_t);
+
+	static const uint32_t WORKGROUP_SIZE = 64;
+
+	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usageFlags, VkBuffer* buffer, DeviceAllocation* memory, DeviceAllocator& allocator);
+	void createDescriptors();
+	void createPipeline(VkPipelineCache pipelineCache, VkShaderModule cullModule);
+
+	static void extractFrustumPlanes(const glm::mat4& viewProjection, glm::vec4* planes);
+
+private:
+	VkDevice m_logicalDevice;
+	uint32_t m_frameCount;
+
+	bool m_hasDrawIndirectCount;
+	bool m_hasMultiDrawIndirect;
+	PFN_vkCmdDrawIndexedIndirectCountKHR m_cmdDrawIndexedIndirectCount;
+
+	FrameRingBuffer m_instanceRing;
+	FrameRingBuffer m_batchRing;
+
+	VkDeviceSize m_visibleRegionSize;
+	VkBuffer m_visibleBuffer;
+	DeviceAllocation m_visibleMemory;
+
+	VkDeviceSize m_drawRegionSize;
+	VkBuffer m_drawBuffer;
+	DeviceAllocation m_drawMemory;
+
+	VkDescriptorSetLayout m_descriptorSetLayout;
+	VkDescriptorPool m_descriptorPool;
+	std::vector<VkDescriptorSet> m_descriptorSets;
+
+	VkPipelineLayout m_pipelineLayout;
+	VkPipeline m_pipeline;
+};
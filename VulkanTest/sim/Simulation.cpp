@@ -0,0 +1,114 @@
+#include "Simulation.h"
+#include "../profiling/Profiler.h"
+
+#include <chrono>
+
+// Ticks this far behind are dropped instead of being caught up
+const uint32_t MAX_TICK_BACKLOG = 5;
+
+Simulation::Simulation(float width, float height, double tickRate) :
+	m_camera(width, height),
+
+	m_tickPeriod(1.0 / tickRate),
+	m_tick(0),
+
+	m_lastCursorX(0.0),
+	m_lastCursorY(0.0),
+	m_wasRotating(false),
+
+	m_isRunning(false)
+{
+}
+
+void Simulation::setSceneUpdate(const SceneUpdate& sceneUpdate)
+{
+	m_sceneUpdate = sceneUpdate;
+}
+
+void Simulation::start()
+{
+	tick();
+
+	m_isRunning = true;
+	m_thread = std::thread(&Simulation::run, this);
+}
+
+void Simulation::stop()
+{
+	m_isRunning = false;
+	if (m_thread.joinable())
+	{
+		m_thread.join();
+	}
+}
+
+InputState& Simulation::getInput()
+{
+	return m_input;
+}
+
+FrameSnapshot& Simulation::acquireSnapshot()
+{
+	m_snapshots.update();
+	return m_snapshots.getReadBuffer();
+}
+
+void Simulation::run()
+{
+	typedef std::chrono::steady_clock Clock;
+
+	Clock::duration tickDuration = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(m_tickPeriod));
+	Clock::time_point nextTick = Clock::now() + tickDuration;
+
+	while (m_isRunning)
+	{
+		std::this_thread::sleep_until(nextTick);
+
+		tick();
+
+		nextTick += tickDuration;
+		if (Clock::now() > nextTick + tickDuration * MAX_TICK_BACKLOG)
+		{
+			nextTick = Clock::now() + tickDuration;
+		}
+	}
+}
+
+void Simulation::tick()
+{
+	PROFILE_ZONE("simulation tick");
+
+	FrameSnapshot& snapshot = m_snapshots.getWriteBuffer();
+	snapshot.inputTime = Profiler::now();
+
+	applyInput();
+
+	snapshot.drawList.clear();
+	if (m_sceneUpdate)
+	{
+		m_sceneUpdate(snapshot.drawList, m_tickPeriod);
+	}
+
+	snapshot.view = m_camera.getView();
+	snapshot.projection = m_camera.getProjection();
+	snapshot.tick = m_tick++;
+
+	m_snapshots.publish();
+}
+
+void Simulation::applyInput()
+{
+	double cursorX = m_input.cursorX.load(std::memory_order_relaxed);
+	double cursorY = m_input.cursorY.load(std::memory_order_relaxed);
+	bool isRotating = m_input.isRotating.load(std::memory_order_relaxed);
+
+	if (isRotating && m_wasRotating)
+	{
+		float force = 0.005f;
+		m_camera.rotate(force * (float)(cursorX - m_lastCursorX), force * (float)(cursorY - m_lastCursorY));
+	}
+
+	m_wasRotating = isRotating;
+	m_lastCursorX = cursorX;
+	m_lastCursorY = cursorY;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "TripleBuffer.h"
+#include "../camera/FocusedCamera.h"
+#include "../render/DrawList.h"
+
+#include <atomic>
+#include <functional>
+#include <thread>
+
+// Written by the GLFW callbacks on the main thread, read by the simulation thread
+struct InputState
+{
+	std::atomic<double> cursorX;
+	std::atomic<double> cursorY;
+	std::atomic<bool> isRotating;
+
+	InputState() :
+		cursorX(0.0),
+		cursorY(0.0),
+		isRotating(false)
+	{
+	}
+};
+
+// Everything the render thread needs from one simulation tick
+struct FrameSnapshot
+{
+	glm::mat4 view = glm::mat4(1);
+	glm::mat4 projection = glm::mat4(1);
+
+	DrawList drawList;
+
+	uint64_t tick = 0;
+
+	// Profiler::now() when the tick sampled its input
+	uint64_t inputTime = 0;
+};
+
+// Fills the draw list of a tick, deltaTime is the fixed tick period in seconds
+typedef std::function<void(DrawList& drawList, double deltaTime)> SceneUpdate;
+
+// Runs input handling, the camera and the scene update on its own thread at a fixed tick rate,
+// each tick is published to the render thread as a snapshot.
+class Simulation
+{
+public:
+	Simulation(float width, float height, double tickRate = 120.0);
+
+	void setSceneUpdate(const SceneUpdate& sceneUpdate);
+
+	// Runs the first tick on the calling thread, a snapshot is available once it returns
+	void start();
+	void stop();
+
+	InputState& getInput();
+
+	// Render thread, the latest published tick. Stays valid until the next call
+	FrameSnapshot& acquireSnapshot();
+
+private:
+	void run();
+	void tick();
+	void applyInput();
+
+private:
+	FocusedCamera m_camera;
+	SceneUpdate m_sceneUpdate;
+
+	double m_tickPeriod;
+	uint64_t m_tick;
+
+	InputState m_input;
+	double m_lastCursorX;
+	double m_lastCursorY;
+	bool m_wasRotating;
+
+	TripleBuffer<FrameSnapshot> m_snapshots;
+
+	std::atomic<bool> m_isRunning;
+	std::thread m_thread;
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Single writer, single reader. The writer fills its back buffer and publishes it by swapping it
+// with the middle one, the reader swaps its front buffer with the middle one when it is newer.
+// Neither side ever waits, the reader always sees the latest complete value.
+template<typename T>
+class TripleBuffer
+{
+public:
+	TripleBuffer() :
+		m_middle(1),
+		m_back(0),
+		m_front(2)
+	{
+	}
+
+	// Writer thread
+	T& getWriteBuffer()
+	{
+		return m_buffers[m_back];
+	}
+
+	void publish()
+	{
+		uint8_t middle = m_middle.exchange((uint8_t)(m_back | NEW_BIT), std::memory_order_acq_rel);
+		m_back = middle & INDEX_MASK;
+	}
+
+	// Reader thread, false when nothing was published since the last call
+	bool update()
+	{
+		if ((m_middle.load(std::memory_order_relaxed) & NEW_BIT) == 0)
+		{
+			return false;
+		}
+
+		uint8_t middle = m_middle.exchange(m_front, std::memory_order_acq_rel);
+		m_front = middle & INDEX_MASK;
+
+		return true;
+	}
+
+	T& getReadBuffer()
+	{
+		return m_buffers[m_front];
+	}
+
+private:
+	static const uint8_t INDEX_MASK = 0x3;
+	static const uint8_t NEW_BIT = 0x4;
+
+	std::array<T, 3> m_buffers;
+
+	// Index of the middle buffer, with NEW_BIT until the reader takes it
+	std::atomic<uint8_t> m_middle;
+
+	uint8_t m_back;
+	uint8_t m_front;
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Packed archive layout: header, entries sorted by path hash, path names, then the blobs each
+// aligned to blobAlignment. Entries are either stored as is or LZ4 block compressed.
+
+const uint32_t ARCHIVE_MAGIC = 0x4B415056; // "VPAK"
+const uint32_t ARCHIVE_VERSION = 1;
+
+enum class ArchiveCompression : uint32_t
+{
+	NONE = 0,
+	LZ4 = 1
+};
+
+struct ArchiveHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t entryCount;
+	uint32_t blobAlignment;
+
+	uint64_t entriesOffset;
+	uint64_t namesOffset;
+	uint64_t namesSize;
+};
+
+struct ArchiveEntry
+{
+	uint64_t pathHash;
+
+	uint64_t offset;
+	uint64_t storedSize;
+	uint64_t size;
+
+	uint32_t nameOffset;
+	uint32_t nameLength;
+	uint32_t compression;
+	uint32_t reserved;
+};
+
+// FNV-1a over the normalized path
+inline uint64_t hashArchivePath(const std::string& path)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (char c : path)
+	{
+		hash ^= (uint8_t)c;
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
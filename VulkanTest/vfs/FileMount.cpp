@@ -0,0 +1,97 @@
+#include "FileMount.h"
+
+#ifdef _WIN32
+	#include <io.h>
+
+	#define access _access_s
+#else
+	#include <unistd.h>
+#endif // _WIN32
+
+/////////////////////////
+////// DIRECTORY ////////
+/////////////////////////
+
+DirectoryMount::DirectoryMount(const std::string& rootPath) :
+	m_rootPath(rootPath)
+{
+	if (!m_rootPath.empty() && m_rootPath.back() != '/' && m_rootPath.back() != '\\')
+	{
+		m_rootPath += '/';
+	}
+}
+
+bool DirectoryMount::exists(const std::string& path) const
+{
+	return access((m_rootPath + path).c_str(), 0) == 0;
+}
+
+bool DirectoryMount::open(const std::string& path, MappedFile::AccessHint hint, FileView& view) const
+{
+	std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+	if (!file->open(m_rootPath + path, hint))
+	{
+		return false;
+	}
+
+	view = FileView(file, file->data(), file->size());
+	return true;
+}
+
+
+
+//////////////////////
+////// MEMORY ////////
+//////////////////////
+
+void MemoryMount::add(const std::string& path, std::vector<char> data)
+{
+	m_files[path] = std::make_shared<const std::vector<char>>(std::move(data));
+}
+
+bool MemoryMount::exists(const std::string& path) const
+{
+	return m_files.find(path) != m_files.end();
+}
+
+bool MemoryMount::open(const std::string& path, MappedFile::AccessHint /*hint*/, FileView& view) const
+{
+	auto file = m_files.find(path);
+	if (file == m_files.end())
+	{
+		return false;
+	}
+
+	view = FileView(file->second, file->second->data(), file->second->size());
+	return true;
+}
+
+
+
+///////////////////////
+////// ARCHIVE ////////
+///////////////////////
+
+ArchiveMount::ArchiveMount(std::shared_ptr<PackedArchive> archive) :
+	m_archive(std::move(archive))
+{
+}
+
+bool ArchiveMount::exists(const std::string& path) const
+{
+	return m_archive->find(path) != nullptr;
+}
+
+bool ArchiveMount::open(const std::string& path, MappedFile::AccessHint hint, FileView& view) const
+{
+	const ArchiveEntry* entry = m_archive->find(path);
+	if (entry == nullptr)
+	{
+		return false;
+	}
+
+	// The archive is mapped for random access, the hint applies to this entry's range
+	m_archive->advise(*entry, hint);
+	view = m_archive->read(*entry);
+	return true;
+}
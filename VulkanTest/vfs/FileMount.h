@@ -0,0 +1,58 @@
+#pragma once
+
+#include "FileView.h"
+#include "PackedArchive.h"
+#include "../MappedFile.h"
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+// Source of files mounted into the VirtualFileSystem, paths are relative to the mount point
+class FileMount
+{
+public:
+	virtual ~FileMount() = default;
+
+	virtual bool exists(const std::string& path) const = 0;
+	virtual bool open(const std::string& path, MappedFile::AccessHint hint, FileView& view) const = 0;
+};
+
+// Loose files under a directory, opened as mappings
+class DirectoryMount : public FileMount
+{
+public:
+	DirectoryMount(const std::string& rootPath);
+
+	bool exists(const std::string& path) const override;
+	bool open(const std::string& path, MappedFile::AccessHint hint, FileView& view) const override;
+
+private:
+	std::string m_rootPath;
+};
+
+// Files kept in memory, for generated data and tests. Not thread safe while files are added.
+class MemoryMount : public FileMount
+{
+public:
+	void add(const std::string& path, std::vector<char> data);
+
+	bool exists(const std::string& path) const override;
+	bool open(const std::string& path, MappedFile::AccessHint hint, FileView& view) const override;
+
+private:
+	std::unordered_map<std::string, std::shared_ptr<const std::vector<char>>> m_files;
+};
+
+// Entries of a packed archive, paths are the names the archive was built with
+class ArchiveMount : public FileMount
+{
+public:
+	ArchiveMount(std::shared_ptr<PackedArchive> archive);
+
+	bool exists(const std::string& path) const override;
+	bool open(const std::string& path, MappedFile::AccessHint hint, FileView& view) const override;
+
+private:
+	std::shared_ptr<PackedArchive> m_archive;
+};
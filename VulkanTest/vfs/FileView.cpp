@@ -0,0 +1,32 @@
+#include "FileView.h"
+
+#include <algorithm>
+
+FileView::FileView() :
+	m_data(nullptr),
+	m_size(0)
+{
+}
+
+FileView::FileView(std::shared_ptr<const void> owner, const char* data, size_t size) :
+	m_owner(std::move(owner)),
+	m_data(data),
+	m_size(size)
+{
+}
+
+FileView FileView::slice(size_t offset, size_t size) const
+{
+	offset = std::min(offset, m_size);
+	return FileView(m_owner, m_data + offset, std::min(size, m_size - offset));
+}
+
+const char* FileView::data() const
+{
+	return m_data;
+}
+
+size_t FileView::size() const
+{
+	return m_size;
+}
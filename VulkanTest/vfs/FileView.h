@@ -0,0 +1,24 @@
+#pragma once
+
+#include <memory>
+#include <cstddef>
+
+// Read only bytes of a file. Whatever backs them, a mapping, an archive or a memory buffer,
+// is released with the last view referencing it.
+class FileView
+{
+public:
+	FileView();
+	FileView(std::shared_ptr<const void> owner, const char* data, size_t size);
+
+	// Shares the owner, clamped to the view
+	FileView slice(size_t offset, size_t size) const;
+
+	const char* data() const;
+	size_t size() const;
+
+private:
+	std::shared_ptr<const void> m_owner;
+	const char* m_data;
+	size_t m_size;
+};
@@ -0,0 +1,203 @@
+#include "Lz4.h"
+
+#include <cstring>
+
+const size_t MIN_MATCH = 4;
+const size_t LAST_LITERALS = 5;
+const size_t MATCH_FIND_LIMIT = 12;
+const size_t MAX_OFFSET = 65535;
+
+const uint32_t HASH_BITS = 16;
+
+static uint32_t read32(const uint8_t* p)
+{
+	uint32_t value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+static uint32_t hashSequence(uint32_t sequence)
+{
+	return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+static void writeLength(std::vector<uint8_t>& dst, size_t length)
+{
+	while (length >= 255)
+	{
+		dst.push_back(255);
+		length -= 255;
+	}
+	dst.push_back((uint8_t)length);
+}
+
+static void writeSequence(std::vector<uint8_t>& dst, const uint8_t* literals, size_t literalLength, size_t offset, size_t matchLength)
+{
+	size_t matchCode = matchLength >= MIN_MATCH ? matchLength - MIN_MATCH : 0;
+
+	uint8_t token = (uint8_t)(((literalLength < 15 ? literalLength : 15) << 4) | (matchCode < 15 ? matchCode : 15));
+	dst.push_back(token);
+
+	if (literalLength >= 15)
+	{
+		writeLength(dst, literalLength - 15);
+	}
+	dst.insert(dst.end(), literals, literals + literalLength);
+
+	// The last sequence carries literals only
+	if (matchLength == 0)
+	{
+		return;
+	}
+
+	dst.push_back((uint8_t)(offset & 0xFF));
+	dst.push_back((uint8_t)(offset >> 8));
+
+	if (matchCode >= 15)
+	{
+		writeLength(dst, matchCode - 15);
+	}
+}
+
+std::vector<uint8_t> lz4Compress(const uint8_t* src, size_t srcSize)
+{
+	std::vector<uint8_t> dst;
+	dst.reserve(srcSize);
+
+	std::vector<uint32_t> table((size_t)1 << HASH_BITS, UINT32_MAX);
+
+	size_t anchor = 0;
+	size_t position = 0;
+
+	if (srcSize >= MATCH_FIND_LIMIT + 1)
+	{
+		size_t matchLimit = srcSize - LAST_LITERALS;
+		size_t searchLimit = srcSize - MATCH_FIND_LIMIT;
+
+		while (position <= searchLimit)
+		{
+			uint32_t sequence = read32(src + position);
+			uint32_t hash = hashSequence(sequence);
+			uint32_t candidate = table[hash];
+			table[hash] = (uint32_t)position;
+
+			if (candidate == UINT32_MAX || position - candidate > MAX_OFFSET || read32(src + candidate) != sequence)
+			{
+				++position;
+				continue;
+			}
+
+			// Extend backwards over pending literals, then forwards up to the trailing literals
+			while (position > anchor && candidate > 0 && src[position - 1] == src[candidate - 1])
+			{
+				--position;
+				--candidate;
+			}
+
+			size_t matchLength = MIN_MATCH;
+			while (position + matchLength < matchLimit && src[position + matchLength] == src[candidate + matchLength])
+			{
+				++matchLength;
+			}
+
+			writeSequence(dst, src + anchor, position - anchor, position - candidate, matchLength);
+
+			position += matchLength;
+			anchor = position;
+		}
+	}
+
+	writeSequence(dst, src + anchor, srcSize - anchor, 0, 0);
+
+	if (dst.size() >= srcSize)
+	{
+		dst.clear();
+	}
+
+	return dst;
+}
+
+bool lz4Decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize)
+{
+	const uint8_t* in = src;
+	const uint8_t* inEnd = src + srcSize;
+	size_t out = 0;
+
+	while (in < inEnd)
+	{
+		uint8_t token = *in++;
+
+		size_t literalLength = token >> 4;
+		if (literalLength == 15)
+		{
+			uint8_t byte;
+			do
+			{
+				if (in >= inEnd)
+				{
+					return false;
+				}
+				byte = *in++;
+				literalLength += byte;
+			} while (byte == 255);
+		}
+
+		if (literalLength > (size_t)(inEnd - in) || literalLength > dstSize - out)
+		{
+			return false;
+		}
+
+		memcpy(dst + out, in, literalLength);
+		in += literalLength;
+		out += literalLength;
+
+		if (in == inEnd)
+		{
+			break;
+		}
+
+		if (inEnd - in < 2)
+		{
+			return false;
+		}
+
+		size_t offset = in[0] | (in[1] << 8);
+		in += 2;
+
+		if (offset == 0 || offset > out)
+		{
+			return false;
+		}
+
+		size_t matchLength = token & 15;
+		if (matchLength == 15)
+		{
+			uint8_t byte;
+			do
+			{
+				if (in >= inEnd)
+				{
+					return false;
+				}
+				byte = *in++;
+				matchLength += byte;
+			} while (byte == 255);
+		}
+		matchLength += MIN_MATCH;
+
+		if (matchLength > dstSize - out)
+		{
+			return false;
+		}
+
+		// Overlapping matches repeat the pattern, so copy byte by byte
+		const uint8_t* match = dst + out - offset;
+		for (size_t i = 0; i < matchLength; ++i)
+		{
+			dst[out + i] = match[i];
+		}
+		out += matchLength;
+	}
+
+	return out == dstSize;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// LZ4 block format, without the frame header or checksums
+
+// Greedy single pass compressor, empty when the input doesn't shrink
+std::vector<uint8_t> lz4Compress(const uint8_t* src, size_t srcSize);
+
+// False unless src decodes to exactly dstSize bytes without reading or writing out of bounds
+bool lz4Decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize);
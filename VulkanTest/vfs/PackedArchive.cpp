@@ -0,0 +1,119 @@
+#include "PackedArchive.h"
+#include "Lz4.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+PackedArchive::PackedArchive(const std::string& fullPath) :
+	m_file(std::make_shared<MappedFile>()),
+	m_names(nullptr)
+{
+	if (!m_file->open(fullPath, MappedFile::AccessHint::RANDOM))
+	{
+		throw std::runtime_error("Failed to open archive " + fullPath);
+	}
+
+	m_view = FileView(m_file, m_file->data(), m_file->size());
+
+	ArchiveHeader header;
+	if (m_view.size() < sizeof(header))
+	{
+		throw std::runtime_error("Archive is truncated " + fullPath);
+	}
+	memcpy(&header, m_view.data(), sizeof(header));
+
+	if (header.magic != ARCHIVE_MAGIC || header.version != ARCHIVE_VERSION)
+	{
+		throw std::runtime_error("Not a supported archive " + fullPath);
+	}
+
+	uint64_t entriesSize = (uint64_t)header.entryCount * sizeof(ArchiveEntry);
+	if (header.entriesOffset + entriesSize > m_view.size() || header.namesOffset + header.namesSize > m_view.size())
+	{
+		throw std::runtime_error("Archive table of contents is out of the file " + fullPath);
+	}
+
+	m_entries.resize(header.entryCount);
+	memcpy(m_entries.data(), m_view.data() + header.entriesOffset, (size_t)entriesSize);
+	m_names = m_view.data() + header.namesOffset;
+
+	for (const ArchiveEntry& entry : m_entries)
+	{
+		if (entry.offset + entry.storedSize > m_view.size() || (uint64_t)entry.nameOffset + entry.nameLength > header.namesSize ||
+			entry.compression > (uint32_t)ArchiveCompression::LZ4)
+		{
+			throw std::runtime_error("Archive entry is corrupted " + fullPath);
+		}
+	}
+}
+
+const ArchiveEntry* PackedArchive::find(const std::string& path) const
+{
+	uint64_t pathHash = hashArchivePath(path);
+
+	auto entry = std::lower_bound(m_entries.begin(), m_entries.end(), pathHash, [](const ArchiveEntry& entry, uint64_t hash)
+		{
+			return entry.pathHash < hash;
+		});
+
+	// Names settle hash collisions
+	for (; entry != m_entries.end() && entry->pathHash == pathHash; ++entry)
+	{
+		if (entry->nameLength == path.size() && memcmp(m_names + entry->nameOffset, path.data(), path.size()) == 0)
+		{
+			return &*entry;
+		}
+	}
+
+	return nullptr;
+}
+
+FileView PackedArchive::read(const ArchiveEntry& entry) const
+{
+	return readEntry(m_view, entry);
+}
+
+void PackedArchive::advise(const ArchiveEntry& entry, MappedFile::AccessHint hint) const
+{
+	m_file->advise(hint, (size_t)entry.offset, (size_t)entry.storedSize);
+}
+
+std::future<FileView> PackedArchive::readAsync(const ArchiveEntry& entry) const
+{
+	advise(entry, MappedFile::AccessHint::WILL_NEED);
+
+	// The view keeps the mapping alive even if the archive goes away first
+	FileView archive = m_view;
+	return std::async(std::launch::async, [archive, entry]()
+		{
+			return readEntry(archive, entry);
+		});
+}
+
+const std::vector<ArchiveEntry>& PackedArchive::getEntries() const
+{
+	return m_entries;
+}
+
+std::string PackedArchive::getName(const ArchiveEntry& entry) const
+{
+	return std::string(m_names + entry.nameOffset, entry.nameLength);
+}
+
+FileView PackedArchive::readEntry(const FileView& archive, const ArchiveEntry& entry)
+{
+	FileView stored = archive.slice((size_t)entry.offset, (size_t)entry.storedSize);
+	if (entry.compression == (uint32_t)ArchiveCompression::NONE)
+	{
+		return stored;
+	}
+
+	std::shared_ptr<std::vector<char>> data = std::make_shared<std::vector<char>>((size_t)entry.size);
+	if (!lz4Decompress(reinterpret_cast<const uint8_t*>(stored.data()), stored.size(), reinterpret_cast<uint8_t*>(data->data()), data->size()))
+	{
+		throw std::runtime_error("Archive entry failed to decompress.");
+	}
+
+	return FileView(data, data->data(), data->size());
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "ArchiveFormat.h"
+#include "FileView.h"
+#include "../MappedFile.h"
+
+#include <future>
+#include <string>
+#include <vector>
+
+// Read side of the packed archive, the whole file stays mapped and the table of contents is searched by hash
+class PackedArchive
+{
+public:
+	// Throws when the file is missing or isn't a valid archive
+	PackedArchive(const std::string& fullPath);
+
+	const ArchiveEntry* find(const std::string& path) const;
+
+	// Stored entries are views into the mapping, compressed ones are decoded into their own buffer
+	FileView read(const ArchiveEntry& entry) const;
+
+	// Paging hint for the entry's stored bytes in the mapping
+	void advise(const ArchiveEntry& entry, MappedFile::AccessHint hint) const;
+
+	// Starts paging the blob in right away and decodes it on another thread
+	std::future<FileView> readAsync(const ArchiveEntry& entry) const;
+
+	const std::vector<ArchiveEntry>& getEntries() const;
+	std::string getName(const ArchiveEntry& entry) const;
+
+private:
+	static FileView readEntry(const FileView& archive, const ArchiveEntry& entry);
+
+private:
+	std::shared_ptr<MappedFile> m_file;
+	FileView m_view;
+
+	std::vector<ArchiveEntry> m_entries;
+	const char* m_names;
+};
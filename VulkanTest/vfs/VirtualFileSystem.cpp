@@ -0,0 +1,119 @@
+#include "VirtualFileSystem.h"
+
+#include <algorithm>
+
+void VirtualFileSystem::mount(const std::string& prefix, std::shared_ptr<FileMount> fileMount)
+{
+	std::string normalizedPrefix = normalize(prefix.c_str());
+	if (!normalizedPrefix.empty())
+	{
+		normalizedPrefix += '/';
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_mounts.push_back({ normalizedPrefix, std::move(fileMount) });
+	m_lookups.clear();
+	++m_mountGeneration;
+}
+
+void VirtualFileSystem::unmount(const std::shared_ptr<FileMount>& fileMount)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_mounts.erase(std::remove_if(m_mounts.begin(), m_mounts.end(), [&fileMount](const MountPoint& mountPoint)
+		{
+			return mountPoint.fileMount == fileMount;
+		}), m_mounts.end());
+	m_lookups.clear();
+	++m_mountGeneration;
+}
+
+bool VirtualFileSystem::exists(const char* path)
+{
+	CachedLookup lookup;
+	return resolve(normalize(path), lookup);
+}
+
+bool VirtualFileSystem::tryOpen(const char* path, MappedFile::AccessHint hint, FileView& view)
+{
+	CachedLookup lookup;
+	if (!resolve(normalize(path), lookup))
+	{
+		return false;
+	}
+
+	return lookup.fileMount->open(lookup.mountPath, hint, view);
+}
+
+std::string VirtualFileSystem::normalize(const char* path)
+{
+	std::string normalized;
+
+	const char* component = path;
+	while (*component != '\0')
+	{
+		const char* end = component;
+		while (*end != '\0' && *end != '/' && *end != '\\')
+		{
+			++end;
+		}
+
+		std::string name(component, end);
+		if (!name.empty() && name != ".")
+		{
+			if (!normalized.empty())
+			{
+				normalized += '/';
+			}
+			normalized += name;
+		}
+
+		component = *end == '\0' ? end : end + 1;
+	}
+
+	return normalized;
+}
+
+bool VirtualFileSystem::resolve(const std::string& path, CachedLookup& lookup)
+{
+	std::vector<MountPoint> mounts;
+	uint64_t mountGeneration;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		auto cached = m_lookups.find(path);
+		if (cached != m_lookups.end())
+		{
+			lookup = cached->second;
+			return true;
+		}
+
+		mounts = m_mounts;
+		mountGeneration = m_mountGeneration;
+	}
+
+	// Probed outside the lock, mounts may touch the disk
+	for (auto mountPoint = mounts.rbegin(); mountPoint != mounts.rend(); ++mountPoint)
+	{
+		if (path.compare(0, mountPoint->prefix.size(), mountPoint->prefix) != 0)
+		{
+			continue;
+		}
+
+		std::string mountPath = path.substr(mountPoint->prefix.size());
+		if (mountPoint->fileMount->exists(mountPath))
+		{
+			lookup = { mountPoint->fileMount, mountPath };
+
+			// Not cached when the mounts changed while probing
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (mountGeneration == m_mountGeneration)
+			{
+				m_lookups[path] = lookup;
+			}
+
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "FileMount.h"
+
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+// Resolves asset paths against mount points, the most recent mount matching a prefix wins.
+// Resolved paths are cached so a repeated open doesn't probe every mount again.
+class VirtualFileSystem
+{
+public:
+	void mount(const std::string& prefix, std::shared_ptr<FileMount> fileMount);
+	void unmount(const std::shared_ptr<FileMount>& fileMount);
+
+	bool exists(const char* path);
+	bool tryOpen(const char* path, MappedFile::AccessHint hint, FileView& view);
+
+	// Forward slashes, no leading ./ or /, no empty components
+	static std::string normalize(const char* path);
+
+private:
+	struct MountPoint
+	{
+		std::string prefix;
+		std::shared_ptr<FileMount> fileMount;
+	};
+
+	struct CachedLookup
+	{
+		std::shared_ptr<FileMount> fileMount;
+		std::string mountPath;
+	};
+
+	bool resolve(const std::string& path, CachedLookup& lookup);
+
+private:
+	std::mutex m_mutex;
+	std::vector<MountPoint> m_mounts;
+	uint64_t m_mountGeneration = 0;
+
+	// Only hits are cached, a file written after a miss is still found
+	std::unordered_map<std::string, CachedLookup> m_lookups;
+};
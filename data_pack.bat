@@ -0,0 +1,8 @@
+set DATA_PATH=%~dp0data
+
+set BUILDER_EXE=%1
+
+set FILES=lineBuffer prismBuffer sphereBuffer sphereElements tunnel tunnel4 tunnel6 tunnel8 tunnel50 tunnel500 ^
+	line.mesh prism.mesh sphere.mesh tunnel.mesh tunnel4.mesh tunnel6.mesh tunnel8.mesh tunnel50.mesh tunnel500.mesh
+
+%BUILDER_EXE% --compress %DATA_PATH%\bin.pak %DATA_PATH%\bin %FILES%
@@ -0,0 +1,11 @@
+set DATA_PATH=%~dp0data\bin
+
+set CONVERTER_EXE=%1
+
+%CONVERTER_EXE% --lines %DATA_PATH%\lineBuffer %DATA_PATH%\line.mesh
+%CONVERTER_EXE% --normals %DATA_PATH%\prismBuffer %DATA_PATH%\prism.mesh
+%CONVERTER_EXE% --indices %DATA_PATH%\sphereElements %DATA_PATH%\sphereBuffer %DATA_PATH%\sphere.mesh
+
+for %%a in (tunnel tunnel4 tunnel6 tunnel8 tunnel50 tunnel500) do (
+	%CONVERTER_EXE% --normals %DATA_PATH%\%%a %DATA_PATH%\%%a.mesh
+)
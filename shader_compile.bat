@@ -3,7 +3,9 @@ set SHADERS_PATH=%~dp0/shaders
 set SRC_PATH=%SHADERS_PATH%/src
 set BIN_PATH=%SHADERS_PATH%/bin
 
-set FILES=triangle.vert;triangle.frag
+set FILES=triangle.vert;triangle.frag;cull.comp
+
+if not exist "%~dp0shaders\bin" mkdir "%~dp0shaders\bin"
 
 set GLSLC_EXE=C:/VulkanSDK/1.2.131.2/Bin/glslc.exe
 
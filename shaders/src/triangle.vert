@@ -5,12 +5,14 @@ layout(location = 0) in vec3 vInPosition;
 layout(location = 1) in vec3 vInColor;
 layout(location = 2) in vec2 vTexCoord;
 
+// Per instance, locations 3 to 6
+layout(location = 3) in mat4 iModel;
+
 layout(location = 0) out vec3 fragmentColor;
 layout(location = 1) out vec2 fragTexCoord;
 
 layout(binding = 0) uniform UniformBufferObject
 {
-    mat4 model;
     mat4 view;
     mat4 projection;
 } ubo;
@@ -19,5 +21,5 @@ void main()
 {
 	fragTexCoord = vec2(1.0) - vTexCoord;
 	fragmentColor = vInColor;
-	gl_Position = ubo.projection * ubo.view * ubo.model * vec4(vInPosition, 1.0);
+	gl_Position = ubo.projection * ubo.view * iModel * vec4(vInPosition, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,7 @@
+set RESOURCES_PATH=%~dp0resources
+
+set COMPRESSOR_EXE=%1
+
+for %%a in (%RESOURCES_PATH%\*.png %RESOURCES_PATH%\*.jpg) do (
+	%COMPRESSOR_EXE% --bc7 %%a %RESOURCES_PATH%\%%~na.ktx2
+)
@@ -0,0 +1,143 @@
+#include "ArchiveWriter.h"
+#include "vfs/Lz4.h"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+static uint64_t alignOffset(uint64_t offset, uint64_t alignment)
+{
+	return ((offset + alignment - 1) / alignment) * alignment;
+}
+
+ArchiveWriter::ArchiveWriter(uint32_t blobAlignment) :
+	m_blobAlignment(std::max(blobAlignment, 1u))
+{
+}
+
+void ArchiveWriter::add(const std::string& path, std::vector<uint8_t> data, bool compress)
+{
+	for (const PendingEntry& pending : m_entries)
+	{
+		if (pending.path == path)
+		{
+			throw std::runtime_error("Duplicate archive path " + path);
+		}
+	}
+
+	PendingEntry pending;
+	pending.path = path;
+	pending.entry = {};
+	pending.entry.pathHash = hashArchivePath(path);
+	pending.entry.size = data.size();
+	pending.entry.compression = (uint32_t)ArchiveCompression::NONE;
+
+	if (compress)
+	{
+		std::vector<uint8_t> compressed = lz4Compress(data.data(), data.size());
+		if (!compressed.empty() && compressed.size() <= data.size() - data.size() / 8)
+		{
+			data = std::move(compressed);
+			pending.entry.compression = (uint32_t)ArchiveCompression::LZ4;
+		}
+	}
+
+	pending.entry.storedSize = data.size();
+	pending.stored = std::move(data);
+
+	m_entries.push_back(std::move(pending));
+}
+
+void ArchiveWriter::write(const char* path) const
+{
+	std::vector<const PendingEntry*> sorted;
+	for (const PendingEntry& pending : m_entries)
+	{
+		sorted.push_back(&pending);
+	}
+	std::sort(sorted.begin(), sorted.end(), [](const PendingEntry* a, const PendingEntry* b)
+		{
+			return a->entry.pathHash < b->entry.pathHash;
+		});
+
+	std::vector<ArchiveEntry> entries;
+	std::string names;
+	for (const PendingEntry* pending : sorted)
+	{
+		ArchiveEntry entry = pending->entry;
+		entry.nameOffset = (uint32_t)names.size();
+		entry.nameLength = (uint32_t)pending->path.size();
+		names += pending->path;
+
+		entries.push_back(entry);
+	}
+
+	ArchiveHeader header = {};
+	header.magic = ARCHIVE_MAGIC;
+	header.version = ARCHIVE_VERSION;
+	header.entryCount = (uint32_t)entries.size();
+	header.blobAlignment = m_blobAlignment;
+	header.entriesOffset = sizeof(ArchiveHeader);
+	header.namesOffset = header.entriesOffset + entries.size() * sizeof(ArchiveEntry);
+	header.namesSize = names.size();
+
+	uint64_t offset = header.namesOffset + header.namesSize;
+	for (ArchiveEntry& entry : entries)
+	{
+		offset = alignOffset(offset, m_blobAlignment);
+		entry.offset = offset;
+		offset += entry.storedSize;
+	}
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		throw std::runtime_error(std::string("Failed to create ") + path);
+	}
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(ArchiveEntry));
+	file.write(names.data(), names.size());
+
+	uint64_t written = header.namesOffset + header.namesSize;
+	const char padding[256] = {};
+	for (uint32_t i = 0; i < entries.size(); ++i)
+	{
+		while (written < entries[i].offset)
+		{
+			uint64_t paddingSize = std::min<uint64_t>(entries[i].offset - written, sizeof(padding));
+			file.write(padding, paddingSize);
+			written += paddingSize;
+		}
+
+		file.write(reinterpret_cast<const char*>(sorted[i]->stored.data()), sorted[i]->stored.size());
+		written += sorted[i]->stored.size();
+	}
+
+	if (!file.good())
+	{
+		throw std::runtime_error(std::string("Failed to write ") + path);
+	}
+}
+
+uint64_t ArchiveWriter::getSize() const
+{
+	uint64_t size = 0;
+	for (const PendingEntry& pending : m_entries)
+	{
+		size += pending.entry.size;
+	}
+
+	return size;
+}
+
+uint64_t ArchiveWriter::getStoredSize() const
+{
+	uint64_t size = 0;
+	for (const PendingEntry& pending : m_entries)
+	{
+		size += pending.entry.storedSize;
+	}
+
+	return size;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "vfs/ArchiveFormat.h"
+
+#include <string>
+#include <vector>
+
+class ArchiveWriter
+{
+public:
+	ArchiveWriter(uint32_t blobAlignment = 64);
+
+	// Entries only stay compressed when it saves at least an eighth of their size
+	void add(const std::string& path, std::vector<uint8_t> data, bool compress);
+
+	void write(const char* path) const;
+
+	uint64_t getSize() const;
+	uint64_t getStoredSize() const;
+
+private:
+	struct PendingEntry
+	{
+		std::string path;
+		ArchiveEntry entry;
+		std::vector<uint8_t> stored;
+	};
+
+	uint32_t m_blobAlignment;
+	std::vector<PendingEntry> m_entries;
+};
@@ -0,0 +1,82 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "ArchiveWriter.h"
+
+// Paths are stored the way the VirtualFileSystem looks them up
+static std::string normalizeArchivePath(std::string path)
+{
+	std::replace(path.begin(), path.end(), '\\', '/');
+	while (path.compare(0, 2, "./") == 0)
+	{
+		path.erase(0, 2);
+	}
+
+	return path;
+}
+
+// Packs loose files into one archive mounted in place of their directory
+// ArchiveBuilder [--compress] [--align <bytes>] <output.pak> <input directory> <file>...
+int main(int argc, char** argv)
+{
+	bool isCompressed = false;
+	uint32_t alignment = 64;
+	std::vector<const char*> paths;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string argument(argv[i]);
+		if (argument == "--compress")
+		{
+			isCompressed = true;
+		}
+		else if (argument == "--align" && i + 1 < argc)
+		{
+			alignment = (uint32_t)std::stoul(argv[++i]);
+		}
+		else
+		{
+			paths.push_back(argv[i]);
+		}
+	}
+
+	if (paths.size() < 3)
+	{
+		std::cerr << "Usage: ArchiveBuilder [--compress] [--align <bytes>] <output.pak> <input directory> <file>..." << std::endl;
+		return 1;
+	}
+
+	std::string inputDirectory = paths[1];
+	ArchiveWriter writer(alignment);
+	try
+	{
+		for (size_t i = 2; i < paths.size(); ++i)
+		{
+			std::string fullPath = inputDirectory + "/" + paths[i];
+			std::ifstream file(fullPath, std::ios::binary);
+			if (!file.is_open())
+			{
+				std::cerr << "Failed to open " << fullPath << std::endl;
+				return 1;
+			}
+
+			std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+			writer.add(normalizeArchivePath(paths[i]), std::move(data), isCompressed);
+		}
+
+		writer.write(paths[0]);
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	std::cout << paths[0] << ": " << paths.size() - 2 << " files, "
+		<< writer.getSize() << " -> " << writer.getStoredSize() << " bytes" << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,195 @@
+#include "MeshWriter.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+
+static uint64_t alignOffset(uint64_t offset, uint64_t alignment)
+{
+	return ((offset + alignment - 1) / alignment) * alignment;
+}
+
+void MeshWriter::write(const char* path, const MeshData& mesh)
+{
+	uint32_t vertexCount = (uint32_t)(mesh.vertices.size() / mesh.vertexStride);
+	uint32_t indexCount = (uint32_t)mesh.indices.size();
+
+	VkIndexType indexType = vertexCount <= UINT16_MAX ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+	uint32_t indexSize = MeshFile::getIndexSize(indexType);
+
+	std::vector<MeshLod> lods(1);
+	lods[0].firstIndex = 0;
+	lods[0].indexCount = indexCount > 0 ? indexCount : vertexCount;
+	lods[0].error = 0.0f;
+	lods[0].reserved = 0;
+
+	std::vector<MeshMeshlet> meshlets = buildMeshlets(mesh);
+
+	MeshHeader header = {};
+	header.magic = MESH_MAGIC;
+	header.version = MESH_VERSION;
+	header.topology = mesh.topology;
+	header.vertexCount = vertexCount;
+	header.vertexStride = mesh.vertexStride;
+	header.indexCount = indexCount;
+	header.indexType = indexType;
+	header.attributeCount = (uint32_t)mesh.attributes.size();
+	header.lodCount = (uint32_t)lods.size();
+	header.meshletCount = (uint32_t)meshlets.size();
+
+	std::vector<uint32_t> allVertices(vertexCount);
+	std::iota(allVertices.begin(), allVertices.end(), 0);
+	computeBounds(mesh, allVertices, header.boundsMin, header.boundsMax, header.sphereCenter, &header.sphereRadius);
+
+	header.attributesOffset = sizeof(MeshHeader);
+	header.lodsOffset = header.attributesOffset + mesh.attributes.size() * sizeof(MeshAttribute);
+	header.meshletsOffset = header.lodsOffset + lods.size() * sizeof(MeshLod);
+
+	// Indices follow the vertices directly so one copy covers both
+	header.dataAlignment = DATA_ALIGNMENT;
+	header.vertexDataOffset = alignOffset(header.meshletsOffset + meshlets.size() * sizeof(MeshMeshlet), DATA_ALIGNMENT);
+	header.vertexDataSize = mesh.vertices.size();
+	header.indexDataOffset = alignOffset(header.vertexDataOffset + header.vertexDataSize, 4);
+	header.indexDataSize = (uint64_t)indexCount * indexSize;
+
+	std::vector<char> file((size_t)(header.indexDataOffset + header.indexDataSize), 0);
+	memcpy(file.data(), &header, sizeof(header));
+	memcpy(file.data() + header.attributesOffset, mesh.attributes.data(), mesh.attributes.size() * sizeof(MeshAttribute));
+	memcpy(file.data() + header.lodsOffset, lods.data(), lods.size() * sizeof(MeshLod));
+	if (!meshlets.empty())
+	{
+		memcpy(file.data() + header.meshletsOffset, meshlets.data(), meshlets.size() * sizeof(MeshMeshlet));
+	}
+	memcpy(file.data() + header.vertexDataOffset, mesh.vertices.data(), mesh.vertices.size());
+
+	char* indexData = file.data() + header.indexDataOffset;
+	for (uint32_t i = 0; i < indexCount; ++i)
+	{
+		if (indexType == VK_INDEX_TYPE_UINT16)
+		{
+			uint16_t index = (uint16_t)mesh.indices[i];
+			memcpy(indexData + i * indexSize, &index, indexSize);
+		}
+		else
+		{
+			memcpy(indexData + i * indexSize, &mesh.indices[i], indexSize);
+		}
+	}
+
+	std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+	if (!stream.is_open())
+	{
+		throw std::runtime_error(std::string("Failed to create ") + path);
+	}
+
+	stream.write(file.data(), file.size());
+	if (!stream.good())
+	{
+		throw std::runtime_error(std::string("Failed to write ") + path);
+	}
+}
+
+std::vector<MeshMeshlet> MeshWriter::buildMeshlets(const MeshData& mesh)
+{
+	std::vector<MeshMeshlet> meshlets;
+	if (mesh.topology != VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST || mesh.indices.empty())
+	{
+		return meshlets;
+	}
+
+	// Consecutive triangles until either limit is hit, the index order decides the locality
+	std::unordered_set<uint32_t> meshletVertices;
+	uint32_t firstIndex = 0;
+	for (uint32_t index = 0; index <= mesh.indices.size(); index += 3)
+	{
+		bool isLast = index == mesh.indices.size();
+
+		uint32_t newVertexCount = 0;
+		if (!isLast)
+		{
+			for (uint32_t corner = 0; corner < 3; ++corner)
+			{
+				newVertexCount += meshletVertices.count(mesh.indices[index + corner]) == 0 ? 1 : 0;
+			}
+		}
+
+		bool isFull = meshletVertices.size() + newVertexCount > MESHLET_MAX_VERTICES || (index - firstIndex) / 3 == MESHLET_MAX_TRIANGLES;
+		if ((isLast || isFull) && index > firstIndex)
+		{
+			std::vector<uint32_t> vertexIndices(meshletVertices.begin(), meshletVertices.end());
+
+			MeshMeshlet meshlet = {};
+			meshlet.firstIndex = firstIndex;
+			meshlet.indexCount = index - firstIndex;
+
+			float boundsMin[3];
+			float boundsMax[3];
+			computeBounds(mesh, vertexIndices, boundsMin, boundsMax, meshlet.center, &meshlet.radius);
+
+			meshlets.push_back(meshlet);
+
+			meshletVertices.clear();
+			firstIndex = index;
+		}
+
+		if (!isLast)
+		{
+			meshletVertices.insert(mesh.indices.begin() + index, mesh.indices.begin() + index + 3);
+		}
+	}
+
+	return meshlets;
+}
+
+void MeshWriter::computeBounds(const MeshData& mesh, const std::vector<uint32_t>& vertexIndices, float* boundsMin, float* boundsMax, float* center, float* radius)
+{
+	uint32_t positionOffset = 0;
+	for (const MeshAttribute& attribute : mesh.attributes)
+	{
+		if (attribute.semantic == (uint32_t)MeshSemantic::POSITION)
+		{
+			positionOffset = attribute.offset;
+		}
+	}
+
+	for (uint32_t axis = 0; axis < 3; ++axis)
+	{
+		boundsMin[axis] = FLT_MAX;
+		boundsMax[axis] = -FLT_MAX;
+	}
+
+	std::vector<float> positions(vertexIndices.size() * 3);
+	for (size_t i = 0; i < vertexIndices.size(); ++i)
+	{
+		memcpy(&positions[i * 3], mesh.vertices.data() + (size_t)vertexIndices[i] * mesh.vertexStride + positionOffset, 3 * sizeof(float));
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			boundsMin[axis] = std::min(boundsMin[axis], positions[i * 3 + axis]);
+			boundsMax[axis] = std::max(boundsMax[axis], positions[i * 3 + axis]);
+		}
+	}
+
+	// Centered on the box, tighter than the box corners for round meshes
+	float radiusSquared = 0.0f;
+	for (uint32_t axis = 0; axis < 3; ++axis)
+	{
+		center[axis] = (boundsMin[axis] + boundsMax[axis]) * 0.5f;
+	}
+
+	for (size_t i = 0; i < vertexIndices.size(); ++i)
+	{
+		float x = positions[i * 3 + 0] - center[0];
+		float y = positions[i * 3 + 1] - center[1];
+		float z = positions[i * 3 + 2] - center[2];
+
+		radiusSquared = std::max(radiusSquared, x * x + y * y + z * z);
+	}
+
+	*radius = std::sqrt(radiusSquared);
+}
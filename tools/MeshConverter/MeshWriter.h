@@ -0,0 +1,33 @@
+#pragma once
+
+#include "mesh/MeshFile.h"
+
+#include <vector>
+
+// Geometry gathered by the converter, positions are read from the POSITION attribute of every vertex
+struct MeshData
+{
+	VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	uint32_t vertexStride = 0;
+	std::vector<MeshAttribute> attributes;
+
+	std::vector<uint8_t> vertices;
+	std::vector<uint32_t> indices;
+};
+
+class MeshWriter
+{
+public:
+	// Indices are narrowed to 16 bits whenever the vertex count allows it
+	static void write(const char* path, const MeshData& mesh);
+
+	static const uint32_t DATA_ALIGNMENT = 256;
+	static const uint32_t MESHLET_MAX_VERTICES = 64;
+	static const uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+private:
+	MeshWriter();
+
+	static std::vector<MeshMeshlet> buildMeshlets(const MeshData& mesh);
+	static void computeBounds(const MeshData& mesh, const std::vector<uint32_t>& vertexIndices, float* boundsMin, float* boundsMax, float* center, float* radius);
+};
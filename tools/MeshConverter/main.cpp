@@ -0,0 +1,205 @@
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "MeshWriter.h"
+#include "mesh/MeshOptimizer.h"
+
+// Same layout as the renderer's Vertex
+struct ConvertedVertex
+{
+	float position[3];
+	float color[3];
+	float texCoord[2];
+};
+
+static bool readFloats(const char* path, std::vector<float>& values)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	values.resize(data.size() / sizeof(float));
+	memcpy(values.data(), data.data(), values.size() * sizeof(float));
+
+	return true;
+}
+
+static std::vector<MeshAttribute> getVertexLayout()
+{
+	return {
+		{ (uint32_t)MeshSemantic::POSITION, VK_FORMAT_R32G32B32_SFLOAT, offsetof(ConvertedVertex, position), 0 },
+		{ (uint32_t)MeshSemantic::COLOR, VK_FORMAT_R32G32B32_SFLOAT, offsetof(ConvertedVertex, color), 0 },
+		{ (uint32_t)MeshSemantic::TEX_COORD, VK_FORMAT_R32G32_SFLOAT, offsetof(ConvertedVertex, texCoord), 0 }
+	};
+}
+
+// Converts the headerless float dumps of data/bin into mesh files.
+// Vertices are vec3 positions, followed by a vec3 normal each with --normals, normals end up encoded in the color.
+// Meshes without an index file are welded into an indexed mesh.
+// Triangle lists are reordered for the vertex cache, overdraw and vertex fetch unless --no-optimize is given.
+// MeshConverter [--lines] [--normals] [--no-optimize] [--indices <uint32 index file>] <input vertices> <output.mesh>
+int main(int argc, char** argv)
+{
+	bool isLines = false;
+	bool hasNormals = false;
+	bool isOptimized = true;
+	const char* indicesPath = nullptr;
+	std::vector<const char*> paths;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string argument(argv[i]);
+		if (argument == "--lines")
+		{
+			isLines = true;
+		}
+		else if (argument == "--normals")
+		{
+			hasNormals = true;
+		}
+		else if (argument == "--no-optimize")
+		{
+			isOptimized = false;
+		}
+		else if (argument == "--indices" && i + 1 < argc)
+		{
+			indicesPath = argv[++i];
+		}
+		else
+		{
+			paths.push_back(argv[i]);
+		}
+	}
+
+	if (paths.size() != 2)
+	{
+		std::cerr << "Usage: MeshConverter [--lines] [--normals] [--no-optimize] [--indices <uint32 index file>] <input vertices> <output.mesh>" << std::endl;
+		return 1;
+	}
+
+	std::vector<float> floats;
+	if (!readFloats(paths[0], floats))
+	{
+		std::cerr << "Failed to open " << paths[0] << std::endl;
+		return 1;
+	}
+
+	uint32_t floatsPerVertex = hasNormals ? 6 : 3;
+	uint32_t legacyVertexCount = (uint32_t)(floats.size() / floatsPerVertex);
+
+	std::vector<ConvertedVertex> vertices(legacyVertexCount);
+	for (uint32_t i = 0; i < legacyVertexCount; ++i)
+	{
+		const float* source = &floats[i * floatsPerVertex];
+
+		ConvertedVertex& vertex = vertices[i];
+		memcpy(vertex.position, source, sizeof(vertex.position));
+		vertex.texCoord[0] = 0.0f;
+		vertex.texCoord[1] = 0.0f;
+
+		if (hasNormals)
+		{
+			float length = std::sqrt(source[3] * source[3] + source[4] * source[4] + source[5] * source[5]);
+			for (uint32_t axis = 0; axis < 3; ++axis)
+			{
+				vertex.color[axis] = length > 0.0f ? source[3 + axis] / length * 0.5f + 0.5f : 0.5f;
+			}
+		}
+		else
+		{
+			vertex.color[0] = 1.0f;
+			vertex.color[1] = 1.0f;
+			vertex.color[2] = 1.0f;
+		}
+	}
+
+	MeshData mesh;
+	mesh.topology = isLines ? VK_PRIMITIVE_TOPOLOGY_LINE_LIST : VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	mesh.vertexStride = sizeof(ConvertedVertex);
+	mesh.attributes = getVertexLayout();
+
+	std::vector<ConvertedVertex> uniqueVertices;
+	if (indicesPath != nullptr)
+	{
+		std::ifstream file(indicesPath, std::ios::binary);
+		if (!file.is_open())
+		{
+			std::cerr << "Failed to open " << indicesPath << std::endl;
+			return 1;
+		}
+
+		std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		mesh.indices.resize(data.size() / sizeof(uint32_t));
+		memcpy(mesh.indices.data(), data.data(), mesh.indices.size() * sizeof(uint32_t));
+
+		for (uint32_t index : mesh.indices)
+		{
+			if (index >= legacyVertexCount)
+			{
+				std::cerr << "Index " << index << " is out of range in " << indicesPath << std::endl;
+				return 1;
+			}
+		}
+
+		uniqueVertices = std::move(vertices);
+	}
+	else
+	{
+		// Bitwise identical vertices are shared
+		std::unordered_map<std::string, uint32_t> vertexIndices;
+		for (const ConvertedVertex& vertex : vertices)
+		{
+			std::string key(reinterpret_cast<const char*>(&vertex), sizeof(vertex));
+			auto inserted = vertexIndices.emplace(key, (uint32_t)uniqueVertices.size());
+			if (inserted.second)
+			{
+				uniqueVertices.push_back(vertex);
+			}
+
+			mesh.indices.push_back(inserted.first->second);
+		}
+	}
+
+	if (isOptimized && !isLines)
+	{
+		uint32_t* indices = mesh.indices.data();
+		size_t indexCount = mesh.indices.size();
+
+		VertexCacheStatistics before = MeshOptimizer::analyzeVertexCache(indices, indexCount, (uint32_t)uniqueVertices.size());
+
+		MeshOptimizer::optimizeVertexCache(indices, indexCount, (uint32_t)uniqueVertices.size());
+		MeshOptimizer::optimizeOverdraw(indices, indexCount, uniqueVertices.data(), sizeof(ConvertedVertex), (uint32_t)uniqueVertices.size());
+
+		uint32_t vertexCount = MeshOptimizer::optimizeVertexFetch(uniqueVertices.data(), (uint32_t)uniqueVertices.size(), sizeof(ConvertedVertex), indices, indexCount);
+		uniqueVertices.resize(vertexCount);
+
+		VertexCacheStatistics after = MeshOptimizer::analyzeVertexCache(indices, indexCount, vertexCount);
+		std::cout << paths[1] << ": ACMR " << before.acmr << " -> " << after.acmr << ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+	}
+
+	mesh.vertices.resize(uniqueVertices.size() * sizeof(ConvertedVertex));
+	memcpy(mesh.vertices.data(), uniqueVertices.data(), mesh.vertices.size());
+
+	try
+	{
+		MeshWriter::write(paths[1], mesh);
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	std::cout << paths[0] << " -> " << paths[1] << ": " << legacyVertexCount << " -> " << uniqueVertices.size() << " vertices, "
+		<< mesh.indices.size() << " indices" << std::endl;
+
+	return 0;
+}
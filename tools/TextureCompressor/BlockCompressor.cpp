@@ -0,0 +1,337 @@
+#include "BlockCompressor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+bool BlockCompressor::isSupported(VkFormat format)
+{
+	return format == VK_FORMAT_BC1_RGB_UNORM_BLOCK || format == VK_FORMAT_BC1_RGB_SRGB_BLOCK ||
+		format == VK_FORMAT_BC7_UNORM_BLOCK || format == VK_FORMAT_BC7_SRGB_BLOCK;
+}
+
+std::vector<uint8_t> BlockCompressor::compress(const uint8_t* pixels, uint32_t width, uint32_t height, VkFormat format)
+{
+	bool isBC1 = format == VK_FORMAT_BC1_RGB_UNORM_BLOCK || format == VK_FORMAT_BC1_RGB_SRGB_BLOCK;
+	size_t blockSize = isBC1 ? 8 : 16;
+
+	uint32_t blocksX = (width + 3) / 4;
+	uint32_t blocksY = (height + 3) / 4;
+
+	std::vector<uint8_t> blocks(blocksX * blocksY * blockSize);
+
+	uint8_t blockPixels[16][4];
+	for (uint32_t by = 0; by < blocksY; ++by)
+	{
+		for (uint32_t bx = 0; bx < blocksX; ++bx)
+		{
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				uint32_t x = std::min(bx * 4 + i % 4, width - 1);
+				uint32_t y = std::min(by * 4 + i / 4, height - 1);
+				memcpy(blockPixels[i], pixels + ((size_t)y * width + x) * 4, 4);
+			}
+
+			uint8_t* block = blocks.data() + (by * blocksX + bx) * blockSize;
+			if (isBC1)
+			{
+				encodeBC1(blockPixels, block);
+			}
+			else
+			{
+				encodeBC7(blockPixels, block);
+			}
+		}
+	}
+
+	return blocks;
+}
+
+void BlockCompressor::findEndpoints(const float colors[16][4], uint32_t channelCount, float* low, float* high)
+{
+	float mean[4] = {};
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		for (uint32_t c = 0; c < channelCount; ++c)
+		{
+			mean[c] += colors[i][c] / 16.0f;
+		}
+	}
+
+	float covariance[4][4] = {};
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		for (uint32_t a = 0; a < channelCount; ++a)
+		{
+			for (uint32_t b = 0; b < channelCount; ++b)
+			{
+				covariance[a][b] += (colors[i][a] - mean[a]) * (colors[i][b] - mean[b]);
+			}
+		}
+	}
+
+	// Principal axis by power iteration
+	float axis[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	for (uint32_t iteration = 0; iteration < 8; ++iteration)
+	{
+		float next[4] = {};
+		float length = 0.0f;
+		for (uint32_t a = 0; a < channelCount; ++a)
+		{
+			for (uint32_t b = 0; b < channelCount; ++b)
+			{
+				next[a] += covariance[a][b] * axis[b];
+			}
+			length += next[a] * next[a];
+		}
+
+		if (length < 1e-8f)
+		{
+			break;
+		}
+
+		length = std::sqrt(length);
+		for (uint32_t a = 0; a < channelCount; ++a)
+		{
+			axis[a] = next[a] / length;
+		}
+	}
+
+	float minProjection = 0.0f;
+	float maxProjection = 0.0f;
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		float projection = 0.0f;
+		for (uint32_t c = 0; c < channelCount; ++c)
+		{
+			projection += (colors[i][c] - mean[c]) * axis[c];
+		}
+
+		minProjection = std::min(minProjection, projection);
+		maxProjection = std::max(maxProjection, projection);
+	}
+
+	for (uint32_t c = 0; c < channelCount; ++c)
+	{
+		low[c] = std::min(std::max(mean[c] + axis[c] * minProjection, 0.0f), 255.0f);
+		high[c] = std::min(std::max(mean[c] + axis[c] * maxProjection, 0.0f), 255.0f);
+	}
+}
+
+
+
+/////////////////////
+////// BC1 //////////
+/////////////////////
+
+static uint16_t packRGB565(const float* color)
+{
+	uint16_t r = (uint16_t)std::lround(color[0] * 31.0f / 255.0f);
+	uint16_t g = (uint16_t)std::lround(color[1] * 63.0f / 255.0f);
+	uint16_t b = (uint16_t)std::lround(color[2] * 31.0f / 255.0f);
+
+	return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void unpackRGB565(uint16_t packed, int* color)
+{
+	int r = (packed >> 11) & 31;
+	int g = (packed >> 5) & 63;
+	int b = packed & 31;
+
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+void BlockCompressor::encodeBC1(const uint8_t pixels[16][4], uint8_t* block)
+{
+	float colors[16][4];
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			colors[i][c] = pixels[i][c];
+		}
+	}
+
+	float low[4], high[4];
+	findEndpoints(colors, 3, low, high);
+
+	// color0 > color1 selects the 4 color mode
+	uint16_t color0 = packRGB565(high);
+	uint16_t color1 = packRGB565(low);
+	if (color0 < color1)
+	{
+		std::swap(color0, color1);
+	}
+
+	int palette[4][3];
+	unpackRGB565(color0, palette[0]);
+	unpackRGB565(color1, palette[1]);
+	for (uint32_t c = 0; c < 3; ++c)
+	{
+		palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+		palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+	}
+
+	uint32_t indices = 0;
+	if (color0 != color1)
+	{
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			uint32_t bestIndex = 0;
+			int bestError = INT32_MAX;
+			for (uint32_t p = 0; p < 4; ++p)
+			{
+				int error = 0;
+				for (uint32_t c = 0; c < 3; ++c)
+				{
+					int difference = pixels[i][c] - palette[p][c];
+					error += difference * difference;
+				}
+
+				if (error < bestError)
+				{
+					bestError = error;
+					bestIndex = p;
+				}
+			}
+
+			indices |= bestIndex << (i * 2);
+		}
+	}
+
+	block[0] = (uint8_t)(color0 & 0xFF);
+	block[1] = (uint8_t)(color0 >> 8);
+	block[2] = (uint8_t)(color1 & 0xFF);
+	block[3] = (uint8_t)(color1 >> 8);
+	memcpy(block + 4, &indices, 4);
+}
+
+
+
+/////////////////////
+////// BC7 //////////
+/////////////////////
+
+static const int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// 7 bit endpoint plus the p-bit shared by its channels, the p-bit giving the smaller error wins
+static void quantizeBC7Endpoint(const float* color, uint32_t* quantized, uint32_t* pBit)
+{
+	float bestError = 0.0f;
+	for (uint32_t p = 0; p < 2; ++p)
+	{
+		uint32_t candidate[4];
+		float error = 0.0f;
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			long value = std::lround((color[c] - p) / 2.0f);
+			candidate[c] = (uint32_t)std::min(std::max(value, 0L), 127L);
+
+			float difference = (float)((candidate[c] << 1) | p) - color[c];
+			error += difference * difference;
+		}
+
+		if (p == 0 || error < bestError)
+		{
+			bestError = error;
+			memcpy(quantized, candidate, sizeof(candidate));
+			*pBit = p;
+		}
+	}
+}
+
+static void writeBits(uint8_t* block, uint32_t* bitOffset, uint32_t value, uint32_t bitCount)
+{
+	for (uint32_t i = 0; i < bitCount; ++i, ++*bitOffset)
+	{
+		if ((value >> i) & 1)
+		{
+			block[*bitOffset / 8] |= (uint8_t)(1 << (*bitOffset % 8));
+		}
+	}
+}
+
+void BlockCompressor::encodeBC7(const uint8_t pixels[16][4], uint8_t* block)
+{
+	float colors[16][4];
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			colors[i][c] = pixels[i][c];
+		}
+	}
+
+	float endpoints[2][4];
+	findEndpoints(colors, 4, endpoints[0], endpoints[1]);
+
+	uint32_t quantized[2][4];
+	uint32_t pBits[2];
+	quantizeBC7Endpoint(endpoints[0], quantized[0], &pBits[0]);
+	quantizeBC7Endpoint(endpoints[1], quantized[1], &pBits[1]);
+
+	int palette[16][4];
+	for (uint32_t w = 0; w < 16; ++w)
+	{
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			int e0 = (int)((quantized[0][c] << 1) | pBits[0]);
+			int e1 = (int)((quantized[1][c] << 1) | pBits[1]);
+			palette[w][c] = ((64 - BC7_WEIGHTS[w]) * e0 + BC7_WEIGHTS[w] * e1 + 32) >> 6;
+		}
+	}
+
+	uint32_t indices[16];
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		int bestError = INT32_MAX;
+		for (uint32_t w = 0; w < 16; ++w)
+		{
+			int error = 0;
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				int difference = pixels[i][c] - palette[w][c];
+				error += difference * difference;
+			}
+
+			if (error < bestError)
+			{
+				bestError = error;
+				indices[i] = w;
+			}
+		}
+	}
+
+	// The first index is stored without its high bit, swapping the endpoints keeps it below 8
+	if (indices[0] >= 8)
+	{
+		std::swap(quantized[0], quantized[1]);
+		std::swap(pBits[0], pBits[1]);
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			indices[i] = 15 - indices[i];
+		}
+	}
+
+	memset(block, 0, 16);
+	uint32_t bitOffset = 0;
+
+	writeBits(block, &bitOffset, 1 << 6, 7);
+	for (uint32_t c = 0; c < 4; ++c)
+	{
+		writeBits(block, &bitOffset, quantized[0][c], 7);
+		writeBits(block, &bitOffset, quantized[1][c], 7);
+	}
+	writeBits(block, &bitOffset, pBits[0], 1);
+	writeBits(block, &bitOffset, pBits[1], 1);
+
+	writeBits(block, &bitOffset, indices[0], 3);
+	for (uint32_t i = 1; i < 16; ++i)
+	{
+		writeBits(block, &bitOffset, indices[i], 4);
+	}
+}
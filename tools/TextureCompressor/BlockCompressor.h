@@ -0,0 +1,24 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+
+#include <vector>
+
+// Encodes RGBA8 pixels into 4x4 blocks, edge blocks repeat the last row and column
+class BlockCompressor
+{
+public:
+	// VK_FORMAT_BC1_RGB_* or VK_FORMAT_BC7_*
+	static bool isSupported(VkFormat format);
+	static std::vector<uint8_t> compress(const uint8_t* pixels, uint32_t width, uint32_t height, VkFormat format);
+
+private:
+	BlockCompressor();
+
+	static void findEndpoints(const float colors[16][4], uint32_t channelCount, float* low, float* high);
+
+	static void encodeBC1(const uint8_t pixels[16][4], uint8_t* block);
+
+	// Mode 6 only, one subset with RGBA endpoints and 4 bit indices
+	static void encodeBC7(const uint8_t pixels[16][4], uint8_t* block);
+};
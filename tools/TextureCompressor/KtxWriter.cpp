@@ -0,0 +1,103 @@
+#include "KtxWriter.h"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+// Khronos data format model and transfer function values
+const uint32_t KHR_DF_MODEL_BC1A = 128;
+const uint32_t KHR_DF_MODEL_BC7 = 134;
+const uint32_t KHR_DF_PRIMARIES_BT709 = 1;
+const uint32_t KHR_DF_TRANSFER_LINEAR = 1;
+const uint32_t KHR_DF_TRANSFER_SRGB = 2;
+
+void KtxWriter::write(const char* path, VkFormat format, uint32_t width, uint32_t height, const std::vector<std::vector<uint8_t>>& levels)
+{
+	uint32_t levelCount = (uint32_t)levels.size();
+	uint64_t blockSize = KtxImage::getBlockByteSize(format);
+
+	std::vector<uint32_t> dataFormatDescriptor = createDataFormatDescriptor(format);
+
+	KtxHeader header = {};
+	memcpy(header.identifier, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER));
+	header.vkFormat = format;
+	header.typeSize = 1;
+	header.pixelWidth = width;
+	header.pixelHeight = height;
+	header.pixelDepth = 0;
+	header.layerCount = 0;
+	header.faceCount = 1;
+	header.levelCount = levelCount;
+	header.supercompressionScheme = 0;
+
+	header.dfdByteOffset = (uint32_t)(sizeof(KtxHeader) + sizeof(KtxLevelIndex) * levelCount);
+	header.dfdByteLength = (uint32_t)(dataFormatDescriptor.size() * sizeof(uint32_t));
+
+	// Smallest level first, every level aligned to the block size
+	std::vector<KtxLevelIndex> levelIndexes(levelCount);
+
+	uint64_t offset = header.dfdByteOffset + header.dfdByteLength;
+	for (int level = (int)levelCount - 1; level >= 0; --level)
+	{
+		offset = (offset + blockSize - 1) / blockSize * blockSize;
+
+		levelIndexes[level].byteOffset = offset;
+		levelIndexes[level].byteLength = levels[level].size();
+		levelIndexes[level].uncompressedByteLength = levels[level].size();
+
+		offset += levels[level].size();
+	}
+
+	std::vector<char> file((size_t)offset, 0);
+	memcpy(file.data(), &header, sizeof(header));
+	memcpy(file.data() + sizeof(header), levelIndexes.data(), sizeof(KtxLevelIndex) * levelCount);
+	memcpy(file.data() + header.dfdByteOffset, dataFormatDescriptor.data(), header.dfdByteLength);
+
+	for (uint32_t level = 0; level < levelCount; ++level)
+	{
+		memcpy(file.data() + levelIndexes[level].byteOffset, levels[level].data(), levels[level].size());
+	}
+
+	std::ofstream output(path, std::ios::binary | std::ios::trunc);
+	if (!output.is_open())
+	{
+		throw std::runtime_error(std::string("Failed to open file ") + path);
+	}
+
+	output.write(file.data(), file.size());
+	if (output.fail())
+	{
+		throw std::runtime_error(std::string("Failed to write file ") + path);
+	}
+}
+
+std::vector<uint32_t> KtxWriter::createDataFormatDescriptor(VkFormat format)
+{
+	bool isBC1 = format == VK_FORMAT_BC1_RGB_UNORM_BLOCK || format == VK_FORMAT_BC1_RGB_SRGB_BLOCK;
+	bool isSrgb = format == VK_FORMAT_BC1_RGB_SRGB_BLOCK || format == VK_FORMAT_BC7_SRGB_BLOCK;
+
+	uint32_t blockSize = KtxImage::getBlockByteSize(format);
+	uint32_t colorModel = isBC1 ? KHR_DF_MODEL_BC1A : KHR_DF_MODEL_BC7;
+	uint32_t transferFunction = isSrgb ? KHR_DF_TRANSFER_SRGB : KHR_DF_TRANSFER_LINEAR;
+
+	// One basic descriptor block with a single sample covering the whole block
+	const uint32_t blockByteSize = 24 + 16;
+
+	std::vector<uint32_t> descriptor;
+	descriptor.push_back(4 + blockByteSize);
+
+	descriptor.push_back(0);
+	descriptor.push_back(2 | (blockByteSize << 16));
+	descriptor.push_back(colorModel | (KHR_DF_PRIMARIES_BT709 << 8) | (transferFunction << 16));
+	descriptor.push_back(3 | (3 << 8));
+	descriptor.push_back(blockSize);
+	descriptor.push_back(0);
+
+	descriptor.push_back((blockSize * 8 - 1) << 16);
+	descriptor.push_back(0);
+	descriptor.push_back(0);
+	descriptor.push_back(UINT32_MAX);
+
+	return descriptor;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "KtxImage.h"
+
+#include <vector>
+
+class KtxWriter
+{
+public:
+	// levels[0] is the full size level, every level already encoded in the block format
+	static void write(const char* path, VkFormat format, uint32_t width, uint32_t height, const std::vector<std::vector<uint8_t>>& levels);
+
+private:
+	KtxWriter();
+
+	static std::vector<uint32_t> createDataFormatDescriptor(VkFormat format);
+};
@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Image.h"
+#include "KtxWriter.h"
+#include "BlockCompressor.h"
+
+// Converts an image into a mipmapped, block compressed KTX2 texture
+// TextureCompressor [--bc1|--bc7] [--srgb] <input image> <output.ktx2>
+int main(int argc, char** argv)
+{
+	bool isBC1 = false;
+	bool isSrgb = false;
+	std::vector<const char*> paths;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string argument(argv[i]);
+		if (argument == "--bc1")
+		{
+			isBC1 = true;
+		}
+		else if (argument == "--bc7")
+		{
+			isBC1 = false;
+		}
+		else if (argument == "--srgb")
+		{
+			isSrgb = true;
+		}
+		else
+		{
+			paths.push_back(argv[i]);
+		}
+	}
+
+	if (paths.size() != 2)
+	{
+		std::cerr << "Usage: TextureCompressor [--bc1|--bc7] [--srgb] <input image> <output.ktx2>" << std::endl;
+		return 1;
+	}
+
+	VkFormat format = isBC1 ?
+		(isSrgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK) :
+		(isSrgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK);
+
+	Image image(paths[0]);
+	if (image.pixels == nullptr)
+	{
+		std::cerr << "Failed to load " << paths[0] << std::endl;
+		return 1;
+	}
+
+	std::vector<VkDeviceSize> levelOffsets;
+	std::vector<stbi_uc> mipChain = image.generateMipChain(levelOffsets);
+
+	std::vector<std::vector<uint8_t>> levels(levelOffsets.size());
+	size_t compressedSize = 0;
+	for (uint32_t level = 0; level < levels.size(); ++level)
+	{
+		uint32_t width = std::max(image.width >> level, 1);
+		uint32_t height = std::max(image.height >> level, 1);
+
+		levels[level] = BlockCompressor::compress(mipChain.data() + levelOffsets[level], width, height, format);
+		compressedSize += levels[level].size();
+	}
+
+	try
+	{
+		KtxWriter::write(paths[1], format, image.width, image.height, levels);
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		image.free();
+		return 1;
+	}
+
+	std::cout << paths[0] << " -> " << paths[1] << ": " << image.width << "x" << image.height << ", "
+		<< levels.size() << " levels, " << mipChain.size() << " -> " << compressedSize << " bytes" << std::endl;
+
+	image.free();
+	return 0;
+}